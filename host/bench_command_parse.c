@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "net/ws_command.h"
+#include "third_party/mongoose.h"
+
+/*
+ * Host benchmark: WebSocket command decoding
+ * The previous path (256-byte copy, mg_json_get_str/mg_json_get_num, strcmp
+ * chain) against net/ws_command.c (in-place JSON scan, sorted table) and its
+ * binary form, over a slider-storm mix of messages. Checks every message
+ * decodes to the same command both ways and prints ns/message and heap
+ * allocations per message.
+ */
+
+#define ITERATIONS  200000
+
+/* Mongoose allocator hooks, counted */
+static uint64_t ullAllocs = 0;
+void *mg_calloc(size_t cnt, size_t size) {
+    ullAllocs++;
+    return calloc(cnt, size);
+}
+void mg_free(void *ptr) { free(ptr); }
+
+static uint64_t ullNowNs(void) {
+    struct timespec xTs;
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return (uint64_t) xTs.tv_sec * 1000000000ull + (uint64_t) xTs.tv_nsec;
+}
+
+static volatile uint32_t ulSink;
+
+/* Old decoder, as mg_handler.c had it: returns the command type, -1 unknown, -2 no cmd */
+static const struct { const char *pcName; int iType; } xOldNames[] = {
+    { "client_stats", -3 },
+    { "trigger_level", CMD_TRIGGER_LEVEL }, { "trigger_mode", CMD_TRIGGER_MODE },
+    { "trigger_edge", CMD_TRIGGER_EDGE }, { "timebase_scale", CMD_TIMEBASE_SCALE },
+    { "vertical_scale", CMD_VERTICAL_SCALE }, { "vertical_offset", CMD_VERTICAL_OFFSET },
+    { "frame_format", CMD_FRAME_FORMAT }, { "display_points", CMD_DISPLAY_POINTS },
+    { "zoom_width", CMD_ZOOM_WIDTH }, { "zoom_center", CMD_ZOOM_CENTER },
+    { "udp_subscribe", -4 }, { "udp_unsubscribe", -5 }, { "run_stop", CMD_RUN_STOP },
+};
+
+static int iOldDecode(const char *pcMsg, size_t xLen, double *pdValue) {
+    char json[256];
+    size_t n = xLen < sizeof(json) - 1 ? xLen : sizeof(json) - 1;
+    memcpy(json, pcMsg, n);
+    json[n] = '\0';
+    char *cmd_str = mg_json_get_str(mg_str(json), "$.cmd");
+    if (cmd_str == NULL) return -2;
+    *pdValue = 0.0;
+    mg_json_get_num(mg_str(json), "$.value", pdValue);
+    int iType = -1;
+    for (size_t i = 0; i < sizeof(xOldNames) / sizeof(xOldNames[0]); i++) {
+        if (strcmp(cmd_str, xOldNames[i].pcName) == 0) { iType = xOldNames[i].iType; break; }
+    }
+    mg_free(cmd_str);
+    return iType;
+}
+
+/* Same classification from the new decoder */
+static int iNewDecode(const char *pcMsg, size_t xLen, double *pdValue) {
+    WsCommand_t xCmd;
+    WsCommandResult_e eResult = eWsCommandParseJson(pcMsg, xLen, &xCmd);
+    *pdValue = xCmd.dValue;
+    if (eResult == WS_CMD_BAD_FORMAT || eResult == WS_CMD_NO_NAME) return -2;
+    if (eResult == WS_CMD_UNKNOWN) return -1;
+    if (xCmd.bScope) return (int) xCmd.xCmd.eType;
+    switch (xCmd.eOpcode) {
+        case WS_OP_CLIENT_STATS:    return -3;
+        case WS_OP_UDP_SUBSCRIBE:   return -4;
+        case WS_OP_UDP_UNSUBSCRIBE: return -5;
+        default:                    return -1;
+    }
+}
+
+static void vPutFloat(uint8_t *p, float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    p[0] = (uint8_t) u; p[1] = (uint8_t) (u >> 8); p[2] = (uint8_t) (u >> 16); p[3] = (uint8_t) (u >> 24);
+}
+
+int main(void) {
+    /* Mostly slider drags, a few selects and stats polls as the page sends them */
+    static char acMsgs[64][96];
+    static size_t axLens[64];
+    static uint8_t aucBin[64][WS_COMMAND_BINARY_LEN];
+    size_t xCount = 0;
+
+    for (int i = 0; i < 40; i++) {
+        axLens[xCount] = (size_t) snprintf(acMsgs[xCount], sizeof(acMsgs[0]),
+                                           "{\"cmd\":\"trigger_level\",\"value\":%.2f}", 0.05 + 0.08 * i);
+        aucBin[xCount][0] = WS_OP_TRIGGER_LEVEL;
+        vPutFloat(aucBin[xCount] + 1, (float) (0.05 + 0.08 * i));
+        xCount++;
+    }
+    for (int i = 0; i < 12; i++) {
+        axLens[xCount] = (size_t) snprintf(acMsgs[xCount], sizeof(acMsgs[0]),
+                                           "{\"cmd\":\"vertical_offset\",\"value\":%.2f}", 0.1 + 0.25 * i);
+        aucBin[xCount][0] = WS_OP_VERTICAL_OFFSET;
+        vPutFloat(aucBin[xCount] + 1, (float) (0.1 + 0.25 * i));
+        xCount++;
+    }
+    const char *apcOther[] = {
+        "{\"cmd\":\"timebase_scale\",\"value\":0.001}",
+        "{\"cmd\":\"timebase_scale\",\"value\":5e-05}",
+        "{\"cmd\":\"display_points\",\"value\":512}",
+        "{\"cmd\":\"frame_format\",\"value\":81}",
+        "{\"cmd\":\"trigger_mode\",\"value\":1}",
+        "{\"cmd\":\"trigger_edge\",\"value\":0}",
+        "{\"cmd\":\"zoom_width\",\"value\":0.25}",
+        "{\"cmd\":\"zoom_center\",\"value\":0.5}",
+        "{\"cmd\":\"run_stop\",\"value\":1}",
+        "{\"cmd\":\"client_stats\"}",
+        "{ \"value\" : -0.5 , \"cmd\" : \"vertical_scale\" }",
+        "{\"cmd\":\"no_such_command\",\"value\":1}",
+    };
+    const uint8_t aucOtherOp[] = {
+        WS_OP_TIMEBASE_SCALE, WS_OP_TIMEBASE_SCALE, WS_OP_DISPLAY_POINTS, WS_OP_FRAME_FORMAT, WS_OP_TRIGGER_MODE,
+        WS_OP_TRIGGER_EDGE, WS_OP_ZOOM_WIDTH, WS_OP_ZOOM_CENTER, WS_OP_RUN_STOP, WS_OP_CLIENT_STATS,
+        WS_OP_VERTICAL_SCALE, 0xFF,
+    };
+    for (size_t i = 0; i < sizeof(apcOther) / sizeof(apcOther[0]); i++) {
+        axLens[xCount] = strlen(apcOther[i]);
+        memcpy(acMsgs[xCount], apcOther[i], axLens[xCount] + 1);
+        aucBin[xCount][0] = aucOtherOp[i];
+        vPutFloat(aucBin[xCount] + 1, 0.5f);
+        xCount++;
+    }
+
+    /* Both decoders must agree on every message */
+    int iMismatches = 0;
+    for (size_t i = 0; i < xCount; i++) {
+        double dOld = 0.0, dNew = 0.0;
+        int iOld = iOldDecode(acMsgs[i], axLens[i], &dOld);
+        int iNew = iNewDecode(acMsgs[i], axLens[i], &dNew);
+        if (iOld != iNew || (iOld >= 0 && (float) dOld != (float) dNew)) {
+            printf("MISMATCH %s: old %d %.9g new %d %.9g\n", acMsgs[i], iOld, dOld, iNew, dNew);
+            iMismatches++;
+        }
+    }
+
+    uint64_t ullT0 = ullNowNs();
+    ullAllocs = 0;
+    for (uint32_t it = 0; it < ITERATIONS; it++) {
+        double d;
+        size_t i = it % xCount;
+        ulSink += (uint32_t) iOldDecode(acMsgs[i], axLens[i], &d);
+    }
+    uint64_t ullOld = ullNowNs() - ullT0;
+    uint64_t ullOldAllocs = ullAllocs;
+
+    ullT0 = ullNowNs();
+    ullAllocs = 0;
+    for (uint32_t it = 0; it < ITERATIONS; it++) {
+        WsCommand_t xCmd;
+        size_t i = it % xCount;
+        ulSink += (uint32_t) eWsCommandParseJson(acMsgs[i], axLens[i], &xCmd) + (uint32_t) xCmd.xCmd.eType;
+    }
+    uint64_t ullJson = ullNowNs() - ullT0;
+    uint64_t ullJsonAllocs = ullAllocs;
+
+    ullT0 = ullNowNs();
+    for (uint32_t it = 0; it < ITERATIONS; it++) {
+        WsCommand_t xCmd;
+        size_t i = it % xCount;
+        ulSink += (uint32_t) eWsCommandParseBinary(aucBin[i], WS_COMMAND_BINARY_LEN, &xCmd) + (uint32_t) xCmd.xCmd.eType;
+    }
+    uint64_t ullBin = ullNowNs() - ullT0;
+
+    printf("%zu messages, %u decodes each\n", xCount, ITERATIONS);
+    printf("%-28s %10s %12s\n", "decoder", "ns/msg", "allocs/msg");
+    printf("%-28s %10.1f %12.2f\n", "mg_json_get_str + strcmp", (double) ullOld / ITERATIONS,
+           (double) ullOldAllocs / ITERATIONS);
+    printf("%-28s %10.1f %12.2f\n", "ws_command JSON", (double) ullJson / ITERATIONS,
+           (double) ullJsonAllocs / ITERATIONS);
+    printf("%-28s %10.1f %12.2f\n", "ws_command binary", (double) ullBin / ITERATIONS, 0.0);
+    printf("speedup JSON %.1fx, binary %.1fx\n", (double) ullOld / (double) ullJson, (double) ullOld / (double) ullBin);
+
+    if (iMismatches) {
+        printf("FAIL: %d mismatches\n", iMismatches);
+        return 1;
+    }
+    printf("decoders agree on all messages\n");
+    return 0;
+}
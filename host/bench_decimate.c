@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "core/trigger.h"
+
+/*
+ * Host benchmark: integer-ratio decimation kernels vs generic Q16 lerp
+ * Runs both resamplers over the same 1 kHz sine buffer for each (step, width)
+ * pair, checks the outputs match and prints ns/point and the speedup.
+ */
+
+#define SRC_LEN     8192
+#define ITERATIONS  20000
+
+typedef void (*Resampler_t)(const uint16_t*, uint32_t, uint32_t, uint32_t, uint16_t*, uint32_t);
+
+static uint64_t ullNowNs(void) {
+    struct timespec xTs;
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return (uint64_t) xTs.tv_sec * 1000000000ull + (uint64_t) xTs.tv_nsec;
+}
+
+/* Keeps the optimiser from dropping the timed loop */
+static volatile uint32_t ulSink;
+
+static double dTimeNsPerPoint(Resampler_t pxFn, const uint16_t* pusSrc, uint32_t ulStart_q16, uint32_t ulSpan, uint16_t* pusDst, uint32_t ulDstLen) {
+    uint64_t ullT0 = ullNowNs();
+    for (uint32_t uxIt = 0; uxIt < ITERATIONS; uxIt++) {
+        pxFn(pusSrc, SRC_LEN, ulStart_q16, ulSpan, pusDst, ulDstLen);
+        ulSink += pusDst[uxIt % ulDstLen];
+    }
+    uint64_t ullT1 = ullNowNs();
+    return (double)(ullT1 - ullT0) / ((double) ITERATIONS * ulDstLen);
+}
+
+int main(void) {
+    static uint16_t usSrc[SRC_LEN];
+    static uint16_t usRef[SRC_LEN];
+    static uint16_t usOut[SRC_LEN];
+
+    for (uint32_t i = 0; i < SRC_LEN; i++) {
+        usSrc[i] = (uint16_t)(2048.0 + 1800.0 * sin(2.0 * M_PI * (double) i / 100.0));
+    }
+
+    const uint32_t aulSteps[]  = { 1, 2, 3, 4, 5, 8 };
+    const uint32_t aulWidths[] = { 128, 256, 512, 1024 };
+    /* Integer start (copy kernel) and a fractional start (constant-weight lerp) */
+    const uint32_t aulStarts[] = { 0u, (17u << 16) | 0x4000u };
+
+    printf("%-6s %-6s %-6s %12s %12s %8s\n", "step", "width", "start", "generic", "kernel", "speedup");
+    int iMismatches = 0;
+
+    for (size_t s = 0; s < sizeof(aulSteps) / sizeof(aulSteps[0]); s++) {
+        for (size_t w = 0; w < sizeof(aulWidths) / sizeof(aulWidths[0]); w++) {
+            for (size_t f = 0; f < sizeof(aulStarts) / sizeof(aulStarts[0]); f++) {
+                uint32_t ulStep = aulSteps[s];
+                uint32_t ulWidth = aulWidths[w];
+                uint32_t ulSpan = ulStep * ulWidth;
+                if (ulSpan + 32u > SRC_LEN) continue;
+
+                vTriggerDecimateLinearGeneric(usSrc, SRC_LEN, aulStarts[f], ulSpan, usRef, ulWidth);
+                vTriggerDecimateLinear(usSrc, SRC_LEN, aulStarts[f], ulSpan, usOut, ulWidth);
+                if (memcmp(usRef, usOut, ulWidth * sizeof(uint16_t)) != 0) {
+                    printf("MISMATCH step=%u width=%u start=0x%x\n", ulStep, ulWidth, aulStarts[f]);
+                    iMismatches++;
+                    continue;
+                }
+
+                double dGeneric = dTimeNsPerPoint(vTriggerDecimateLinearGeneric, usSrc, aulStarts[f], ulSpan, usOut, ulWidth);
+                double dKernel  = dTimeNsPerPoint(vTriggerDecimateLinear, usSrc, aulStarts[f], ulSpan, usOut, ulWidth);
+                printf("%-6u %-6u %-6s %9.3f ns %9.3f ns %7.2fx\n",
+                       ulStep, ulWidth, (aulStarts[f] & 0xFFFFu) ? "frac" : "int",
+                       dGeneric, dKernel, dGeneric / dKernel);
+            }
+        }
+    }
+
+    return iMismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
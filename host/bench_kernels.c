@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/kernel_bench.h"
+#include "drivers/adc_dma.h"
+
+/*
+ * Host benchmark: trigger search, resampling, frame build and statistics
+ * Runs the sweep of core/kernel_bench.c on the firmware sources and prints
+ * its JSON (nanoseconds). Keep a run per commit and compare, e.g.
+ *
+ *   bench_kernels --label $(git rev-parse --short HEAD) > kernels.json
+ *
+ * Options: --label TEXT, --min-ms N (time per case, default 20),
+ * --max-buffer N (largest buffer swept, default 16384).
+ */
+
+/* scope_data.c is linked for its statistics only; the ring is never published to */
+void vAdcDmaReleaseBuffer(AdcBufferHandle_t xHandle) {
+    (void) xHandle;
+}
+
+static uint32_t ulNowNs(void) {
+    struct timespec xTs;
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return (uint32_t) ((uint64_t) xTs.tv_sec * 1000000000ull + (uint64_t) xTs.tv_nsec);
+}
+
+int main(int argc, char **argv) {
+    KernelBenchConfig_t xConfig = {
+        .pxClock = ulNowNs,
+        .pcTickUnit = "ns",
+        .ulTickHz = 1000000000u,
+        .ulMinTicks = 20u * 1000000u,
+        .ulMaxBuffer = KERNEL_BENCH_MAX_BUFFER,
+        .pcLabel = "",
+    };
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--label") == 0) {
+            xConfig.pcLabel = argv[i + 1];
+        } else if (strcmp(argv[i], "--min-ms") == 0) {
+            uint32_t ulMs = (uint32_t) strtoul(argv[i + 1], NULL, 0);
+            if (ulMs < 1) ulMs = 1;
+            if (ulMs > 2000) ulMs = 2000;
+            xConfig.ulMinTicks = ulMs * 1000000u;
+        } else if (strcmp(argv[i], "--max-buffer") == 0) {
+            xConfig.ulMaxBuffer = (uint32_t) strtoul(argv[i + 1], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [--label TEXT] [--min-ms N] [--max-buffer N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (argc % 2 == 0) {
+        fprintf(stderr, "usage: %s [--label TEXT] [--min-ms N] [--max-buffer N]\n", argv[0]);
+        return 2;
+    }
+
+    return ulKernelBenchRun(&xConfig) > 0 ? 0 : 1;
+}
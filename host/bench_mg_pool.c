@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "net/mg_pool.h"
+#include "third_party/mongoose.h"
+
+/*
+ * Host benchmark: Mongoose allocations from heap_4 vs net/mg_pool.c
+ *
+ * Replays one seeded multi-client workload twice over a model of FreeRTOS
+ * heap_4 (first fit, address-ordered free list, coalescing, 8-byte aligned,
+ * configTOTAL_HEAP_SIZE): once with mg_calloc going straight to the heap as it
+ * used to, once through the pools with the heap as fallback. Per connection
+ * the workload does what Mongoose does: connection struct, receive buffer,
+ * send buffer grown and shrunk in MG_IO_SIZE steps (new block before the old
+ * one is freed), small strings and timers; WebSocket clients stay, HTTP and
+ * SCPI connections come and go.
+ *
+ * Reports ns per allocation/free, failed allocations and the heap's free
+ * space, largest free block and number of free fragments with the
+ * connections still open.
+ */
+
+#define HEAP_SIZE       (256u * 1024u)
+#define SIM_CONNS       12u
+#define SIM_STEPS       400000u
+#define SIM_SMALL       16u
+
+/* ---- heap_4 model ---- */
+
+typedef struct HeapBlock {
+    struct HeapBlock *pxNext;       // Free list, address order
+    size_t xSize;                   // Including this header
+} HeapBlock_t;
+
+#define HEAP_ALIGN          8u
+#define HEAP_HEADER         ((sizeof(HeapBlock_t) + HEAP_ALIGN - 1u) & ~(HEAP_ALIGN - 1u))
+#define HEAP_MIN_BLOCK      (HEAP_HEADER * 2u)
+
+static _Alignas(8) uint8_t ucHeap[HEAP_SIZE];
+static HeapBlock_t xStart;
+static size_t xFreeBytes;
+static size_t xMinEverFree;
+
+static void vHeapInit(void) {
+    HeapBlock_t *pxFirst = (HeapBlock_t *) ucHeap;
+    pxFirst->xSize = HEAP_SIZE;
+    pxFirst->pxNext = NULL;
+    xStart.pxNext = pxFirst;
+    xStart.xSize = 0;
+    xFreeBytes = xMinEverFree = HEAP_SIZE;
+}
+
+static void vInsertFree(HeapBlock_t *pxBlock) {
+    HeapBlock_t *pxPrev = &xStart;
+    while (pxPrev->pxNext != NULL && pxPrev->pxNext < pxBlock) pxPrev = pxPrev->pxNext;
+    // Merge with the following and the preceding block where they touch
+    HeapBlock_t *pxNext = pxPrev->pxNext;
+    if (pxNext != NULL && (uint8_t *) pxBlock + pxBlock->xSize == (uint8_t *) pxNext) {
+        pxBlock->xSize += pxNext->xSize;
+        pxBlock->pxNext = pxNext->pxNext;
+    } else {
+        pxBlock->pxNext = pxNext;
+    }
+    if (pxPrev != &xStart && (uint8_t *) pxPrev + pxPrev->xSize == (uint8_t *) pxBlock) {
+        pxPrev->xSize += pxBlock->xSize;
+        pxPrev->pxNext = pxBlock->pxNext;
+    } else {
+        pxPrev->pxNext = pxBlock;
+    }
+}
+
+void *pvPortMalloc(size_t xWanted) {
+    if (xWanted == 0) return NULL;
+    xWanted = (xWanted + HEAP_HEADER + HEAP_ALIGN - 1u) & ~(HEAP_ALIGN - 1u);
+    HeapBlock_t *pxPrev = &xStart;
+    HeapBlock_t *pxBlock = xStart.pxNext;
+    while (pxBlock != NULL && pxBlock->xSize < xWanted) {
+        pxPrev = pxBlock;
+        pxBlock = pxBlock->pxNext;
+    }
+    if (pxBlock == NULL) return NULL;
+    pxPrev->pxNext = pxBlock->pxNext;
+    if (pxBlock->xSize - xWanted > HEAP_MIN_BLOCK) {
+        HeapBlock_t *pxRest = (HeapBlock_t *) ((uint8_t *) pxBlock + xWanted);
+        pxRest->xSize = pxBlock->xSize - xWanted;
+        pxBlock->xSize = xWanted;
+        vInsertFree(pxRest);
+    }
+    xFreeBytes -= pxBlock->xSize;
+    if (xFreeBytes < xMinEverFree) xMinEverFree = xFreeBytes;
+    return (uint8_t *) pxBlock + HEAP_HEADER;
+}
+
+void vPortFree(void *pv) {
+    if (pv == NULL) return;
+    HeapBlock_t *pxBlock = (HeapBlock_t *) ((uint8_t *) pv - HEAP_HEADER);
+    xFreeBytes += pxBlock->xSize;
+    vInsertFree(pxBlock);
+}
+
+static void vHeapReport(size_t *pxLargest, uint32_t *pulFragments) {
+    *pxLargest = 0;
+    *pulFragments = 0;
+    for (HeapBlock_t *p = xStart.pxNext; p != NULL; p = p->pxNext) {
+        if (p->xSize > *pxLargest) *pxLargest = p->xSize;
+        (*pulFragments)++;
+    }
+}
+
+/* ---- allocators under test ---- */
+
+static void *pvHeapCalloc(size_t n, size_t s) {
+    void *p = pvPortMalloc(n * s);
+    if (p) memset(p, 0, n * s);
+    return p;
+}
+
+typedef struct {
+    const char *pcName;
+    void *(*pxCalloc)(size_t, size_t);
+    void (*pxFree)(void *);
+    bool bPools;
+} Allocator_t;
+
+/* ---- workload ---- */
+
+typedef struct {
+    void  *pvConn;
+    void  *pvRecv;
+    void  *pvSend;
+    size_t xSendSize;
+    bool   bPersistent;             // WebSocket viewer
+} SimConn_t;
+
+static uint32_t ulRng;
+static uint32_t ulRand(void) {
+    ulRng ^= ulRng << 13;
+    ulRng ^= ulRng >> 17;
+    ulRng ^= ulRng << 5;
+    return ulRng;
+}
+
+static uint64_t ullNowNs(void) {
+    struct timespec xTs;
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return (uint64_t) xTs.tv_sec * 1000000000ull + (uint64_t) xTs.tv_nsec;
+}
+
+typedef struct {
+    uint64_t ullOps;
+    uint64_t ullNs;
+    uint32_t ulFailed;
+    size_t   xFree;
+    size_t   xLargest;
+    uint32_t ulFragments;
+    size_t   xMinEverFree;
+} SimResult_t;
+
+static SimResult_t xRun(const Allocator_t *pxAlloc, uint32_t ulViewers) {
+    SimConn_t xConns[SIM_CONNS] = {0};
+    void *pvSmall[SIM_SMALL] = {0};
+    SimResult_t xRes = {0};
+    const size_t xConnSize = sizeof(struct mg_connection);
+
+    vHeapInit();
+    // Long-lived firmware allocations made before Mongoose starts (task stacks, queues)
+    for (int i = 0; i < 6; i++) pvPortMalloc(4096u + 512u * (size_t) i);
+    if (pxAlloc->bPools) bMgPoolInit();
+
+    ulRng = 0x12345678u;
+#define ALLOC(sz) (xRes.ullOps++, pxAlloc->pxCalloc(1, (sz)))
+#define FREE(p)   do { if (p) { xRes.ullOps++; pxAlloc->pxFree(p); } } while (0)
+
+    uint64_t ullT0 = ullNowNs();
+    for (uint32_t ulStep = 0; ulStep < SIM_STEPS; ulStep++) {
+        uint32_t r = ulRand();
+        SimConn_t *c = &xConns[r % SIM_CONNS];
+        c->bPersistent = (uint32_t) (c - xConns) < ulViewers;
+
+        if (c->pvConn == NULL) {
+            // Accept: connection struct and its first receive buffer
+            c->pvConn = ALLOC(xConnSize);
+            c->pvRecv = c->pvConn ? ALLOC(MG_IO_SIZE) : NULL;
+            if (c->pvConn == NULL || c->pvRecv == NULL) xRes.ulFailed++;
+            continue;
+        }
+        switch ((r >> 8) % 8u) {
+            case 0: case 1: case 2: {
+                // Send buffer grows by one MG_IO_SIZE step (backlog), capped at 4 steps
+                size_t xNew = c->xSendSize + MG_IO_SIZE;
+                if (xNew > 4u * MG_IO_SIZE) break;
+                void *pvNew = ALLOC(xNew);
+                if (pvNew == NULL) { xRes.ulFailed++; break; }
+                FREE(c->pvSend);
+                c->pvSend = pvNew;
+                c->xSendSize = xNew;
+                break;
+            }
+            case 3: case 4:
+                // Drained: back to one step, or released
+                if (c->xSendSize > MG_IO_SIZE) {
+                    void *pvNew = ALLOC(MG_IO_SIZE);
+                    if (pvNew == NULL) { xRes.ulFailed++; break; }
+                    FREE(c->pvSend);
+                    c->pvSend = pvNew;
+                    c->xSendSize = MG_IO_SIZE;
+                } else {
+                    FREE(c->pvSend);
+                    c->pvSend = NULL;
+                    c->xSendSize = 0;
+                }
+                break;
+            case 5: case 6: {
+                // Short-lived small allocation: JSON string, timer, DNS state
+                uint32_t s = (r >> 16) % SIM_SMALL;
+                FREE(pvSmall[s]);
+                pvSmall[s] = ALLOC(8u + (r >> 20) % 56u);
+                if (pvSmall[s] == NULL) xRes.ulFailed++;
+                break;
+            }
+            default:
+                // HTTP / SCPI connections close; viewers stay
+                if (c->bPersistent) break;
+                FREE(c->pvSend);
+                FREE(c->pvRecv);
+                FREE(c->pvConn);
+                memset(c, 0, sizeof(*c));
+                break;
+        }
+    }
+    xRes.ullNs = ullNowNs() - ullT0;
+
+    // Heap state with the connections still open
+    xRes.xFree = xFreeBytes;
+    xRes.xMinEverFree = xMinEverFree;
+    vHeapReport(&xRes.xLargest, &xRes.ulFragments);
+
+    if (pxAlloc->bPools) {
+        MgPoolStats_t xStats;
+        vMgPoolGetStats(&xStats);
+        for (uint32_t i = 0; i < MG_POOL_CLASSES; i++) {
+            printf("    class %5lu B: %2lu blocks, high water %2lu, %8lu allocs, %6lu fallbacks\n",
+                   (unsigned long) xStats.xClass[i].ulBlockSize, (unsigned long) xStats.xClass[i].ulBlocks,
+                   (unsigned long) xStats.xClass[i].ulHighWater, (unsigned long) xStats.xClass[i].ulAllocs,
+                   (unsigned long) xStats.xClass[i].ulFallbacks);
+        }
+        printf("    heap %lu allocs, %lu failed\n", (unsigned long) xStats.ulHeapAllocs,
+               (unsigned long) xStats.ulFailures);
+    }
+#undef ALLOC
+#undef FREE
+    return xRes;
+}
+
+int main(int argc, char **argv) {
+    const Allocator_t xAllocs[] = {
+        { "heap_4", pvHeapCalloc, vPortFree, false },
+        { "mg_pool", pvMgPoolCalloc, vMgPoolFree, true },
+    };
+    uint32_t ulViewers = 4;
+    if (argc > 2 && strcmp(argv[1], "--viewers") == 0) ulViewers = (uint32_t) atoi(argv[2]);
+    if (ulViewers > SIM_CONNS) ulViewers = SIM_CONNS;
+
+    printf("%u connections (%u WebSocket viewers, the rest HTTP/SCPI), %u steps, MG_IO_SIZE %u, heap %u KB\n",
+           SIM_CONNS, ulViewers, SIM_STEPS, (unsigned) MG_IO_SIZE, HEAP_SIZE / 1024u);
+
+    // Heap first: the pool run leaves its arenas set up (static state)
+    SimResult_t xRes[2];
+    for (size_t a = 0; a < 2; a++) {
+        printf("%s\n", xAllocs[a].pcName);
+        xRes[a] = xRun(&xAllocs[a], ulViewers);
+    }
+
+    printf("\n%-8s %8s %8s %10s %12s %10s %12s\n", "alloc", "ns/op", "failed", "free KB",
+           "largest KB", "fragments", "min free KB");
+    for (size_t a = 0; a < 2; a++) {
+        printf("%-8s %8.1f %8u %10.1f %12.1f %10u %12.1f\n", xAllocs[a].pcName,
+               (double) xRes[a].ullNs / (double) xRes[a].ullOps, xRes[a].ulFailed,
+               xRes[a].xFree / 1024.0, xRes[a].xLargest / 1024.0, xRes[a].ulFragments,
+               xRes[a].xMinEverFree / 1024.0);
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef HOST_SHIM_FREERTOS_H
+#define HOST_SHIM_FREERTOS_H
+
+/* Minimal FreeRTOS surface for building firmware modules on the host.
+ * Also the base of the thread-backed simulation headers (host/sim/include),
+ * which define HOST_SHIM_THREADS and their own critical sections first.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+typedef void*         TaskHandle_t;
+typedef long          BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t      TickType_t;
+typedef uint32_t      StackType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  pdTRUE
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))      /* 1 kHz tick */
+#define portMAX_DELAY           ((TickType_t) 0xFFFFFFFFu)
+#define configASSERT(x)         assert(x)
+
+/* Single-threaded host tools need no locking */
+#ifndef taskENTER_CRITICAL
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#endif
+
+/* Heap: provided by the host tool that needs it (see bench_mg_pool.c) */
+void *pvPortMalloc(size_t xSize);
+void vPortFree(void *pv);
+
+#endif /* HOST_SHIM_FREERTOS_H */
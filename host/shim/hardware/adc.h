@@ -0,0 +1,7 @@
+#ifndef HOST_SHIM_HARDWARE_ADC_H
+#define HOST_SHIM_HARDWARE_ADC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#endif /* HOST_SHIM_HARDWARE_ADC_H */
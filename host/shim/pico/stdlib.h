@@ -0,0 +1,8 @@
+#ifndef HOST_SHIM_PICO_STDLIB_H
+#define HOST_SHIM_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#endif /* HOST_SHIM_PICO_STDLIB_H */
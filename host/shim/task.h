@@ -0,0 +1,11 @@
+#ifndef HOST_SHIM_TASK_H
+#define HOST_SHIM_TASK_H
+
+#include "FreeRTOS.h"
+
+#ifndef HOST_SHIM_THREADS
+/* Notifications are not needed by the host tools: consumers poll */
+static inline void xTaskNotifyGive(TaskHandle_t xTask) { (void) xTask; }
+#endif
+
+#endif /* HOST_SHIM_TASK_H */
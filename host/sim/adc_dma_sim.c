@@ -0,0 +1,164 @@
+#include "adc_dma_sim.h"
+#include "drivers/adc_dma.h"
+#include "drivers/adc_buffers.h"
+#include "core/log.h"
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <strings.h>
+
+/* A transfer fills pusTransferData once ADC_BUFFER_SIZE samples' worth of time passed */
+static bool bTransferArmed = false;
+static uint16_t *pusTransferData = NULL;
+static uint64_t ullTransferStartUs = 0;
+
+static uint32_t ulTargetSampleRateHz = 10000;
+
+static SimSignalConfig_t xSignal = { SIM_SIGNAL_SINE, 1000.0f, 1500, 16 };
+static double dPhase = 0.0;                 // Cycles, [0, 1)
+static uint32_t ulNoiseState = 0x12345678u;
+
+static pthread_t xDmaThread;
+static pthread_mutex_t xDmaLock = PTHREAD_MUTEX_INITIALIZER;   // Transfer start vs completion
+static bool bThreadStarted = false;
+
+/* Buffer hand-over lives in drivers/adc_buffers.c, like on the device */
+static void vStartTransfer(uint16_t *pusData) {
+    pthread_mutex_lock(&xDmaLock);
+    pusTransferData = pusData;
+    ullTransferStartUs = time_us_64();
+    bTransferArmed = true;
+    pthread_mutex_unlock(&xDmaLock);
+}
+
+static uint16_t usSample(double dPhaseCycles) {
+    double dWave = 0.0;
+    switch (xSignal.eSignal) {
+        case SIM_SIGNAL_SINE:     dWave = sin(2.0 * M_PI * dPhaseCycles); break;
+        case SIM_SIGNAL_SQUARE:   dWave = dPhaseCycles < 0.5 ? 1.0 : -1.0; break;
+        case SIM_SIGNAL_TRIANGLE: dWave = dPhaseCycles < 0.5 ? 4.0 * dPhaseCycles - 1.0 : 3.0 - 4.0 * dPhaseCycles; break;
+        case SIM_SIGNAL_NOISE:    dWave = 0.0; break;
+        case SIM_SIGNAL_DC:       dWave = 1.0; break;
+    }
+    int32_t lValue = 2048 + (int32_t) lround(dWave * xSignal.usAmplitude);
+    uint16_t usNoise = xSignal.eSignal == SIM_SIGNAL_NOISE ? (uint16_t) (2u * xSignal.usAmplitude) : xSignal.usNoise;
+    if (usNoise > 0) {
+        ulNoiseState ^= ulNoiseState << 13;
+        ulNoiseState ^= ulNoiseState >> 17;
+        ulNoiseState ^= ulNoiseState << 5;
+        lValue += (int32_t) (ulNoiseState % (usNoise + 1u)) - (int32_t) (usNoise / 2u);
+    }
+    if (lValue < 0) lValue = 0;
+    if (lValue > 4095) lValue = 4095;
+    return (uint16_t) lValue;
+}
+
+static void vFillBuffer(uint16_t *pusData) {
+    double dStep = (double) xSignal.fFrequencyHz / (double) ulTargetSampleRateHz;
+    for (uint32_t i = 0; i < ADC_BUFFER_SIZE; i++) {
+        pusData[i] = usSample(dPhase);
+        dPhase += dStep;
+        dPhase -= floor(dPhase);
+    }
+}
+
+static void *pvDmaThread(void *pv) {
+    (void) pv;
+    for (;;) {
+        uint64_t ullWaitUs = 1000u;         /* Idle / stalled: look again in 1 ms */
+        uint16_t *pusDone = NULL;
+        pthread_mutex_lock(&xDmaLock);
+        if (bTransferArmed && bAdcDmaIsRunning()) {
+            uint64_t ullDue = ullTransferStartUs + ((uint64_t) ADC_BUFFER_SIZE * 1000000u) / ulTargetSampleRateHz;
+            uint64_t ullNow = time_us_64();
+            if (ullNow >= ullDue) {
+                bTransferArmed = false;
+                pusDone = pusTransferData;
+            } else if (ullDue - ullNow < ullWaitUs) {
+                ullWaitUs = ullDue - ullNow;
+            }
+        }
+        pthread_mutex_unlock(&xDmaLock);
+
+        if (pusDone != NULL) {
+            /* The DMA interrupt of drivers/adc_dma.c */
+            vFillBuffer(pusDone);
+            vAdcBuffersCompleteTransfer();
+        } else {
+            struct timespec ts = { 0, (long) ullWaitUs * 1000L };
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+
+void vAdcDmaSimSetSignal(const SimSignalConfig_t *pxConfig) {
+    if (pxConfig) xSignal = *pxConfig;
+}
+
+int iAdcDmaSimParseSignal(const char *pcName) {
+    static const char *const pcNames[] = { "sine", "square", "triangle", "noise", "dc" };
+    for (int i = 0; i < (int) (sizeof(pcNames) / sizeof(pcNames[0])); i++) {
+        if (strcasecmp(pcName, pcNames[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static void vApplyAdcSampleRate(void) {
+    /* Same divider arithmetic as the RP2350 ADC, so rates match the firmware */
+    const uint32_t clk_adc_hz = 48000000u;
+    uint32_t div = (clk_adc_hz + ulTargetSampleRateHz - 1u) / ulTargetSampleRateHz;
+    if (div < 96u) div = 96u;
+    if (div > 0xFFFFu) div = 0xFFFFu;
+    uint32_t actual_fs = clk_adc_hz / div;
+    LOG(LOG_ADC_RATE, ulTargetSampleRateHz, clk_adc_hz, div, actual_fs);
+}
+
+void vAdcDmaInit(void) {
+    LOG(LOG_ADC_INIT);
+    if (bAdcDmaIsRunning()) vAdcDmaStop();
+
+    vApplyAdcSampleRate();
+    vAdcBuffersInit(vStartTransfer);
+
+    if (!bThreadStarted) {
+        bThreadStarted = pthread_create(&xDmaThread, NULL, pvDmaThread, NULL) == 0;
+        configASSERT(bThreadStarted);
+    }
+}
+
+void vAdcDmaStartContinous(void) {
+    vAdcBuffersStart();
+}
+
+void vAdcDmaStop(void) {
+    if (!bAdcDmaIsRunning()) return;
+    LOG(LOG_ADC_STOP);
+
+    pthread_mutex_lock(&xDmaLock);
+    bTransferArmed = false;
+    pthread_mutex_unlock(&xDmaLock);
+    vAdcBuffersStop();
+}
+
+void vAdcDmaSetSampleRate(uint32_t ulHz) {
+    if (ulHz < 1000) ulHz = 1000;
+    if (ulHz > 512000) ulHz = 512000;
+
+    ulTargetSampleRateHz = ulHz;
+
+    bool was_running = bAdcDmaIsRunning();
+    if (was_running) vAdcDmaStop();
+    vApplyAdcSampleRate();
+    if (was_running) vAdcDmaStartContinous();
+
+    LOG(LOG_ADC_RATE_CHANGED, ulHz);
+}
+
+uint32_t ulAdcDmaGetSampleRate(void) {
+    return ulTargetSampleRateHz;
+}
@@ -0,0 +1,38 @@
+#ifndef ADC_DMA_SIM_H
+#define ADC_DMA_SIM_H
+
+#include <stdint.h>
+
+/*
+ * Simulated ADC + DMA (drivers/adc_dma.h API)
+ *
+ * A "DMA" thread fills one ADC_BUFFER_SIZE buffer per ADC_BUFFER_SIZE / rate
+ * of wall time with a synthetic 12-bit waveform, then completes the transfer
+ * through drivers/adc_buffers.c like the DMA interrupt does: publish FULL,
+ * claim the next EMPTY (or oldest FULL) buffer, stall until a release when
+ * every buffer is handed out. The phase runs on across buffers, so consecutive
+ * captures join up like real ones.
+ */
+
+typedef enum {
+    SIM_SIGNAL_SINE = 0,
+    SIM_SIGNAL_SQUARE,
+    SIM_SIGNAL_TRIANGLE,
+    SIM_SIGNAL_NOISE,
+    SIM_SIGNAL_DC,
+} SimSignal_e;
+
+typedef struct {
+    SimSignal_e eSignal;
+    float fFrequencyHz;
+    uint16_t usAmplitude;        // Counts, peak (around mid-scale 2048)
+    uint16_t usNoise;            // Counts, peak-to-peak uniform noise on top
+} SimSignalConfig_t;
+
+/* Before vAdcDmaInit(); may also be changed while running */
+void vAdcDmaSimSetSignal(const SimSignalConfig_t *pxConfig);
+
+/* Parse "sine", "square", "triangle", "noise", "dc"; -1 if unknown */
+int iAdcDmaSimParseSignal(const char *pcName);
+
+#endif /* ADC_DMA_SIM_H */
@@ -0,0 +1,281 @@
+#include "FreeRTOS.h"
+#include "task.h"
+#include "pico/stdlib.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* FreeRTOS and Pico SDK calls of the firmware on POSIX threads, see FreeRTOS.h */
+
+#define SIM_MAX_TASKS   16
+
+typedef struct {
+    bool bUsed;
+    bool bExited;
+    pthread_t xThread;
+    char acName[configMAX_TASK_NAME_LEN];
+    UBaseType_t uxPriority;
+    UBaseType_t uxAffinity;
+    TaskFunction_t pxCode;
+    void *pvParameters;
+    pthread_mutex_t xLock;                  // Notification value
+    pthread_cond_t xCond;
+    uint32_t ulNotify;
+} SimTask_t;
+
+static SimTask_t xTasks[SIM_MAX_TASKS];
+static pthread_mutex_t xTasksLock = PTHREAD_MUTEX_INITIALIZER;
+static __thread SimTask_t *pxSelf = NULL;
+
+static pthread_mutex_t xCritical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static uint64_t ullStartUs = 0;
+static pthread_once_t xClockOnce = PTHREAD_ONCE_INIT;
+
+static uint64_t ullMonotonicUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000u + (uint64_t) ts.tv_nsec / 1000u;
+}
+
+static void vClockInit(void) { ullStartUs = ullMonotonicUs(); }
+
+uint64_t time_us_64(void) {
+    pthread_once(&xClockOnce, vClockInit);
+    return ullMonotonicUs() - ullStartUs;
+}
+
+void sleep_ms(uint32_t ulMs) {
+    struct timespec ts = { (time_t) (ulMs / 1000u), (long) (ulMs % 1000u) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) { }
+}
+
+unsigned int get_core_num(void) {
+    if (pxSelf == NULL || pxSelf->uxAffinity == 0) return 0;
+    return (unsigned int) __builtin_ctzl(pxSelf->uxAffinity);
+}
+
+void vSimEnterCritical(void) { pthread_mutex_lock(&xCritical); }
+void vSimExitCritical(void) { pthread_mutex_unlock(&xCritical); }
+
+/* ---------------------------------------------------------------- Heap */
+
+/* Each block carries its size in front, like heap_4's block header */
+typedef union {
+    size_t xSize;
+    max_align_t xAlign;
+} SimBlock_t;
+
+static size_t xHeapUsed = 0;
+static size_t xHeapPeak = 0;
+static pthread_mutex_t xHeapLock = PTHREAD_MUTEX_INITIALIZER;
+
+void *pvPortMalloc(size_t xSize) {
+    size_t xTotal = xSize + sizeof(SimBlock_t);
+    pthread_mutex_lock(&xHeapLock);
+    bool bFits = xHeapUsed + xTotal <= configTOTAL_HEAP_SIZE;
+    if (bFits) {
+        xHeapUsed += xTotal;
+        if (xHeapUsed > xHeapPeak) xHeapPeak = xHeapUsed;
+    }
+    pthread_mutex_unlock(&xHeapLock);
+    if (!bFits) return NULL;
+
+    SimBlock_t *pxBlock = malloc(xTotal);
+    if (pxBlock == NULL) {
+        pthread_mutex_lock(&xHeapLock);
+        xHeapUsed -= xTotal;
+        pthread_mutex_unlock(&xHeapLock);
+        return NULL;
+    }
+    pxBlock->xSize = xTotal;
+    return pxBlock + 1;
+}
+
+void vPortFree(void *pv) {
+    if (pv == NULL) return;
+    SimBlock_t *pxBlock = (SimBlock_t *) pv - 1;
+    pthread_mutex_lock(&xHeapLock);
+    xHeapUsed -= pxBlock->xSize;
+    pthread_mutex_unlock(&xHeapLock);
+    free(pxBlock);
+}
+
+size_t xPortGetFreeHeapSize(void) {
+    pthread_mutex_lock(&xHeapLock);
+    size_t xFree = configTOTAL_HEAP_SIZE - xHeapUsed;
+    pthread_mutex_unlock(&xHeapLock);
+    return xFree;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void) {
+    pthread_mutex_lock(&xHeapLock);
+    size_t xFree = configTOTAL_HEAP_SIZE - xHeapPeak;
+    pthread_mutex_unlock(&xHeapLock);
+    return xFree;
+}
+
+/* ---------------------------------------------------------------- Tasks */
+
+static void *pvTaskEntry(void *pv) {
+    pxSelf = (SimTask_t *) pv;
+    pxSelf->pxCode(pxSelf->pvParameters);
+    pxSelf->bExited = true;             /* FreeRTOS tasks must not return; tolerate it */
+    return NULL;
+}
+
+BaseType_t xTaskCreateAffinitySet(TaskFunction_t pxCode, const char *pcName, uint32_t ulStackDepth,
+                                  void *pvParameters, UBaseType_t uxPriority, UBaseType_t uxCoreAffinityMask,
+                                  TaskHandle_t *pxCreatedTask) {
+    (void) ulStackDepth;
+    pthread_mutex_lock(&xTasksLock);
+    SimTask_t *pxTask = NULL;
+    for (int i = 0; i < SIM_MAX_TASKS && pxTask == NULL; i++) {
+        if (!xTasks[i].bUsed) pxTask = &xTasks[i];
+    }
+    if (pxTask == NULL) {
+        pthread_mutex_unlock(&xTasksLock);
+        return pdFALSE;
+    }
+    memset(pxTask, 0, sizeof(*pxTask));
+    pxTask->bUsed = true;
+    snprintf(pxTask->acName, sizeof(pxTask->acName), "%s", pcName ? pcName : "");
+    pxTask->uxPriority = uxPriority;
+    pxTask->uxAffinity = uxCoreAffinityMask;
+    pxTask->pxCode = pxCode;
+    pxTask->pvParameters = pvParameters;
+    pthread_mutex_init(&pxTask->xLock, NULL);
+    pthread_cond_init(&pxTask->xCond, NULL);
+    if (pxCreatedTask) *pxCreatedTask = pxTask;
+    pthread_mutex_unlock(&xTasksLock);
+
+    if (pthread_create(&pxTask->xThread, NULL, pvTaskEntry, pxTask) != 0) {
+        pxTask->bUsed = false;
+        return pdFALSE;
+    }
+    pthread_detach(pxTask->xThread);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxCode, const char *pcName, uint32_t ulStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask) {
+    return xTaskCreateAffinitySet(pxCode, pcName, ulStackDepth, pvParameters, uxPriority, 0, pxCreatedTask);
+}
+
+void vTaskDelete(TaskHandle_t xTask) {
+    (void) xTask;                        /* Only used by configASSERT */
+    configASSERT(xTask == NULL || xTask == pxSelf);
+    if (pxSelf != NULL) pxSelf->bExited = true;
+    pthread_exit(NULL);
+}
+
+void vTaskStartScheduler(void) {
+    for (;;) pause();
+}
+
+void vTaskDelay(TickType_t xTicks) {
+    if (xTicks == 0) {
+        sched_yield();
+        return;
+    }
+    sleep_ms(xTicks);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t) (time_us_64() / 1000u);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return pxSelf;
+}
+
+void vSimTaskYield(void) {
+    sched_yield();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+    SimTask_t *pxTask = pxSelf;
+    configASSERT(pxTask != NULL);
+
+    pthread_mutex_lock(&pxTask->xLock);
+    if (pxTask->ulNotify == 0 && xTicksToWait > 0) {
+        if (xTicksToWait == portMAX_DELAY) {
+            while (pxTask->ulNotify == 0) pthread_cond_wait(&pxTask->xCond, &pxTask->xLock);
+        } else {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            uint64_t ullNs = (uint64_t) ts.tv_nsec + (uint64_t) xTicksToWait * 1000000u;
+            ts.tv_sec += (time_t) (ullNs / 1000000000u);
+            ts.tv_nsec = (long) (ullNs % 1000000000u);
+            while (pxTask->ulNotify == 0 &&
+                   pthread_cond_timedwait(&pxTask->xCond, &pxTask->xLock, &ts) != ETIMEDOUT) { }
+        }
+    }
+    uint32_t ulValue = pxTask->ulNotify;
+    if (ulValue != 0) pxTask->ulNotify = xClearCountOnExit ? 0 : ulValue - 1;
+    pthread_mutex_unlock(&pxTask->xLock);
+    return ulValue;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTask) {
+    SimTask_t *pxTask = (SimTask_t *) xTask;
+    if (pxTask == NULL) return pdFALSE;
+    pthread_mutex_lock(&pxTask->xLock);
+    pxTask->ulNotify++;
+    pthread_cond_signal(&pxTask->xCond);
+    pthread_mutex_unlock(&pxTask->xLock);
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t xCoreID) {
+    (void) xCoreID;
+    return NULL;
+}
+
+/* CPU time of the task's thread */
+uint32_t ulTaskGetRunTimeCounter(TaskHandle_t xTask) {
+    SimTask_t *pxTask = (SimTask_t *) xTask;
+    clockid_t xClock;
+    struct timespec ts;
+    if (pxTask == NULL || pxTask->bExited || pthread_getcpuclockid(pxTask->xThread, &xClock) != 0 ||
+        clock_gettime(xClock, &ts) != 0) {
+        return 0;
+    }
+    return (uint32_t) ((uint64_t) ts.tv_sec * 1000000u + (uint64_t) ts.tv_nsec / 1000u);
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void) {
+    UBaseType_t uxCount = 0;
+    pthread_mutex_lock(&xTasksLock);
+    for (int i = 0; i < SIM_MAX_TASKS; i++) uxCount += xTasks[i].bUsed && !xTasks[i].bExited;
+    pthread_mutex_unlock(&xTasksLock);
+    return uxCount;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pxTaskStatusArray, UBaseType_t uxArraySize,
+                                 uint32_t *pulTotalRunTime) {
+    UBaseType_t uxCount = 0;
+    pthread_mutex_lock(&xTasksLock);
+    for (int i = 0; i < SIM_MAX_TASKS && uxCount < uxArraySize; i++) {
+        SimTask_t *pxTask = &xTasks[i];
+        if (!pxTask->bUsed || pxTask->bExited) continue;
+        pxTaskStatusArray[uxCount++] = (TaskStatus_t) {
+            .xHandle = pxTask,
+            .pcTaskName = pxTask->acName,
+            .xTaskNumber = (UBaseType_t) i,
+            .eCurrentState = pxTask == pxSelf ? eRunning : eBlocked,
+            .uxCurrentPriority = pxTask->uxPriority,
+            .uxBasePriority = pxTask->uxPriority,
+            .ulRunTimeCounter = ulTaskGetRunTimeCounter(pxTask),
+            .uxCoreAffinityMask = pxTask->uxAffinity,
+        };
+    }
+    pthread_mutex_unlock(&xTasksLock);
+    if (pulTotalRunTime) *pulTotalRunTime = time_us_32();
+    return uxCount;
+}
@@ -0,0 +1,32 @@
+#ifndef HOST_SIM_FREERTOS_H
+#define HOST_SIM_FREERTOS_H
+
+/*
+ * FreeRTOS API surface of the firmware, implemented on POSIX threads
+ * (host/sim/freertos_sim.c). Every task is a free-running thread, so the
+ * tasks really run in parallel like on the two RP2350 cores; priorities and
+ * core affinity are recorded but not enforced. Types and macros shared with
+ * the host tools come from host/shim.
+ */
+
+#define HOST_SHIM_THREADS       1
+
+/* One lock for all critical sections */
+void vSimEnterCritical(void);
+void vSimExitCritical(void);
+#define taskENTER_CRITICAL()    vSimEnterCritical()
+#define taskEXIT_CRITICAL()     vSimExitCritical()
+
+#include "../../shim/FreeRTOS.h"
+
+#define configNUMBER_OF_CORES       2
+#define configUSE_CORE_AFFINITY     1
+#define configMINIMAL_STACK_SIZE    256
+#define configTOTAL_HEAP_SIZE       (256 * 1024)        /* Budget of the simulated heap_4 */
+#define configMAX_TASK_NAME_LEN     16
+
+/* Heap: malloc with the accounting of heap_4 (free / minimum ever free) */
+size_t xPortGetFreeHeapSize(void);
+size_t xPortGetMinimumEverFreeHeapSize(void);
+
+#endif /* HOST_SIM_FREERTOS_H */
@@ -0,0 +1,14 @@
+#ifndef HOST_SIM_HARDWARE_CLOCKS_H
+#define HOST_SIM_HARDWARE_CLOCKS_H
+
+#include <stdint.h>
+
+/* ulMetricsCycles() counts nanoseconds on the host (core/metrics.h) */
+enum clock_index { clk_sys = 5 };
+
+static inline uint32_t clock_get_hz(enum clock_index eClock) {
+    (void) eClock;
+    return 1000000000u;
+}
+
+#endif /* HOST_SIM_HARDWARE_CLOCKS_H */
@@ -0,0 +1,10 @@
+#ifndef HOST_SIM_LWIP_COMPAT_H
+#define HOST_SIM_LWIP_COMPAT_H
+
+/* Force-included: the firmware writes batches with lwIP's writev, the host has its own */
+
+#include <sys/uio.h>
+
+#define lwip_writev     writev
+
+#endif /* HOST_SIM_LWIP_COMPAT_H */
@@ -0,0 +1,27 @@
+#ifndef HOST_SIM_CYW43_ARCH_H
+#define HOST_SIM_CYW43_ARCH_H
+
+/* No Wi-Fi: the host is always "connected", lwIP calls are BSD sockets */
+
+#include <stdint.h>
+
+#define CYW43_AUTH_WPA2_AES_PSK     0x00400004
+#define CYW43_WL_GPIO_LED_PIN       0
+
+static inline int cyw43_arch_init(void) { return 0; }
+static inline void cyw43_arch_enable_sta_mode(void) { }
+static inline int cyw43_arch_wifi_connect_timeout_ms(const char *pcSsid, const char *pcPass, uint32_t ulAuth,
+                                                     uint32_t ulTimeoutMs) {
+    (void) pcSsid; (void) pcPass; (void) ulAuth; (void) ulTimeoutMs;
+    return 0;
+}
+static inline void cyw43_arch_lwip_begin(void) { }
+static inline void cyw43_arch_lwip_end(void) { }
+static inline void cyw43_arch_gpio_put(unsigned int uiPin, int iValue) { (void) uiPin; (void) iValue; }
+
+/* web_server.c prints the station address */
+#define netif_list                  NULL
+#define netif_ip4_addr(n)           ((void) (n), (const void *) 0)
+#define ip4addr_ntoa(a)             ((void) (a), "127.0.0.1")
+
+#endif /* HOST_SIM_CYW43_ARCH_H */
@@ -0,0 +1,19 @@
+#ifndef HOST_SIM_PICO_STDLIB_H
+#define HOST_SIM_PICO_STDLIB_H
+
+/* Pico SDK time and core helpers on CLOCK_MONOTONIC (since process start) */
+
+#include "../../../shim/pico/stdlib.h"
+
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+static inline uint32_t time_us_32(void) { return (uint32_t) time_us_64(); }
+static inline absolute_time_t get_absolute_time(void) { return time_us_64(); }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t) (t / 1000u); }
+void sleep_ms(uint32_t ulMs);
+
+/* Core of the calling task (from its affinity mask, core 0 without one) */
+unsigned int get_core_num(void);
+
+#endif /* HOST_SIM_PICO_STDLIB_H */
@@ -0,0 +1,49 @@
+#ifndef HOST_SIM_TASK_H
+#define HOST_SIM_TASK_H
+
+#include "FreeRTOS.h"
+#include "../../shim/task.h"
+
+#define tskIDLE_PRIORITY        ((UBaseType_t) 0)
+
+typedef enum { eRunning = 0, eReady, eBlocked, eSuspended, eDeleted, eInvalid } eTaskState;
+
+typedef struct {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    uint32_t ulRunTimeCounter;                  // Thread CPU time in microseconds
+    StackType_t *pxStackBase;
+    uint16_t usStackHighWaterMark;              // Not measured: always 0
+    UBaseType_t uxCoreAffinityMask;
+} TaskStatus_t;
+
+BaseType_t xTaskCreate(TaskFunction_t pxCode, const char *pcName, uint32_t ulStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask);
+BaseType_t xTaskCreateAffinitySet(TaskFunction_t pxCode, const char *pcName, uint32_t ulStackDepth,
+                                  void *pvParameters, UBaseType_t uxPriority, UBaseType_t uxCoreAffinityMask,
+                                  TaskHandle_t *pxCreatedTask);
+void vTaskDelete(TaskHandle_t xTask);           /* NULL only: ends the calling thread */
+void vTaskStartScheduler(void);                 /* Never returns */
+
+void vTaskDelay(TickType_t xTicks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vSimTaskYield(void);
+#define taskYIELD()             vSimTaskYield()
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTask);
+
+/* No idle tasks: the CPU load of the simulation reads as 0 */
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t xCoreID);
+uint32_t ulTaskGetRunTimeCounter(TaskHandle_t xTask);
+
+UBaseType_t uxTaskGetNumberOfTasks(void);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pxTaskStatusArray, UBaseType_t uxArraySize,
+                                 uint32_t *pulTotalRunTime);
+
+#endif /* HOST_SIM_TASK_H */
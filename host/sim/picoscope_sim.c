@@ -0,0 +1,116 @@
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "net/web_server.h"
+#include "drivers/adc_dma.h"
+#include "core/scope_data.h"
+#include "core/dsp_task.h"
+#include "core/metrics.h"
+#include "core/log.h"
+#include "adc_dma_sim.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Host simulation of the firmware: src/picoscope.c without the board.
+ *
+ * The scope_data, DSP, frame queue, command, Mongoose, metrics and log
+ * modules are the firmware's own sources; FreeRTOS and the Pico SDK come from
+ * host/sim/include, the ADC from adc_dma_sim.c and the UDP stream from
+ * udp_stream_sim.c. The web UI, WebSocket stream, /metrics, capture
+ * downloads and SCPI (port 5025) work as on the device:
+ *
+ *   picoscope_sim [--signal sine|square|triangle|noise|dc] [--freq HZ]
+ *                 [--amplitude COUNTS] [--noise COUNTS] [--rate SPS]
+ *
+ * then open http://localhost:WEB_SERVER_PORT/.
+ */
+
+static uint32_t ulInitialRate = 100000;
+
+/* Task: ADC Data Acquisition (as in src/picoscope.c) */
+static void vAcquisitionTask(void *pv) {
+    (void) pv;
+    uint32_t pulCaptureTimestamp;
+
+    vAdcDmaInit();
+    vMetricsCyclesEnable();
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+    vAdcDmaSetSampleRate(ulInitialRate);
+    vAdcDmaStartContinous();
+
+    for (;;) {
+        uint16_t *dma_buffer = NULL;
+        AdcBufferHandle_t xDmaHandle;
+
+        if (bAdcDmaGetLatestBufferPtr(&dma_buffer, &pulCaptureTimestamp, &xDmaHandle)) {
+            uint32_t ulStart = ulMetricsCycles();
+            vScopeDataPublishBuffer(dma_buffer, pulCaptureTimestamp, xDmaHandle);
+            vMetricsStageAdd(METRICS_STAGE_PUBLISH, ulMetricsCycles() - ulStart);
+        }
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+}
+
+static void vInitTask(void *pv) {
+    (void) pv;
+    vScopeDataInit();
+
+    xTaskCreate(vLogTask, "Log", 1024, NULL, tskIDLE_PRIORITY, NULL);
+
+    static WifiCredentials_t xWifiCredentials = { .pcWifiName = "host", .pcWifiPass = "" };
+    xTaskCreateAffinitySet(vAcquisitionTask, "Acquisition", 4096, NULL, 3, 1u << 0, NULL);
+    xTaskCreateAffinitySet(vWebServerTask, "WebServer", 8192, &xWifiCredentials, 2, 1u << 0, NULL);
+    xTaskCreateAffinitySet(vDspTask, "DSP", 4096, NULL, 2, 1u << 1, NULL);
+
+    vDspSetFramesReadyHook(vWebServerWake);
+    vTaskDelete(NULL);
+}
+
+static void vUsage(const char *pcProg) {
+    fprintf(stderr, "usage: %s [--signal sine|square|triangle|noise|dc] [--freq HZ] [--amplitude COUNTS]\n"
+                    "          [--noise COUNTS] [--rate SPS]\n", pcProg);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    SimSignalConfig_t xSignal = { SIM_SIGNAL_SINE, 1000.0f, 1500, 16 };
+
+    for (int i = 1; i < argc; i++) {
+        const char *pcArg = argv[i];
+        const char *pcValue = i + 1 < argc ? argv[i + 1] : NULL;
+        if (pcValue == NULL) vUsage(argv[0]);
+        if (strcmp(pcArg, "--signal") == 0) {
+            int iSignal = iAdcDmaSimParseSignal(pcValue);
+            if (iSignal < 0) vUsage(argv[0]);
+            xSignal.eSignal = (SimSignal_e) iSignal;
+        } else if (strcmp(pcArg, "--freq") == 0) {
+            xSignal.fFrequencyHz = strtof(pcValue, NULL);
+        } else if (strcmp(pcArg, "--amplitude") == 0) {
+            xSignal.usAmplitude = (uint16_t) strtoul(pcValue, NULL, 0);
+        } else if (strcmp(pcArg, "--noise") == 0) {
+            xSignal.usNoise = (uint16_t) strtoul(pcValue, NULL, 0);
+        } else if (strcmp(pcArg, "--rate") == 0) {
+            ulInitialRate = (uint32_t) strtoul(pcValue, NULL, 0);
+        } else {
+            vUsage(argv[0]);
+        }
+        i++;
+    }
+
+    /* A peer closing mid-write must not end the process (lwIP reports EPIPE) */
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    vAdcDmaSimSetSignal(&xSignal);
+
+    printf("\n=== Picoscope (host simulation) ===\n");
+    xTaskCreate(vInitTask, "Init", 2048, NULL, 3, NULL);
+    vTaskStartScheduler();
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "net/udp_stream.h"
+#include "core/dsp_task.h"
+#include "core/log.h"
+
+#include "pico/stdlib.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* net/udp_stream.c on a BSD datagram socket instead of an lwIP pcb */
+
+_Static_assert(sizeof(UdpStreamHeader_t) == 16, "UDP stream header is 16 bytes on the wire");
+
+typedef struct {
+    bool      bActive;
+    struct sockaddr_in xAddr;
+    uint32_t  ulSeq;
+} UdpSubscriber_t;
+
+static UdpSubscriber_t xSubscribers[DSP_MAX_CLIENTS];
+static int iSocket = -1;
+static uint32_t ulDatagrams = 0;
+static uint32_t ulErrors = 0;
+
+static bool bEnsureSocket(void) {
+    if (iSocket < 0) iSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    return iSocket >= 0;
+}
+
+bool bUdpStreamSubscribe(uint8_t ucSlot, uint32_t ulAddr, uint16_t usPort) {
+    if (ucSlot >= DSP_MAX_CLIENTS || usPort == 0 || ulAddr == 0) return false;
+    if (!bEnsureSocket()) return false;
+    UdpSubscriber_t *pxSub = &xSubscribers[ucSlot];
+    memset(&pxSub->xAddr, 0, sizeof(pxSub->xAddr));
+    pxSub->xAddr.sin_family = AF_INET;
+    pxSub->xAddr.sin_addr.s_addr = ulAddr;
+    pxSub->xAddr.sin_port = htons(usPort);
+    pxSub->ulSeq = 0;
+    pxSub->bActive = true;
+    uint8_t ucIp[4];                    // ulAddr is in network order
+    memcpy(ucIp, &ulAddr, sizeof(ucIp));
+    LOG(LOG_UDP_SUBSCRIBED, ucSlot, ucIp[0], ucIp[1], ucIp[2], ucIp[3], usPort);
+    return true;
+}
+
+void vUdpStreamUnsubscribe(uint8_t ucSlot) {
+    if (ucSlot < DSP_MAX_CLIENTS) xSubscribers[ucSlot].bActive = false;
+}
+
+bool bUdpStreamActive(uint8_t ucSlot) {
+    return ucSlot < DSP_MAX_CLIENTS && xSubscribers[ucSlot].bActive;
+}
+
+bool bUdpStreamSend(uint8_t ucSlot, const uint8_t *pucFrame, uint16_t usLen) {
+    if (!bUdpStreamActive(ucSlot)) return false;
+    UdpSubscriber_t *pxSub = &xSubscribers[ucSlot];
+
+    UdpStreamHeader_t xHdr = {
+        .usMagic = UDP_STREAM_MAGIC,
+        .ucVersion = UDP_STREAM_VERSION,
+        .ucHeaderLen = sizeof(UdpStreamHeader_t),
+        .ulDatagramSeq = pxSub->ulSeq,
+        .ulSendUs = time_us_32(),
+        .usFrameLen = usLen,
+        .ucClient = ucSlot,
+    };
+    struct iovec xIov[2] = { { &xHdr, sizeof(xHdr) }, { (void *) pucFrame, usLen } };
+    struct msghdr xMsg = {
+        .msg_name = &pxSub->xAddr,
+        .msg_namelen = sizeof(pxSub->xAddr),
+        .msg_iov = xIov,
+        .msg_iovlen = 2,
+    };
+    ssize_t xSent = sendmsg(iSocket, &xMsg, MSG_DONTWAIT);
+
+    /* The sequence advances even on failure: the receiver sees it as loss */
+    pxSub->ulSeq++;
+    if (xSent != (ssize_t) (sizeof(xHdr) + usLen)) {
+        ulErrors++;
+        return false;
+    }
+    ulDatagrams++;
+    return true;
+}
+
+void vUdpStreamGetStats(uint32_t *pulDatagrams, uint32_t *pulErrors) {
+    if (pulDatagrams) *pulDatagrams = ulDatagrams;
+    if (pulErrors) *pulErrors = ulErrors;
+}
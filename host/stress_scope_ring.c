@@ -0,0 +1,255 @@
+/*
+ * Stress test for the scope_data consumer ring (src/core/scope_data.c)
+ *
+ * One producer thread plays the DMA ISR + acquisition task: it takes a free
+ * buffer from a pool of NUM_BUFFERS, fills every sample with a tag derived from
+ * the publish index and publishes it. Three consumer threads (one LATEST, two
+ * NEXT, one of them slow) pin blocks and check that:
+ *  - every sample of a pinned block still carries its tag when the consumer
+ *    is done with it (the producer never rewrites a pinned block),
+ *  - sequences only move forward, and for NEXT consumers in order modulo drops,
+ *  - consumed + dropped accounts for every sequence up to the last one seen,
+ *  - no DMA buffer is released twice or with a stale handle.
+ * Then it forces both races of the claim/pin handshake once, single-threaded,
+ * through SCOPE_DATA_RACE_HOOK:
+ *  - a reader between its scan and its pin loses the slot to a publish and
+ *    retries (ulRetries goes up, it gets the next block),
+ *  - a reader pins the producer's victim before it is hidden; the producer
+ *    backs off and the pinned block stays intact and handed out.
+ *
+ * Usage: stress_scope_ring [publishes]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "core/scope_data.h"
+
+#define CONSUMERS       SCOPE_MAX_CONSUMERS
+
+static uint16_t usPool[NUM_BUFFERS][ADC_BUFFER_SIZE];
+static uint32_t ulPoolBusy[NUM_BUFFERS];      /* 1 while handed to scope_data */
+static uint32_t ulPoolGen[NUM_BUFFERS];       /* Handle generation, as in adc_dma.c */
+static uint32_t ulFailures = 0;
+static uint32_t ulProducerDone = 0;
+static uint32_t ulPoolEmpty = 0;
+
+#define FAIL(...) do { __atomic_fetch_add(&ulFailures, 1u, __ATOMIC_RELAXED); fprintf(stderr, __VA_ARGS__); } while (0)
+
+/* Armed race step, run once from inside the next race window */
+typedef void (*RaceStep_t)(void);
+static RaceStep_t pxRaceStep = NULL;
+static int iRaceConsumer = -1;
+static ScopeBuffer_t xRaceBuf;
+static bool bRaceAcquired = false;
+
+void vScopeDataRaceHook(void) {
+    RaceStep_t pxStep = pxRaceStep;
+    if (pxStep == NULL) {
+        sched_yield();                      /* Threaded phase: widen the window */
+        return;
+    }
+    pxRaceStep = NULL;
+    pxStep();
+}
+
+static inline uint16_t usTag(uint32_t ulIndex, uint32_t ulSample) {
+    return (uint16_t) ((ulIndex * 2654435761u) >> 16) ^ (uint16_t) ulSample;
+}
+
+/* scope_data returns buffers through the ADC driver; here they go back to the pool */
+void vAdcDmaReleaseBuffer(AdcBufferHandle_t xHandle) {
+    uint8_t ucIndex = ADC_BUFFER_HANDLE_INDEX(xHandle);
+    if (ucIndex >= NUM_BUFFERS || (ulPoolGen[ucIndex] << 8) != (xHandle & ~0xFFu)) {
+        FAIL("released stale handle %08x\n", xHandle);
+        return;
+    }
+    if (!__atomic_exchange_n(&ulPoolBusy[ucIndex], 0u, __ATOMIC_ACQ_REL)) FAIL("buffer %u released twice\n", ucIndex);
+}
+
+static uint16_t *pusTakeBuffer(AdcBufferHandle_t *pxHandle) {
+    for (int i = 0; i < NUM_BUFFERS; i++) {
+        uint32_t ulExpected = 0;
+        if (__atomic_compare_exchange_n(&ulPoolBusy[i], &ulExpected, 1u, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            *pxHandle = (++ulPoolGen[i] << 8) | (uint32_t) i;
+            return usPool[i];
+        }
+    }
+    return NULL;
+}
+
+static void vPublish(uint32_t ulIndex) {
+    uint16_t *pusBuf;
+    AdcBufferHandle_t xHandle;
+    while ((pusBuf = pusTakeBuffer(&xHandle)) == NULL) {
+        ulPoolEmpty++;
+        sched_yield();
+    }
+    for (uint32_t i = 0; i < ADC_BUFFER_SIZE; i++) pusBuf[i] = usTag(ulIndex, i);
+    vScopeDataPublishBuffer(pusBuf, ulIndex, xHandle);
+}
+
+typedef struct {
+    const char     *pcName;
+    ScopeReadMode_e eMode;
+    uint32_t        ulHoldYields;    /* Yields while pinned, makes the consumer slow */
+    int             iId;
+    uint32_t        ulLastSeq;
+    uint32_t        ulChecked;
+} ConsumerCtx_t;
+
+static bool bCheckBlock(const ScopeBuffer_t *pxBuf) {
+    for (uint32_t i = 0; i < ADC_BUFFER_SIZE; i++) {
+        if (pxBuf->pusSamples[i] != usTag(pxBuf->ulTimestamp, i)) return false;
+    }
+    return true;
+}
+
+static bool bPoolBufferBusy(const uint16_t *pusSamples) {
+    return ulPoolBusy[(pusSamples - usPool[0]) / ADC_BUFFER_SIZE] != 0;
+}
+
+static void vRacePublish(void) {
+    vPublish(xRaceBuf.ulTimestamp);
+}
+
+static void vRaceAcquire(void) {
+    bRaceAcquired = bScopeDataAcquire(iRaceConsumer, &xRaceBuf, SCOPE_READ_NEXT);
+}
+
+/* Both consumers must lag the ring (nothing newer than the ring consumed) */
+static void vForceRaces(int iRetrier, int iPinner, uint32_t ulIndex) {
+    ScopeBuffer_t xBuf;
+    ScopeConsumerStats_t xBefore, xAfter;
+
+    /* Ring holds ulIndex+1 .. ulIndex+SLOTS, nobody pinned */
+    for (uint32_t i = 1; i <= SCOPE_RING_SLOTS; i++) vPublish(ulIndex + i);
+    uint32_t ulOldest = ulIndex + 1u;
+    ulIndex += SCOPE_RING_SLOTS;
+
+    /* Retry: the reader picked the oldest block, a publish claims it before the pin */
+    bScopeDataGetConsumerStats(iRetrier, &xBefore);
+    xRaceBuf.ulTimestamp = ++ulIndex;
+    pxRaceStep = vRacePublish;
+    if (!bScopeDataAcquire(iRetrier, &xBuf, SCOPE_READ_NEXT)) FAIL("race: retrier got nothing\n");
+    else if (xBuf.ulTimestamp != ulOldest + 1u) FAIL("race: retrier got %u, expected %u\n", xBuf.ulTimestamp, ulOldest + 1u);
+    else if (!bCheckBlock(&xBuf)) FAIL("race: retrier block corrupt\n");
+    bScopeDataGetConsumerStats(iRetrier, &xAfter);
+    if (pxRaceStep != NULL) FAIL("race: pin window never reached\n");
+    if (xAfter.ulRetries != xBefore.ulRetries + 1u) FAIL("race: %u retries, expected 1\n", xAfter.ulRetries - xBefore.ulRetries);
+    vScopeDataRelease(iRetrier);
+
+    /* Pin: a reader pins the producer's victim before it is hidden */
+    iRaceConsumer = iPinner;
+    bRaceAcquired = false;
+    pxRaceStep = vRaceAcquire;
+    vPublish(++ulIndex);
+    if (pxRaceStep != NULL) FAIL("race: claim window never reached\n");
+    if (!bRaceAcquired) {
+        FAIL("race: pinner got nothing\n");
+        return;
+    }
+    if (xRaceBuf.ulTimestamp != ulOldest + 1u) FAIL("race: pinner got %u, expected the victim %u\n", xRaceBuf.ulTimestamp, ulOldest + 1u);
+    if (!bPoolBufferBusy(xRaceBuf.pusSamples)) FAIL("race: pinned block released by the producer\n");
+    /* Cycle the pool: a wrongly released buffer gets refilled */
+    for (uint32_t i = 0; i < NUM_BUFFERS; i++) vPublish(++ulIndex);
+    if (!bCheckBlock(&xRaceBuf)) FAIL("race: pinned block overwritten\n");
+    vScopeDataRelease(iPinner);
+}
+
+static void *pvConsumer(void *pvArg) {
+    ConsumerCtx_t *pxCtx = (ConsumerCtx_t *) pvArg;
+    ScopeBuffer_t xBuf;
+
+    for (;;) {
+        bool bDone = __atomic_load_n(&ulProducerDone, __ATOMIC_ACQUIRE);
+        if (!bScopeDataAcquire(pxCtx->iId, &xBuf, pxCtx->eMode)) {
+            if (bDone) break;
+            sched_yield();
+            continue;
+        }
+
+        if (pxCtx->ulLastSeq != 0 && (int32_t) (xBuf.ulSequence - pxCtx->ulLastSeq) <= 0) {
+            FAIL("%s: sequence went from %u to %u\n", pxCtx->pcName, pxCtx->ulLastSeq, xBuf.ulSequence);
+        }
+        pxCtx->ulLastSeq = xBuf.ulSequence;
+
+        if (!bCheckBlock(&xBuf)) FAIL("%s: block %u corrupt on acquire\n", pxCtx->pcName, xBuf.ulSequence);
+        for (uint32_t i = 0; i < pxCtx->ulHoldYields; i++) sched_yield();
+        if (!bCheckBlock(&xBuf)) FAIL("%s: block %u overwritten while pinned\n", pxCtx->pcName, xBuf.ulSequence);
+        pxCtx->ulChecked++;
+
+        vScopeDataRelease(pxCtx->iId);
+        sched_yield();
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    uint32_t ulPublishes = (argc > 1) ? (uint32_t) strtoul(argv[1], NULL, 0) : 200000u;
+
+    vScopeDataInit();
+
+    ConsumerCtx_t xCtx[CONSUMERS] = {
+        { .pcName = "latest",    .eMode = SCOPE_READ_LATEST, .ulHoldYields = 2 },
+        { .pcName = "next",      .eMode = SCOPE_READ_NEXT,   .ulHoldYields = 0 },
+        { .pcName = "next-slow", .eMode = SCOPE_READ_NEXT,   .ulHoldYields = 16 },
+    };
+    pthread_t xThreads[CONSUMERS];
+    for (int i = 0; i < CONSUMERS; i++) {
+        xCtx[i].iId = iScopeDataRegisterConsumer(xCtx[i].pcName, NULL);
+        if (xCtx[i].iId < 0) { fprintf(stderr, "register %s failed\n", xCtx[i].pcName); return 1; }
+    }
+    if (iScopeDataRegisterConsumer("extra", NULL) >= 0) FAIL("registered more than SCOPE_MAX_CONSUMERS\n");
+    for (int i = 0; i < CONSUMERS; i++) pthread_create(&xThreads[i], NULL, pvConsumer, &xCtx[i]);
+
+    /* Producer: the timestamp carries the publish index so consumers can check tags */
+    for (uint32_t ulIndex = 1; ulIndex <= ulPublishes; ulIndex++) {
+        vPublish(ulIndex);
+        if ((ulIndex & 7u) == 0) sched_yield();
+    }
+    __atomic_store_n(&ulProducerDone, 1u, __ATOMIC_RELEASE);
+    for (int i = 0; i < CONSUMERS; i++) pthread_join(xThreads[i], NULL);
+
+    uint32_t ulPublished = ulPublishes - ulScopeDataPublishDrops();
+    printf("published %u of %u (%u dropped, all slots pinned), pool empty waits %u\n",
+           ulPublished, ulPublishes, ulScopeDataPublishDrops(), ulPoolEmpty);
+
+    uint32_t ulRetries = 0;
+    for (int i = 0; i < CONSUMERS; i++) {
+        ScopeConsumerStats_t xStats;
+        if (!bScopeDataGetConsumerStats(xCtx[i].iId, &xStats)) { FAIL("%s: no stats\n", xCtx[i].pcName); continue; }
+        printf("%-10s consumed %8u  dropped %8u  retries %6u  last seq %u\n", xCtx[i].pcName,
+               xStats.ulConsumed, xStats.ulDropped, xStats.ulRetries, xCtx[i].ulLastSeq);
+        ulRetries += xStats.ulRetries;
+        if (xStats.ulConsumed != xCtx[i].ulChecked) FAIL("%s: consumed count mismatch\n", xCtx[i].pcName);
+        if (xStats.ulConsumed + xStats.ulDropped != xCtx[i].ulLastSeq) {
+            FAIL("%s: consumed + dropped = %u, expected %u\n", xCtx[i].pcName,
+                 xStats.ulConsumed + xStats.ulDropped, xCtx[i].ulLastSeq);
+        }
+    }
+    /* Once everyone is idle the newest block is always acquirable */
+    if (xCtx[0].ulLastSeq != ulPublished) FAIL("latest consumer ended at %u, expected %u\n", xCtx[0].ulLastSeq, ulPublished);
+
+    uint32_t ulHeld = 0;
+    for (int i = 0; i < NUM_BUFFERS; i++) ulHeld += ulPoolBusy[i];
+    if (ulHeld > SCOPE_RING_SLOTS) FAIL("%u buffers still handed out, ring holds %u\n", ulHeld, (unsigned) SCOPE_RING_SLOTS);
+
+    /* Consumers are idle and caught up: the next ring's worth is all unread */
+    vForceRaces(xCtx[1].iId, xCtx[2].iId, ulPublishes);
+    ScopeConsumerStats_t xRetrier;
+    bScopeDataGetConsumerStats(xCtx[1].iId, &xRetrier);
+    printf("threaded retries %u, forced races done (retrier now at %u retries)\n", ulRetries, xRetrier.ulRetries);
+    if (xRetrier.ulRetries == 0) FAIL("no acquire ever retried\n");
+
+    if (ulFailures) {
+        printf("FAILED: %u errors\n", ulFailures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
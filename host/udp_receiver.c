@@ -0,0 +1,330 @@
+/*
+ * Receiver for the UDP frame stream (src/net/udp_stream.h)
+ *
+ * Listens on a UDP port and reports once a second: datagrams, lost and late
+ * (reordered) datagrams from the sequence numbers, malformed datagrams, frames
+ * that are not keyframes, and the one-way delay from the sender timestamp.
+ *
+ * The device clock is unrelated to ours, so against a device the delay is
+ * reported above the smallest one seen (jitter / queueing). With --selftest
+ * a sender thread on this host streams encoded frames (net/frame_codec.c) over
+ * loopback with the same clock, so the delay is absolute; it skips every
+ * SELFTEST_DROP_EVERY-th sequence number and swaps one pair of datagrams per
+ * SELFTEST_SWAP_EVERY, and the run fails if the receiver does not count
+ * exactly that.
+ *
+ * Usage: udp_receiver [--port N] [--seconds S] [--device HOST | --selftest]
+ *   --device HOST  subscribe through HOST's WebSocket (port 80, /ws) and keep
+ *                  it open while receiving; the stream stops when it closes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+
+#include "net/udp_stream.h"
+#include "net/frame_codec.h"
+
+#define DEFAULT_PORT            5005
+#define SELFTEST_FRAMES         5000u
+#define SELFTEST_RATE_HZ        1000u
+#define SELFTEST_POINTS         512u
+#define SELFTEST_DROP_EVERY     50u
+#define SELFTEST_SWAP_EVERY     200u
+
+static uint32_t ulNowUs(void) {
+    struct timespec xTs;
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return (uint32_t) ((uint64_t) xTs.tv_sec * 1000000u + (uint64_t) xTs.tv_nsec / 1000u);
+}
+
+/* ---- Statistics ---------------------------------------------------------- */
+
+typedef struct {
+    uint32_t ulDatagrams;
+    uint32_t ulLost;            // Sequence gaps not (yet) filled by late datagrams
+    uint32_t ulLate;            // Arrived after a higher sequence
+    uint32_t ulBad;             // Wrong magic/version/length
+    uint32_t ulNotKeyframe;     // Inter/keep-alive frames (cannot be decoded alone)
+    uint32_t ulRestarts;        // Sequence went back to 0 (new subscription)
+    uint32_t ulNextSeq;
+    bool     bStarted;
+    int32_t  lMinDelayUs;       // Smallest recv - send seen (clock offset estimate)
+    int64_t  llDelaySumUs;      // Over this report period
+    int32_t  lDelayMaxUs;
+    uint32_t ulDelayCount;
+    uint64_t ullAgeSumMs;       // Capture-to-encode age from the frame header
+} RxStats_t;
+
+static void vRecord(RxStats_t *pxStats, const uint8_t *pucData, size_t xLen, uint32_t ulRecvUs) {
+    UdpStreamHeader_t xHdr;
+    FrameHeader_t xFrame;
+    if (xLen < sizeof(xHdr)) { pxStats->ulBad++; return; }
+    memcpy(&xHdr, pucData, sizeof(xHdr));
+    if (xHdr.usMagic != UDP_STREAM_MAGIC || xHdr.ucVersion != UDP_STREAM_VERSION ||
+        xHdr.ucHeaderLen < sizeof(xHdr) || xHdr.ucHeaderLen + (size_t) xHdr.usFrameLen != xLen ||
+        xHdr.usFrameLen < sizeof(xFrame)) {
+        pxStats->ulBad++;
+        return;
+    }
+    memcpy(&xFrame, pucData + xHdr.ucHeaderLen, sizeof(xFrame));
+    if (xFrame.usMagic != FRAME_MAGIC || xFrame.ucHeaderLen + (size_t) xFrame.usPayloadLen != xHdr.usFrameLen) {
+        pxStats->ulBad++;
+        return;
+    }
+    pxStats->ulDatagrams++;
+    if (xFrame.ucFlags & (FRAME_FLAG_INTER | FRAME_FLAG_KEEPALIVE)) pxStats->ulNotKeyframe++;
+
+    uint32_t ulSeq = xHdr.ulDatagramSeq;
+    if (!pxStats->bStarted || (ulSeq == 0 && pxStats->ulNextSeq > 1)) {
+        if (pxStats->bStarted) pxStats->ulRestarts++;
+        pxStats->bStarted = true;
+        pxStats->ulNextSeq = ulSeq + 1;
+    } else if ((int32_t) (ulSeq - pxStats->ulNextSeq) >= 0) {
+        pxStats->ulLost += ulSeq - pxStats->ulNextSeq;
+        pxStats->ulNextSeq = ulSeq + 1;
+    } else {
+        pxStats->ulLate++;
+        if (pxStats->ulLost > 0) pxStats->ulLost--;
+    }
+
+    int32_t lDelay = (int32_t) (ulRecvUs - xHdr.ulSendUs);
+    if (pxStats->ulDatagrams == 1 || lDelay < pxStats->lMinDelayUs) pxStats->lMinDelayUs = lDelay;
+    pxStats->llDelaySumUs += lDelay;
+    if (pxStats->ulDelayCount == 0 || lDelay > pxStats->lDelayMaxUs) pxStats->lDelayMaxUs = lDelay;
+    pxStats->ulDelayCount++;
+    pxStats->ullAgeSumMs += xFrame.usAgeMs;
+}
+
+static void vReport(RxStats_t *pxStats, bool bSameClock) {
+    int32_t lBase = bSameClock ? 0 : pxStats->lMinDelayUs;
+    printf("%7u datagrams  %5u lost  %4u late  %3u bad  %3u not keyframe  %u restarts", pxStats->ulDatagrams,
+           pxStats->ulLost, pxStats->ulLate, pxStats->ulBad, pxStats->ulNotKeyframe, pxStats->ulRestarts);
+    if (pxStats->ulDelayCount > 0) {
+        printf("  | delay%s avg %lld us max %d us, capture age avg %llu ms", bSameClock ? "" : " above min",
+               (long long) (pxStats->llDelaySumUs / pxStats->ulDelayCount - lBase),
+               pxStats->lDelayMaxUs - lBase,
+               (unsigned long long) (pxStats->ullAgeSumMs / pxStats->ulDelayCount));
+    }
+    printf("\n");
+    fflush(stdout);
+    pxStats->llDelaySumUs = 0;
+    pxStats->ulDelayCount = 0;
+    pxStats->ullAgeSumMs = 0;
+}
+
+/* ---- Subscription through the device's WebSocket ------------------------- */
+
+static int iWebsocketSubscribe(const char *pcHost, uint16_t usPort) {
+    struct addrinfo xHints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM }, *pxRes = NULL;
+    if (getaddrinfo(pcHost, "80", &xHints, &pxRes) != 0 || pxRes == NULL) {
+        fprintf(stderr, "cannot resolve %s\n", pcHost);
+        return -1;
+    }
+    int iFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (iFd < 0 || connect(iFd, pxRes->ai_addr, pxRes->ai_addrlen) != 0) {
+        fprintf(stderr, "cannot connect to %s:80: %s\n", pcHost, strerror(errno));
+        freeaddrinfo(pxRes);
+        if (iFd >= 0) close(iFd);
+        return -1;
+    }
+    freeaddrinfo(pxRes);
+
+    char acReq[256];
+    int n = snprintf(acReq, sizeof(acReq),
+                     "GET /ws HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", pcHost);
+    char acResp[512];
+    size_t xGot = 0;
+    if (send(iFd, acReq, (size_t) n, 0) != n) goto fail;
+    while (xGot < sizeof(acResp) - 1) {
+        ssize_t r = recv(iFd, acResp + xGot, 1, 0);   /* Byte-wise: stop right at the end of the headers */
+        if (r <= 0) goto fail;
+        xGot++;
+        acResp[xGot] = '\0';
+        if (xGot >= 4 && memcmp(acResp + xGot - 4, "\r\n\r\n", 4) == 0) break;
+    }
+    if (strncmp(acResp, "HTTP/1.1 101", 12) != 0) goto fail;
+
+    /* Client frames are masked; the command is short enough for the 7-bit length */
+    char acCmd[64];
+    int iLen = snprintf(acCmd, sizeof(acCmd), "{\"cmd\":\"udp_subscribe\",\"value\":%u}", usPort);
+    uint8_t ucFrame[2 + 4 + sizeof(acCmd)];
+    const uint8_t ucMask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    ucFrame[0] = 0x81;
+    ucFrame[1] = (uint8_t) (0x80 | iLen);
+    memcpy(&ucFrame[2], ucMask, 4);
+    for (int i = 0; i < iLen; i++) ucFrame[6 + i] = (uint8_t) acCmd[i] ^ ucMask[i & 3];
+    if (send(iFd, ucFrame, (size_t) (6 + iLen), 0) != 6 + iLen) goto fail;
+
+    /* Frames sent before the switch and command replies are read and dropped */
+    fcntl(iFd, F_SETFL, fcntl(iFd, F_GETFL) | O_NONBLOCK);
+    printf("subscribed via ws://%s/ws, streaming to port %u\n", pcHost, usPort);
+    return iFd;
+
+fail:
+    fprintf(stderr, "WebSocket handshake with %s failed\n", pcHost);
+    close(iFd);
+    return -1;
+}
+
+/* ---- Loopback sender (--selftest) ---------------------------------------- */
+
+typedef struct {
+    uint16_t usPort;
+    uint32_t ulDropped;
+    uint32_t ulSwapped;
+} SelftestCtx_t;
+
+static void vSendDatagram(int iFd, const struct sockaddr_in *pxDst, const uint8_t *pucData, size_t xLen) {
+    if (sendto(iFd, pucData, xLen, 0, (const struct sockaddr *) pxDst, sizeof(*pxDst)) != (ssize_t) xLen) {
+        perror("sendto");
+    }
+}
+
+static void *pvSelftestSender(void *pvArg) {
+    SelftestCtx_t *pxCtx = (SelftestCtx_t *) pvArg;
+    int iFd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in xDst = { .sin_family = AF_INET, .sin_port = htons(pxCtx->usPort) };
+    xDst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    static uint16_t usSamples[SELFTEST_POINTS];
+    static uint8_t ucHeld[sizeof(UdpStreamHeader_t) + FRAME_MAX_SIZE(SELFTEST_POINTS)];
+    size_t xHeldLen = 0;
+
+    for (uint32_t ulSeq = 0; ulSeq < SELFTEST_FRAMES; ulSeq++) {
+        uint8_t ucDgram[sizeof(UdpStreamHeader_t) + FRAME_MAX_SIZE(SELFTEST_POINTS)];
+        for (uint32_t i = 0; i < SELFTEST_POINTS; i++) {
+            usSamples[i] = (uint16_t) (2048 + ((i * 37u + ulSeq * 11u) % 1500u));
+        }
+        FrameInfo_t xInfo = {
+            .ulSequence = ulSeq, .ulTimestampMs = ulSeq, .ulAgeMs = 1, .ulSampleRateHz = 100000,
+            .fTimePerDivMs = 1.0f, .lTriggerPoint = -1, .usVertLo = 0, .usVertHi = 4095,
+        };
+        size_t xFrameLen = xFrameEncode(&xInfo, usSamples, SELFTEST_POINTS, FRAME_ENC_PACK12, 0, NULL,
+                                        ucDgram + sizeof(UdpStreamHeader_t),
+                                        sizeof(ucDgram) - sizeof(UdpStreamHeader_t));
+        UdpStreamHeader_t xHdr = {
+            .usMagic = UDP_STREAM_MAGIC, .ucVersion = UDP_STREAM_VERSION,
+            .ucHeaderLen = sizeof(UdpStreamHeader_t), .ulDatagramSeq = ulSeq,
+            .ulSendUs = ulNowUs(), .usFrameLen = (uint16_t) xFrameLen,
+        };
+        memcpy(ucDgram, &xHdr, sizeof(xHdr));
+        size_t xLen = sizeof(xHdr) + xFrameLen;
+
+        /* The last one always goes out: a trailing gap is undetectable */
+        if (ulSeq % SELFTEST_DROP_EVERY == SELFTEST_DROP_EVERY - 1 && ulSeq + 1 < SELFTEST_FRAMES) {
+            pxCtx->ulDropped++;
+        } else if (ulSeq % SELFTEST_SWAP_EVERY == 1) {
+            memcpy(ucHeld, ucDgram, xLen);          /* Goes out after the next one */
+            xHeldLen = xLen;
+        } else {
+            vSendDatagram(iFd, &xDst, ucDgram, xLen);
+            if (xHeldLen) {
+                vSendDatagram(iFd, &xDst, ucHeld, xHeldLen);
+                xHeldLen = 0;
+                pxCtx->ulSwapped++;
+            }
+        }
+        usleep(1000000u / SELFTEST_RATE_HZ);
+    }
+    close(iFd);
+    return NULL;
+}
+
+/* ---- Main ---------------------------------------------------------------- */
+
+int main(int argc, char **argv) {
+    uint16_t usPort = DEFAULT_PORT;
+    uint32_t ulSeconds = 0;
+    const char *pcDevice = NULL;
+    bool bSelftest = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) usPort = (uint16_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) ulSeconds = (uint32_t) atoi(argv[++i]);
+        else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) pcDevice = argv[++i];
+        else if (strcmp(argv[i], "--selftest") == 0) bSelftest = true;
+        else {
+            fprintf(stderr, "usage: %s [--port N] [--seconds S] [--device HOST | --selftest]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int iFd = socket(AF_INET, SOCK_DGRAM, 0);
+    int iRcvBuf = 1 << 20;
+    setsockopt(iFd, SOL_SOCKET, SO_RCVBUF, &iRcvBuf, sizeof(iRcvBuf));
+    struct sockaddr_in xAddr = { .sin_family = AF_INET, .sin_port = htons(usPort) };
+    xAddr.sin_addr.s_addr = htonl(bSelftest ? INADDR_LOOPBACK : INADDR_ANY);
+    if (iFd < 0 || bind(iFd, (struct sockaddr *) &xAddr, sizeof(xAddr)) != 0) {
+        fprintf(stderr, "cannot bind UDP port %u: %s\n", usPort, strerror(errno));
+        return 1;
+    }
+
+    int iWs = -1;
+    if (pcDevice != NULL && (iWs = iWebsocketSubscribe(pcDevice, usPort)) < 0) return 1;
+
+    SelftestCtx_t xCtx = { .usPort = usPort };
+    pthread_t xSender;
+    if (bSelftest) pthread_create(&xSender, NULL, pvSelftestSender, &xCtx);
+
+    RxStats_t xStats = {0};
+    uint32_t ulStartUs = ulNowUs(), ulLastReportUs = ulStartUs;
+    uint32_t ulIdleMs = 0;
+    static uint8_t ucBuf[65536];
+
+    for (;;) {
+        struct pollfd xFds[2] = { { .fd = iFd, .events = POLLIN }, { .fd = iWs, .events = POLLIN } };
+        int iReady = poll(xFds, iWs >= 0 ? 2 : 1, 100);
+        if (iReady > 0 && (xFds[0].revents & POLLIN)) {
+            ssize_t r = recv(iFd, ucBuf, sizeof(ucBuf), 0);
+            if (r >= 0) vRecord(&xStats, ucBuf, (size_t) r, ulNowUs());
+            ulIdleMs = 0;
+        } else if (iReady == 0) {
+            ulIdleMs += 100;
+        }
+        if (iWs >= 0 && (xFds[1].revents & (POLLIN | POLLHUP))) {
+            ssize_t r;
+            while ((r = recv(iWs, ucBuf, sizeof(ucBuf), 0)) > 0) {}
+            if (r == 0) {
+                printf("WebSocket closed by the device\n");
+                break;
+            }
+        }
+
+        uint32_t ulNow = ulNowUs();
+        if (ulNow - ulLastReportUs >= 1000000u) {
+            ulLastReportUs = ulNow;
+            vReport(&xStats, bSelftest);
+        }
+        if (ulSeconds && ulNow - ulStartUs >= ulSeconds * 1000000u) break;
+        /* Selftest: done once the sender finished and the socket stayed quiet */
+        if (bSelftest && ulIdleMs >= 500 && xStats.ulDatagrams > 0) break;
+    }
+    vReport(&xStats, bSelftest);
+    if (iWs >= 0) close(iWs);
+    close(iFd);
+
+    if (bSelftest) {
+        pthread_join(xSender, NULL);
+        uint32_t ulExpected = SELFTEST_FRAMES - xCtx.ulDropped;
+        bool bOk = xStats.ulDatagrams == ulExpected && xStats.ulLost == xCtx.ulDropped &&
+                   xStats.ulLate == xCtx.ulSwapped && xStats.ulBad == 0 && xStats.ulNotKeyframe == 0;
+        printf("selftest: sent %u, dropped %u, swapped %u -> received %u, lost %u, late %u: %s\n",
+               ulExpected, xCtx.ulDropped, xCtx.ulSwapped, xStats.ulDatagrams, xStats.ulLost, xStats.ulLate,
+               bOk ? "OK" : "FAILED");
+        return bOk ? 0 : 1;
+    }
+    return 0;
+}
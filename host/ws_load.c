@@ -0,0 +1,548 @@
+/*
+ * WebSocket load generator and soak test (src/net/mg_handler.h)
+ *
+ * Opens a mix of WebSocket clients against /ws of the host simulation
+ * (picoscope_sim, port 8080) or a device (--port 80) and keeps them busy:
+ *
+ *  - fast     reads everything as soon as it arrives
+ *  - slow     small receive buffer, reads at most --slow-kbps
+ *  - stalled  small receive buffer, never reads after the handshake
+ *
+ * With --storm HZ every fast and slow client also sends HZ commands a second
+ * like a user dragging sliders: mostly binary trigger_level (net/ws_command.h),
+ * every 10th a JSON vertical_scale / zoom_center and every 50th a timebase
+ * change, which restarts the ADC at a new rate.
+ *
+ * Every reading client pings once a second (echoed by the server) and asks
+ * for "client_stats"; the first one also asks for "metrics". Each --report
+ * period one JSON line goes to stdout:
+ *
+ *   {"t_s":10.0,"heap_free":..,"heap_min_free":..,"clients":[{"id":0,"type":"fast",
+ *    "connected":true,"fps":..,"kbps":..,"age_avg_ms":..,"age_max_ms":..,"lag_max_ms":..,"rtt_ms":..,
+ *    "rtt_max_ms":..,"gaps":..,"server_dropped":..,"server_queued":..,"cmds":..,
+ *    "replies":..,"reconnects":..},...]}
+ *
+ * fps, kbps, age, lag and rtt are per period. age is FrameHeader_t.usAgeMs,
+ * the capture-to-send age the server stamps; lag is arrival time minus
+ * capture timestamp, relative to the best seen on the connection, so it also
+ * covers time spent in socket buffers (large on a PC, small with lwIP).
+ * gaps (main-view sequence numbers never received), server_dropped (the
+ * server's own count for the connection), cmds, replies and reconnects are
+ * totals. A connection the server closes is reopened after a second; one
+ * beyond WS_MAX_CLIENTS stays open without frames and shows 0 fps. The last
+ * line, after --seconds or Ctrl-C, has "final":true.
+ *
+ * Usage: ws_load [--host H] [--port N] [--fast N] [--slow N] [--stalled N]
+ *                [--storm HZ] [--slow-kbps N] [--seconds S] [--report S]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "net/frame_codec.h"
+#include "net/ws_command.h"
+
+#define MAX_CLIENTS             64
+#define RX_BUFFER_SIZE          (64u * 1024u)
+#define SMALL_RCVBUF            4096        /* Slow and stalled readers: back-pressure early */
+#define RECONNECT_MS            1000u
+#define PING_PERIOD_MS          1000u
+
+typedef enum { CLIENT_FAST = 0, CLIENT_SLOW, CLIENT_STALLED } ClientType_e;
+
+static const char *const pcTypeNames[] = { "fast", "slow", "stalled" };
+
+typedef struct {
+    /* Period counters, reset at every report */
+    uint32_t ulFrames;
+    uint64_t ullBytes;
+    uint64_t ullAgeSumMs;
+    uint32_t ulAgeMaxMs;
+    uint32_t ulLagMaxMs;
+    uint32_t ulRttLastUs;
+    uint32_t ulRttMaxUs;
+} PeriodStats_t;
+
+typedef struct {
+    ClientType_e eType;
+    int iFd;                         // -1 while disconnected
+    uint64_t ullReconnectAtMs;
+    uint8_t *pucRx;
+    size_t xRxLen;
+    double dReadBudget;              // Slow readers: bytes they may read now
+    uint64_t ullLastReadMs;
+    uint64_t ullNextPingMs;
+    uint64_t ullNextCmdUs;
+    uint32_t ulCmdIndex;
+
+    bool bSeqValid;
+    uint32_t ulNextSeq;
+    bool bLagValid;
+    int64_t llLagBaseMs;             // Smallest (arrival - capture timestamp) seen on this connection
+
+    PeriodStats_t xPeriod;
+    uint32_t ulGaps;
+    uint32_t ulServerDropped;
+    uint32_t ulServerQueued;
+    uint32_t ulCmds;
+    uint32_t ulReplies;
+    uint32_t ulReconnects;
+    uint32_t ulFramesTotal;
+} Client_t;
+
+static Client_t xClients[MAX_CLIENTS];
+static size_t xClientCount = 0;
+
+static const char *pcHost = "127.0.0.1";
+static const char *pcPort = "8080";
+static uint32_t ulStormHz = 0;
+static uint32_t ulSlowBytesPerS = 32000u / 8u;       /* --slow-kbps 32 */
+static uint32_t ulHeapFree = 0;
+static uint32_t ulHeapMinFree = 0;
+
+static volatile sig_atomic_t bStop = 0;
+
+static void vOnSignal(int iSig) {
+    (void) iSig;
+    bStop = 1;
+}
+
+static uint64_t ullNowUs(void) {
+    struct timespec xTs;
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return (uint64_t) xTs.tv_sec * 1000000u + (uint64_t) xTs.tv_nsec / 1000u;
+}
+
+static uint64_t ullNowMs(void) {
+    return ullNowUs() / 1000u;
+}
+
+/* ---- WebSocket client side ----------------------------------------------- */
+
+static int iConnect(ClientType_e eType) {
+    struct addrinfo xHints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM }, *pxRes = NULL;
+    if (getaddrinfo(pcHost, pcPort, &xHints, &pxRes) != 0 || pxRes == NULL) return -1;
+    int iFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (iFd < 0) {
+        freeaddrinfo(pxRes);
+        return -1;
+    }
+    if (eType != CLIENT_FAST) {
+        int iBuf = SMALL_RCVBUF;
+        setsockopt(iFd, SOL_SOCKET, SO_RCVBUF, &iBuf, sizeof(iBuf));
+    }
+    int iOne = 1;
+    setsockopt(iFd, IPPROTO_TCP, TCP_NODELAY, &iOne, sizeof(iOne));
+    if (connect(iFd, pxRes->ai_addr, pxRes->ai_addrlen) != 0) {
+        freeaddrinfo(pxRes);
+        close(iFd);
+        return -1;
+    }
+    freeaddrinfo(pxRes);
+
+    char acReq[256];
+    int n = snprintf(acReq, sizeof(acReq),
+                     "GET /ws HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                     "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", pcHost);
+    char acResp[512];
+    size_t xGot = 0;
+    if (send(iFd, acReq, (size_t) n, MSG_NOSIGNAL) != n) goto fail;
+    while (xGot < sizeof(acResp) - 1) {
+        ssize_t r = recv(iFd, acResp + xGot, 1, 0);   /* Byte-wise: stop right at the end of the headers */
+        if (r <= 0) goto fail;
+        xGot++;
+        acResp[xGot] = '\0';
+        if (xGot >= 4 && memcmp(acResp + xGot - 4, "\r\n\r\n", 4) == 0) break;
+    }
+    if (strncmp(acResp, "HTTP/1.1 101", 12) != 0) goto fail;
+
+    fcntl(iFd, F_SETFL, fcntl(iFd, F_GETFL) | O_NONBLOCK);
+    return iFd;
+
+fail:
+    close(iFd);
+    return -1;
+}
+
+/* Masked client message; false if the socket did not take all of it */
+static bool bWsSend(Client_t *pxClient, uint8_t ucOpcode, const void *pvData, size_t xLen) {
+    if (pxClient->iFd < 0 || xLen > 0xFFFFu) return false;
+    uint8_t ucMsg[8 + 256];
+    if (xLen > sizeof(ucMsg) - 8) return false;
+    const uint8_t ucMask[4] = { 0x5A, 0xC3, 0x17, 0x9E };
+    size_t n = 0;
+    ucMsg[n++] = (uint8_t) (0x80u | ucOpcode);
+    if (xLen < 126) {
+        ucMsg[n++] = (uint8_t) (0x80u | xLen);
+    } else {
+        ucMsg[n++] = 0x80u | 126u;
+        ucMsg[n++] = (uint8_t) (xLen >> 8);
+        ucMsg[n++] = (uint8_t) xLen;
+    }
+    memcpy(&ucMsg[n], ucMask, 4);
+    n += 4;
+    for (size_t i = 0; i < xLen; i++) ucMsg[n + i] = ((const uint8_t *) pvData)[i] ^ ucMask[i & 3];
+    n += xLen;
+    /* Commands are tiny; a socket too full to take one counts as not sent */
+    return send(pxClient->iFd, ucMsg, n, MSG_NOSIGNAL | MSG_DONTWAIT) == (ssize_t) n;
+}
+
+static bool bWsSendText(Client_t *pxClient, const char *pcText) {
+    return bWsSend(pxClient, 0x1u, pcText, strlen(pcText));
+}
+
+static void vDisconnect(Client_t *pxClient) {
+    if (pxClient->iFd >= 0) close(pxClient->iFd);
+    pxClient->iFd = -1;
+    pxClient->xRxLen = 0;
+    pxClient->bSeqValid = false;
+    pxClient->bLagValid = false;
+    pxClient->ullReconnectAtMs = ullNowMs() + RECONNECT_MS;
+}
+
+static void vTryConnect(Client_t *pxClient) {
+    uint64_t ullNow = ullNowMs();
+    if (pxClient->iFd >= 0 || ullNow < pxClient->ullReconnectAtMs) return;
+    pxClient->iFd = iConnect(pxClient->eType);
+    if (pxClient->iFd < 0) {
+        pxClient->ullReconnectAtMs = ullNow + RECONNECT_MS;
+        return;
+    }
+    pxClient->ullLastReadMs = ullNow;
+    pxClient->dReadBudget = 0.0;
+    pxClient->ullNextPingMs = ullNow;
+    pxClient->ullNextCmdUs = ullNowUs();
+}
+
+/* ---- Received messages --------------------------------------------------- */
+
+static uint32_t ulJsonNumber(const char *pcJson, const char *pcKey) {
+    const char *p = strstr(pcJson, pcKey);
+    return p ? (uint32_t) strtoul(p + strlen(pcKey), NULL, 10) : 0;
+}
+
+static void vOnText(Client_t *pxClient, char *pcText, size_t xLen) {
+    pcText[xLen] = '\0';                /* The frame header before it was already consumed */
+    if (xLen > 5 && memcmp(pcText, "ping ", 5) == 0) {
+        uint64_t ullSent = strtoull(pcText + 5, NULL, 10);
+        uint32_t ulRtt = (uint32_t) (ullNowUs() - ullSent);
+        pxClient->xPeriod.ulRttLastUs = ulRtt;
+        if (ulRtt > pxClient->xPeriod.ulRttMaxUs) pxClient->xPeriod.ulRttMaxUs = ulRtt;
+        return;
+    }
+    if (strstr(pcText, "\"clients\":[") != NULL) {
+        const char *pcSelf = strstr(pcText, "\"self\":true");
+        if (pcSelf != NULL) {
+            pxClient->ulServerDropped = ulJsonNumber(pcSelf, "\"dropped\":");
+            pxClient->ulServerQueued = ulJsonNumber(pcSelf, "\"queued\":");
+        }
+        return;
+    }
+    if (strstr(pcText, "\"metrics\":") != NULL) {
+        ulHeapFree = ulJsonNumber(pcText, "\"heap_free\":");
+        ulHeapMinFree = ulJsonNumber(pcText, "\"heap_min_free\":");
+        return;
+    }
+    pxClient->ulReplies++;
+}
+
+/* A binary message holds one or more frames back to back (batching) */
+static void vOnBinary(Client_t *pxClient, const uint8_t *pucData, size_t xLen) {
+    int64_t llArrivalMs = (int64_t) ullNowMs();
+    while (xLen >= sizeof(FrameHeader_t)) {
+        FrameHeader_t xHdr;
+        memcpy(&xHdr, pucData, sizeof(xHdr));
+        size_t xFrame = (size_t) xHdr.ucHeaderLen + xHdr.usPayloadLen;
+        if (xHdr.usMagic != FRAME_MAGIC || xHdr.ucHeaderLen < sizeof(xHdr) || xFrame > xLen) break;
+
+        pxClient->xPeriod.ulFrames++;
+        pxClient->ulFramesTotal++;
+        pxClient->xPeriod.ullAgeSumMs += xHdr.usAgeMs;
+        if (xHdr.usAgeMs > pxClient->xPeriod.ulAgeMaxMs) pxClient->xPeriod.ulAgeMaxMs = xHdr.usAgeMs;
+
+        /* Clocks are unrelated: lag is relative to the best delivery seen so far */
+        int64_t llOffset = llArrivalMs - (int64_t) xHdr.ulTimestampMs;
+        if (!pxClient->bLagValid || llOffset < pxClient->llLagBaseMs) {
+            pxClient->llLagBaseMs = llOffset;
+            pxClient->bLagValid = true;
+        }
+        uint32_t ulLag = (uint32_t) (llOffset - pxClient->llLagBaseMs);
+        if (ulLag > pxClient->xPeriod.ulLagMaxMs) pxClient->xPeriod.ulLagMaxMs = ulLag;
+
+        /* Every capture the DSP task processes gets the next sequence number */
+        if (xHdr.ucView == FRAME_VIEW_MAIN) {
+            if (pxClient->bSeqValid && (int32_t) (xHdr.ulSequence - pxClient->ulNextSeq) > 0) {
+                pxClient->ulGaps += xHdr.ulSequence - pxClient->ulNextSeq;
+            }
+            pxClient->ulNextSeq = xHdr.ulSequence + 1u;
+            pxClient->bSeqValid = true;
+        }
+        pucData += xFrame;
+        xLen -= xFrame;
+    }
+}
+
+/* Parse complete messages from the receive buffer; false on a protocol error */
+static bool bProcessRx(Client_t *pxClient) {
+    size_t xPos = 0;
+    while (pxClient->xRxLen - xPos >= 2) {
+        uint8_t *p = pxClient->pucRx + xPos;
+        size_t xAvail = pxClient->xRxLen - xPos;
+        uint8_t ucOpcode = p[0] & 0x0Fu;
+        uint64_t ullLen = p[1] & 0x7Fu;
+        size_t xHdr = 2;
+        if (p[1] & 0x80u) return false;         /* Server messages are never masked */
+        if (ullLen == 126) {
+            if (xAvail < 4) break;
+            ullLen = ((uint64_t) p[2] << 8) | p[3];
+            xHdr = 4;
+        } else if (ullLen == 127) {
+            if (xAvail < 10) break;
+            ullLen = 0;
+            for (int i = 0; i < 8; i++) ullLen = (ullLen << 8) | p[2 + i];
+            xHdr = 10;
+        }
+        if (ullLen + xHdr + 1u > RX_BUFFER_SIZE) return false;
+        if (xAvail < xHdr + ullLen) break;
+
+        /* Text is terminated in place: shift by one byte into the consumed header */
+        if (ucOpcode == 0x1u) {
+            memmove(p + xHdr - 1, p + xHdr, (size_t) ullLen);
+            vOnText(pxClient, (char *) p + xHdr - 1, (size_t) ullLen);
+        } else if (ucOpcode == 0x2u) {
+            vOnBinary(pxClient, p + xHdr, (size_t) ullLen);
+        } else if (ucOpcode == 0x8u) {
+            return false;
+        }
+        xPos += xHdr + (size_t) ullLen;
+    }
+    if (xPos > 0) {
+        memmove(pxClient->pucRx, pxClient->pucRx + xPos, pxClient->xRxLen - xPos);
+        pxClient->xRxLen -= xPos;
+    }
+    return true;
+}
+
+static void vRead(Client_t *pxClient) {
+    size_t xWant = RX_BUFFER_SIZE - pxClient->xRxLen;
+    if (pxClient->eType == CLIENT_SLOW) {
+        uint64_t ullNow = ullNowMs();
+        pxClient->dReadBudget += (double) (ullNow - pxClient->ullLastReadMs) * ulSlowBytesPerS / 1000.0;
+        if (pxClient->dReadBudget > ulSlowBytesPerS) pxClient->dReadBudget = ulSlowBytesPerS;
+        pxClient->ullLastReadMs = ullNow;
+        if (pxClient->dReadBudget < 1.0) return;
+        if ((double) xWant > pxClient->dReadBudget) xWant = (size_t) pxClient->dReadBudget;
+    }
+    ssize_t r = recv(pxClient->iFd, pxClient->pucRx + pxClient->xRxLen, xWant, 0);
+    if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        pxClient->ulReconnects++;
+        vDisconnect(pxClient);
+        return;
+    }
+    if (r < 0) return;
+    pxClient->xRxLen += (size_t) r;
+    pxClient->xPeriod.ullBytes += (uint64_t) r;
+    if (pxClient->eType == CLIENT_SLOW) pxClient->dReadBudget -= (double) r;
+    if (!bProcessRx(pxClient)) {
+        pxClient->ulReconnects++;
+        vDisconnect(pxClient);
+    }
+}
+
+/* ---- Traffic generation -------------------------------------------------- */
+
+static void vSendStormCommand(Client_t *pxClient) {
+    uint32_t k = pxClient->ulCmdIndex++;
+    char acCmd[96];
+    bool bSent;
+    if (k % 50u == 49u) {
+        static const float fTimebases[] = { 0.0005f, 0.001f, 0.002f, 0.005f };
+        snprintf(acCmd, sizeof(acCmd), "{\"cmd\":\"timebase_scale\",\"value\":%g}", (double) fTimebases[(k / 50u) % 4u]);
+        bSent = bWsSendText(pxClient, acCmd);
+    } else if (k % 10u == 9u) {
+        if ((k / 10u) & 1u) {
+            snprintf(acCmd, sizeof(acCmd), "{\"cmd\":\"vertical_scale\",\"value\":%.2f}", 0.1 + 0.05 * (double) (k % 7u));
+        } else {
+            snprintf(acCmd, sizeof(acCmd), "{\"cmd\":\"zoom_center\",\"value\":%.2f}", 0.5 + 0.4 * sin((double) k * 0.05));
+        }
+        bSent = bWsSendText(pxClient, acCmd);
+    } else {
+        /* Slider drag: trigger level sweeping around mid-scale */
+        uint8_t ucMsg[WS_COMMAND_BINARY_LEN];
+        float fLevel = (float) (1.65 + 0.5 * sin((double) k * 0.1));
+        ucMsg[0] = WS_OP_TRIGGER_LEVEL;
+        memcpy(&ucMsg[1], &fLevel, sizeof(fLevel));         /* Little endian host */
+        bSent = bWsSend(pxClient, 0x2u, ucMsg, sizeof(ucMsg));
+    }
+    if (bSent) pxClient->ulCmds++;
+}
+
+static void vGenerate(Client_t *pxClient, bool bMetrics) {
+    if (pxClient->iFd < 0 || pxClient->eType == CLIENT_STALLED) return;
+    uint64_t ullNow = ullNowMs();
+    if (ullNow >= pxClient->ullNextPingMs) {
+        char acPing[32];
+        snprintf(acPing, sizeof(acPing), "ping %llu", (unsigned long long) ullNowUs());
+        bWsSendText(pxClient, acPing);
+        bWsSendText(pxClient, "{\"cmd\":\"client_stats\"}");
+        if (bMetrics) bWsSendText(pxClient, "{\"cmd\":\"metrics\"}");
+        pxClient->ullNextPingMs = ullNow + PING_PERIOD_MS;
+    }
+    if (ulStormHz > 0) {
+        uint64_t ullNowU = ullNowUs();
+        uint64_t ullPeriod = 1000000u / ulStormHz;
+        for (int i = 0; i < 8 && ullNowU >= pxClient->ullNextCmdUs; i++) {
+            vSendStormCommand(pxClient);
+            pxClient->ullNextCmdUs += ullPeriod;
+        }
+        if (ullNowU >= pxClient->ullNextCmdUs) pxClient->ullNextCmdUs = ullNowU + ullPeriod;   /* Fell behind */
+    }
+}
+
+/* ---- Report -------------------------------------------------------------- */
+
+static void vReport(double dElapsedS, double dPeriodS, bool bFinal) {
+    printf("{\"t_s\":%.1f,%s\"heap_free\":%u,\"heap_min_free\":%u,\"clients\":[",
+           dElapsedS, bFinal ? "\"final\":true," : "", ulHeapFree, ulHeapMinFree);
+    for (size_t i = 0; i < xClientCount; i++) {
+        Client_t *pxClient = &xClients[i];
+        PeriodStats_t *pxP = &pxClient->xPeriod;
+        /* The final line covers the whole run for fps */
+        double dFps = bFinal ? pxClient->ulFramesTotal / dElapsedS : pxP->ulFrames / dPeriodS;
+        printf("%s{\"id\":%zu,\"type\":\"%s\",\"connected\":%s,\"fps\":%.1f,\"kbps\":%.1f,"
+               "\"age_avg_ms\":%.1f,\"age_max_ms\":%u,\"lag_max_ms\":%u,\"rtt_ms\":%.1f,\"rtt_max_ms\":%.1f,\"gaps\":%u,"
+               "\"server_dropped\":%u,\"server_queued\":%u,\"cmds\":%u,\"replies\":%u,\"reconnects\":%u}",
+               i ? "," : "", i, pcTypeNames[pxClient->eType], pxClient->iFd >= 0 ? "true" : "false", dFps,
+               (double) pxP->ullBytes * 8.0 / 1000.0 / dPeriodS,
+               pxP->ulFrames ? (double) pxP->ullAgeSumMs / pxP->ulFrames : 0.0, pxP->ulAgeMaxMs, pxP->ulLagMaxMs,
+               pxP->ulRttLastUs / 1000.0, pxP->ulRttMaxUs / 1000.0, pxClient->ulGaps, pxClient->ulServerDropped,
+               pxClient->ulServerQueued, pxClient->ulCmds, pxClient->ulReplies, pxClient->ulReconnects);
+        memset(pxP, 0, sizeof(*pxP));
+    }
+    printf("]}\n");
+    fflush(stdout);
+}
+
+/* ---- Main ---------------------------------------------------------------- */
+
+static void vUsage(const char *pcProg) {
+    fprintf(stderr, "usage: %s [--host H] [--port N] [--fast N] [--slow N] [--stalled N]\n"
+                    "          [--storm HZ] [--slow-kbps N] [--seconds S] [--report S]\n", pcProg);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    uint32_t ulCount[3] = { 2, 1, 1 };
+    uint32_t ulSeconds = 60;            /* 0: until Ctrl-C */
+    uint32_t ulReportS = 10;
+
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) vUsage(argv[0]);
+        const char *pcValue = argv[i + 1];
+        if (strcmp(argv[i], "--host") == 0) pcHost = pcValue;
+        else if (strcmp(argv[i], "--port") == 0) pcPort = pcValue;
+        else if (strcmp(argv[i], "--fast") == 0) ulCount[CLIENT_FAST] = (uint32_t) strtoul(pcValue, NULL, 0);
+        else if (strcmp(argv[i], "--slow") == 0) ulCount[CLIENT_SLOW] = (uint32_t) strtoul(pcValue, NULL, 0);
+        else if (strcmp(argv[i], "--stalled") == 0) ulCount[CLIENT_STALLED] = (uint32_t) strtoul(pcValue, NULL, 0);
+        else if (strcmp(argv[i], "--storm") == 0) ulStormHz = (uint32_t) strtoul(pcValue, NULL, 0);
+        else if (strcmp(argv[i], "--slow-kbps") == 0) ulSlowBytesPerS = (uint32_t) strtoul(pcValue, NULL, 0) * 1000u / 8u;
+        else if (strcmp(argv[i], "--seconds") == 0) ulSeconds = (uint32_t) strtoul(pcValue, NULL, 0);
+        else if (strcmp(argv[i], "--report") == 0) ulReportS = (uint32_t) strtoul(pcValue, NULL, 0);
+        else vUsage(argv[0]);
+    }
+    if (ulReportS == 0) ulReportS = 1;
+    if (ulStormHz > 1000000u) ulStormHz = 1000000u;
+    if (ulSlowBytesPerS == 0) ulSlowBytesPerS = 1;
+
+    for (int t = 0; t < 3; t++) {
+        for (uint32_t n = 0; n < ulCount[t] && xClientCount < MAX_CLIENTS; n++) {
+            Client_t *pxClient = &xClients[xClientCount++];
+            pxClient->eType = (ClientType_e) t;
+            pxClient->iFd = -1;
+            pxClient->pucRx = malloc(RX_BUFFER_SIZE);
+            if (pxClient->pucRx == NULL) return 1;
+        }
+    }
+    if (xClientCount == 0) vUsage(argv[0]);
+
+    signal(SIGINT, vOnSignal);
+    signal(SIGTERM, vOnSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* The first pass must reach the server, later drops are reconnected */
+    for (size_t i = 0; i < xClientCount; i++) {
+        vTryConnect(&xClients[i]);
+        if (xClients[i].iFd < 0) {
+            fprintf(stderr, "cannot open ws://%s:%s/ws\n", pcHost, pcPort);
+            return 1;
+        }
+    }
+    fprintf(stderr, "%zu clients on ws://%s:%s/ws (%u fast, %u slow, %u stalled), storm %u Hz\n", xClientCount,
+            pcHost, pcPort, ulCount[CLIENT_FAST], ulCount[CLIENT_SLOW], ulCount[CLIENT_STALLED], ulStormHz);
+
+    uint64_t ullStart = ullNowMs();
+    uint64_t ullLastReport = ullStart;
+    struct pollfd xFds[MAX_CLIENTS];
+
+    while (!bStop) {
+        uint64_t ullNow = ullNowMs();
+        if (ulSeconds > 0 && ullNow - ullStart >= (uint64_t) ulSeconds * 1000u) break;
+        if (ullNow - ullLastReport >= (uint64_t) ulReportS * 1000u) {
+            vReport((double) (ullNow - ullStart) / 1000.0, (double) (ullNow - ullLastReport) / 1000.0, false);
+            ullLastReport = ullNow;
+        }
+
+        /* Metrics come from the first reading client that is connected */
+        bool bMetricsAsked = false;
+        for (size_t i = 0; i < xClientCount; i++) {
+            Client_t *pxClient = &xClients[i];
+            vTryConnect(pxClient);
+            bool bMetrics = !bMetricsAsked && pxClient->iFd >= 0 && pxClient->eType != CLIENT_STALLED;
+            bMetricsAsked |= bMetrics;
+            vGenerate(pxClient, bMetrics);
+
+            xFds[i].fd = pxClient->iFd;
+            /* Stalled readers only watch for the server closing them */
+            xFds[i].events = pxClient->eType == CLIENT_STALLED ? POLLRDHUP : POLLIN;
+            xFds[i].revents = 0;
+        }
+
+        int iTimeoutMs = ulStormHz > 0 ? 1 : 10;
+        if (poll(xFds, xClientCount, iTimeoutMs) < 0 && errno != EINTR) break;
+
+        for (size_t i = 0; i < xClientCount; i++) {
+            Client_t *pxClient = &xClients[i];
+            if (pxClient->iFd < 0 || xFds[i].revents == 0) continue;
+            if (pxClient->eType == CLIENT_STALLED) {
+                if (xFds[i].revents & (POLLRDHUP | POLLHUP | POLLERR)) {
+                    pxClient->ulReconnects++;
+                    vDisconnect(pxClient);
+                }
+                continue;
+            }
+            vRead(pxClient);
+        }
+    }
+
+    uint64_t ullEnd = ullNowMs();
+    double dElapsed = (double) (ullEnd - ullStart) / 1000.0;
+    vReport(dElapsed > 0.0 ? dElapsed : 1.0, (ullEnd - ullLastReport) > 0 ? (double) (ullEnd - ullLastReport) / 1000.0 : 1.0, true);
+    for (size_t i = 0; i < xClientCount; i++) {
+        if (xClients[i].iFd >= 0) close(xClients[i].iFd);
+        free(xClients[i].pucRx);
+    }
+    return 0;
+}
@@ -1,36 +1,72 @@
 #include "command_handler.h"
 #include "drivers/adc_dma.h"
+#include "net/frame_codec.h"
 #include <string.h>
 #include <stdio.h>
 
-// Global scope state (protected by mutex in real implementation)
-static TriggerConfig_t xCurrentTrigger;
+// Global acquisition state (network task only)
 static uint32_t ulCurrentSampleRate = 100000;
 static bool bCaptureRunning = false;
 
+// Acquisition changes wait for bCommandHandlerCommit()
+static bool bRatePending = false;
+static bool bRunPending = false;
+
+// Default view: used by non-WebSocket callers and copied into new viewers
+static ScopeViewConfig_t xDefaultView;
+
+// Vertical window spans 8 divisions
+#define VERTICAL_DIVS 8.0f
+
+static void vViewDefaults(ScopeViewConfig_t* pxView) {
+    memset(pxView, 0, sizeof(*pxView));
+    vTriggerInitDefault(&pxView->xTrigger);
+    pxView->xTrigger.uLevelCounts = 1638;  // Your current default
+    pxView->xTrigger.uHysteresis = 200;
+    pxView->usPoints = DISPLAY_POINTS;
+    pxView->fVoltsPerDiv = 0.5f;           // Default window covers 0..3.3V
+    pxView->fVerticalOffset = 1.65f;
+    pxView->ucFrameEncoding = FRAME_ENC_PACK12;
+    pxView->ucFrameFlags = FRAME_FLAG_INTER;
+    pxView->fZoomWidth = 0.0f;
+    pxView->fZoomCenter = 0.5f;
+}
+
 void vCommandHandlerInit(void) {
-    trigger_init_default(&xCurrentTrigger);
-    xCurrentTrigger.uLevelCounts = 1638;  // Your current default
-    xCurrentTrigger.uHysteresis = 200;
+    vViewDefaults(&xDefaultView);
     ulCurrentSampleRate = 100000;
     bCaptureRunning = false;
+    bRatePending = false;
+    bRunPending = false;
+}
+
+void vCommandHandlerInitView(ScopeViewConfig_t* pxView) {
+    if (!pxView) return;
+    *pxView = xDefaultView;
+}
+
+static void vFillStatus(const ScopeViewConfig_t* pxView, ScopeStatus_t* pxStatus) {
+    pxStatus->xView = *pxView;
+    pxStatus->ulSampleRate = ulCurrentSampleRate;
 }
 
-bool bCommandHandlerExecute(const ScopeCommand_t* pxCmd, ScopeStatus_t* pxStatus) {
+bool bCommandHandlerExecute(const ScopeCommand_t* pxCmd, ScopeViewConfig_t* pxView, ScopeStatus_t* pxStatus) {
     if (!pxCmd || !pxStatus) return false;
+    if (!pxView) pxView = &xDefaultView;
+    TriggerConfig_t* pxTrig = &pxView->xTrigger;
     
     memset(pxStatus, 0, sizeof(ScopeStatus_t));
     pxStatus->bSuccess = true;
     
     switch (pxCmd->eType) {
         case CMD_TRIGGER_MODE:
-            xCurrentTrigger.eMode = pxCmd->uValue.eTriggerMode;
+            pxTrig->eMode = pxCmd->uValue.eTriggerMode;
             snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage), 
                      "Trigger mode: %d", pxCmd->uValue.eTriggerMode);
             break;
             
         case CMD_TRIGGER_EDGE:
-            xCurrentTrigger.eEdge = pxCmd->uValue.eTriggerEdge;
+            pxTrig->eEdge = pxCmd->uValue.eTriggerEdge;
             snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
                      "Trigger edge: %s", 
                      pxCmd->uValue.eTriggerEdge == TRIG_EDGE_RISING ? "RISING" : "FALLING");
@@ -38,17 +74,18 @@ bool bCommandHandlerExecute(const ScopeCommand_t* pxCmd, ScopeStatus_t* pxStatus
             
         case CMD_TRIGGER_LEVEL:
             // Convert volts to ADC counts (0-3.3V -> 0-4095)
-            xCurrentTrigger.uLevelCounts = (uint16_t)(pxCmd->uValue.fTriggerLevel * 4095.0f / 3.3f);
-            if (xCurrentTrigger.uLevelCounts > 4095) xCurrentTrigger.uLevelCounts = 4095;
+            pxTrig->uLevelCounts = (uint16_t)(pxCmd->uValue.fTriggerLevel * 4095.0f / 3.3f);
+            if (pxTrig->uLevelCounts > 4095) pxTrig->uLevelCounts = 4095;
             snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
                      "Trigger level: %.2fV (%u counts)", 
-                     pxCmd->uValue.fTriggerLevel, xCurrentTrigger.uLevelCounts);
+                     pxCmd->uValue.fTriggerLevel, pxTrig->uLevelCounts);
             break;
             
         case CMD_TIMEBASE_SCALE:
-            // Time/div in seconds -> compute required sample rate
-            // Target: 10 divisions across screen, DISPLAY_POINTS samples
-            xCurrentTrigger.fTimePerDivMs = pxCmd->uValue.fTimePerDiv * 1000.0f;
+            // Time/div in seconds -> per-view span (bTriggerBuildFrame narrows to it)
+            // The ADC rate is shared, so it follows the last timebase change:
+            // target 10 divisions across screen, DISPLAY_POINTS samples
+            pxTrig->fTimePerDivMs = pxCmd->uValue.fTimePerDiv * 1000.0f;
             
             // Calculate needed sample rate to fill screen at this timebase
             float total_time_s = pxCmd->uValue.fTimePerDiv * 10.0f;
@@ -59,29 +96,84 @@ bool bCommandHandlerExecute(const ScopeCommand_t* pxCmd, ScopeStatus_t* pxStatus
             if (needed_rate > 500000) needed_rate = 500000;
             
             ulCurrentSampleRate = needed_rate;
-            vAdcDmaSetSampleRate(ulCurrentSampleRate);
+            bRatePending = true;
             
             snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
                      "Timebase: %.1fms/div (Fs=%lu Hz)", 
-                     xCurrentTrigger.fTimePerDivMs, ulCurrentSampleRate);
+                     pxTrig->fTimePerDivMs, ulCurrentSampleRate);
             break;
             
         case CMD_SAMPLE_RATE:
             ulCurrentSampleRate = pxCmd->uValue.ulSampleRate;
-            vAdcDmaSetSampleRate(ulCurrentSampleRate);
+            bRatePending = true;
             snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
                      "Sample rate: %lu Hz", ulCurrentSampleRate);
             break;
             
+        case CMD_VERTICAL_SCALE:
+            // Clamp to 10 mV/div .. 1 V/div
+            pxView->fVoltsPerDiv = pxCmd->uValue.fVoltsPerDiv;
+            if (pxView->fVoltsPerDiv < 0.01f) pxView->fVoltsPerDiv = 0.01f;
+            if (pxView->fVoltsPerDiv > 1.0f) pxView->fVoltsPerDiv = 1.0f;
+            snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
+                     "Vertical: %.2fV/div", pxView->fVoltsPerDiv);
+            break;
+
+        case CMD_VERTICAL_OFFSET:
+            pxView->fVerticalOffset = pxCmd->uValue.fVerticalOffset;
+            if (pxView->fVerticalOffset < 0.0f) pxView->fVerticalOffset = 0.0f;
+            if (pxView->fVerticalOffset > 3.3f) pxView->fVerticalOffset = 3.3f;
+            snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
+                     "Vertical offset: %.2fV", pxView->fVerticalOffset);
+            break;
+
+        case CMD_FRAME_FORMAT: {
+            uint8_t ucEnc = pxCmd->uValue.ucFrameFormat & 0x0Fu;
+            if (ucEnc >= FRAME_ENC_COUNT) {
+                pxStatus->bSuccess = false;
+                snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage), "Unknown frame format");
+                return false;
+            }
+            pxView->ucFrameEncoding = ucEnc;
+            pxView->ucFrameFlags = (uint8_t)((pxCmd->uValue.ucFrameFormat >> 4) & (FRAME_FLAG_DELTA | FRAME_FLAG_INTER));
+            snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
+                     "Frame format: %u%s%s", pxView->ucFrameEncoding,
+                     (pxView->ucFrameFlags & FRAME_FLAG_DELTA) ? " +delta" : "",
+                     (pxView->ucFrameFlags & FRAME_FLAG_INTER) ? " +inter" : "");
+            break;
+        }
+
+        case CMD_DISPLAY_POINTS:
+            pxView->usPoints = pxCmd->uValue.usPoints;
+            if (pxView->usPoints < VIEW_MIN_POINTS) pxView->usPoints = VIEW_MIN_POINTS;
+            if (pxView->usPoints > VIEW_MAX_POINTS) pxView->usPoints = VIEW_MAX_POINTS;
+            snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
+                     "Display points: %u", pxView->usPoints);
+            break;
+
+        case CMD_ZOOM_WIDTH:
+            // 0 disables the zoom stream, otherwise 1%..100% of the span
+            pxView->fZoomWidth = pxCmd->uValue.fZoom;
+            if (pxView->fZoomWidth <= 0.0f) pxView->fZoomWidth = 0.0f;
+            else if (pxView->fZoomWidth < 0.01f) pxView->fZoomWidth = 0.01f;
+            if (pxView->fZoomWidth > 1.0f) pxView->fZoomWidth = 1.0f;
+            snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
+                     "Zoom width: %.1f%%", pxView->fZoomWidth * 100.0f);
+            break;
+
+        case CMD_ZOOM_CENTER:
+            pxView->fZoomCenter = pxCmd->uValue.fZoom;
+            if (pxView->fZoomCenter < 0.0f) pxView->fZoomCenter = 0.0f;
+            if (pxView->fZoomCenter > 1.0f) pxView->fZoomCenter = 1.0f;
+            snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
+                     "Zoom centre: %.1f%%", pxView->fZoomCenter * 100.0f);
+            break;
+
         case CMD_RUN_STOP:
             bCaptureRunning = pxCmd->uValue.bRunning;
-            if (bCaptureRunning) {
-                vAdcDmaStartContinous();
-                snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage), "Capture started");
-            } else {
-                vAdcDmaStop();
-                snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage), "Capture stopped");
-            }
+            bRunPending = true;
+            snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage),
+                     bCaptureRunning ? "Capture started" : "Capture stopped");
             break;
             
         case CMD_GET_STATUS:
@@ -95,25 +187,50 @@ bool bCommandHandlerExecute(const ScopeCommand_t* pxCmd, ScopeStatus_t* pxStatus
     }
     
     // Always return current state
-    pxStatus->xTriggerConfig = xCurrentTrigger;
-    pxStatus->ulSampleRate = ulCurrentSampleRate;
+    vFillStatus(pxView, pxStatus);
     pxStatus->bRunning = bCaptureRunning;
     
     return true;
 }
 
-void vCommandHandlerGetStatus(ScopeStatus_t* pxStatus) {
+void vCommandHandlerGetStatus(const ScopeViewConfig_t* pxView, ScopeStatus_t* pxStatus) {
     if (!pxStatus) return;
+    if (!pxView) pxView = &xDefaultView;
     memset(pxStatus, 0, sizeof(ScopeStatus_t));
     pxStatus->bSuccess = true;
-    pxStatus->xTriggerConfig = xCurrentTrigger;
-    pxStatus->ulSampleRate = ulCurrentSampleRate;
-    pxStatus->bRunning = bAdcDmaIsRunning();  // Query actual state
+    vFillStatus(pxView, pxStatus);
+    pxStatus->bRunning = bRunPending ? bCaptureRunning : bAdcDmaIsRunning();  // Actual state unless a change is pending
     snprintf(pxStatus->acMessage, sizeof(pxStatus->acMessage), "Status OK");
 }
 
-// Getter for web server to access current trigger config
-TriggerConfig_t* pxCommandHandlerGetTriggerConfig(void) {
-    return &xCurrentTrigger;
+bool bCommandHandlerCommit(void) {
+    bool bTouched = false;
+    // Rate first: while a start is pending the ADC is restarted only once
+    if (bRatePending) {
+        bRatePending = false;
+        if (ulCurrentSampleRate != ulAdcDmaGetSampleRate()) {
+            vAdcDmaSetSampleRate(ulCurrentSampleRate);
+            bTouched = true;
+        }
+    }
+    if (bRunPending) {
+        bRunPending = false;
+        if (bCaptureRunning != bAdcDmaIsRunning()) {
+            if (bCaptureRunning) vAdcDmaStartContinous();
+            else vAdcDmaStop();
+            bTouched = true;
+        }
+    }
+    return bTouched;
 }
 
+void vCommandHandlerGetVerticalWindow(const ScopeViewConfig_t* pxView, uint16_t* pusLo, uint16_t* pusHi) {
+    if (!pxView) pxView = &xDefaultView;
+    float fHalf = pxView->fVoltsPerDiv * VERTICAL_DIVS * 0.5f;
+    float fLo = (pxView->fVerticalOffset - fHalf) * 4095.0f / 3.3f;
+    float fHi = (pxView->fVerticalOffset + fHalf) * 4095.0f / 3.3f;
+    if (fLo < 0.0f) fLo = 0.0f;
+    if (fHi > 4095.0f) fHi = 4095.0f;
+    if (pusLo) *pusLo = (uint16_t)(fLo + 0.5f);
+    if (pusHi) *pusHi = (uint16_t)(fHi + 0.5f);
+}
@@ -11,7 +11,12 @@ typedef enum {
     CMD_TRIGGER_EDGE,      // RISING/FALLING
     CMD_TRIGGER_LEVEL,     // Voltage level
     CMD_TIMEBASE_SCALE,    // Time/div (10μs to 1s)
-    CMD_VERTICAL_SCALE,    // Volts/div (future)
+    CMD_VERTICAL_SCALE,    // Volts/div (8 divisions)
+    CMD_VERTICAL_OFFSET,   // Centre of the vertical window (volts)
+    CMD_FRAME_FORMAT,      // Stream encoding (FrameEncoding_e | FRAME_FLAG_* << 4)
+    CMD_DISPLAY_POINTS,    // Points per frame for this viewer
+    CMD_ZOOM_WIDTH,        // Zoom window width as a fraction of the span (0 = off)
+    CMD_ZOOM_CENTER,       // Zoom window centre as a fraction of the span
     CMD_SAMPLE_RATE,       // Set acquisition rate
     CMD_RUN_STOP,          // Start/stop capture
     CMD_GET_STATUS         // Query current config
@@ -27,28 +32,61 @@ typedef struct {
         float          fTimePerDiv;      // Seconds
         uint32_t       ulSampleRate;     // Hz
         bool           bRunning;
+        float          fVoltsPerDiv;     // Volts
+        float          fVerticalOffset;  // Volts
+        uint8_t        ucFrameFormat;    // Encoding in low nibble, flags in high nibble
+        uint16_t       usPoints;         // Display points
+        float          fZoom;            // Fraction of the span (width or centre)
     } uValue;
 } ScopeCommand_t;
 
+#define VIEW_MIN_POINTS 16
+#define VIEW_MAX_POINTS 1024
+
+// Per-viewer display configuration (one per WebSocket client).
+// Acquisition (sample rate, run/stop) stays global; everything a viewer can
+// change without affecting the capture lives here.
+typedef struct {
+    TriggerConfig_t xTrigger;
+    uint16_t        usPoints;          // Display points per frame
+    float           fVoltsPerDiv;      // Vertical window: 8 divisions...
+    float           fVerticalOffset;   // ...centred here (volts)
+    uint8_t         ucFrameEncoding;   // FrameEncoding_e
+    uint8_t         ucFrameFlags;      // FRAME_FLAG_DELTA / FRAME_FLAG_INTER (allowed)
+    float           fZoomWidth;        // Zoom window, fraction of the span (0 = no zoom stream)
+    float           fZoomCenter;       // Zoom window centre, fraction of the span
+} ScopeViewConfig_t;
+
 // Response packet to browser (struct -> JSON)
 typedef struct {
-    bool            bSuccess;
-    char            acMessage[64];
-    TriggerConfig_t xTriggerConfig;
-    uint32_t        ulSampleRate;
-    bool            bRunning;
+    bool              bSuccess;
+    char              acMessage[64];
+    ScopeViewConfig_t xView;
+    uint32_t          ulSampleRate;
+    bool              bRunning;
 } ScopeStatus_t;
 
 // Initialize command handler
 void vCommandHandlerInit(void);
 
-// Execute command and return status
-bool bCommandHandlerExecute(const ScopeCommand_t* pxCmd, ScopeStatus_t* pxStatus);
+// Fill a new viewer's configuration from the defaults
+void vCommandHandlerInitView(ScopeViewConfig_t* pxView);
+
+// Execute command and return status.
+// View commands apply to pxView (the default view if NULL), acquisition
+// commands apply globally but only take effect on bCommandHandlerCommit().
+bool bCommandHandlerExecute(const ScopeCommand_t* pxCmd, ScopeViewConfig_t* pxView, ScopeStatus_t* pxStatus);
+
+// Apply pending acquisition changes (sample rate, run/stop) to the ADC.
+// A burst of timebase commands restarts the ADC once, and not at all if the
+// rate ends up unchanged. Returns true if the ADC was reconfigured.
+bool bCommandHandlerCommit(void);
 
-// Get current scope configuration
-void vCommandHandlerGetStatus(ScopeStatus_t* pxStatus);
+// Get current scope configuration for a view (the default view if NULL)
+void vCommandHandlerGetStatus(const ScopeViewConfig_t* pxView, ScopeStatus_t* pxStatus);
 
-TriggerConfig_t* pxCommandHandlerGetTriggerConfig(void);
+// Vertical window in ADC counts derived from volts/div and offset
+void vCommandHandlerGetVerticalWindow(const ScopeViewConfig_t* pxView, uint16_t* pusLo, uint16_t* pusHi);
 
 #endif // COMMAND_HANDLER_H
 
@@ -0,0 +1,39 @@
+#include "command_queue.h"
+#include <string.h>
+
+void vCommandQueueReset(CommandQueue_t* pxQueue) {
+    memset(pxQueue, 0, sizeof(*pxQueue));
+}
+
+bool bCommandQueuePush(CommandQueue_t* pxQueue, const ScopeCommand_t* pxCmd) {
+    uint32_t ulType = (uint32_t) pxCmd->eType;
+    if (ulType >= COMMAND_QUEUE_TYPES) return false;
+
+    pxQueue->ulReceived++;
+    // Drop the older entry of this type; the new one goes to the end
+    for (uint8_t i = 0; i < pxQueue->ucCount; i++) {
+        if (pxQueue->ucOrder[i] != ulType) continue;
+        memmove(&pxQueue->ucOrder[i], &pxQueue->ucOrder[i + 1], (size_t) (pxQueue->ucCount - i - 1u));
+        pxQueue->ucCount--;
+        pxQueue->ulCoalesced++;
+        break;
+    }
+    pxQueue->ucOrder[pxQueue->ucCount++] = (uint8_t) ulType;
+    pxQueue->xLatest[ulType] = *pxCmd;
+    return true;
+}
+
+uint32_t ulCommandQueueApply(CommandQueue_t* pxQueue, ScopeViewConfig_t* pxView, ScopeStatus_t* pxStatus) {
+    uint32_t ulApplied = pxQueue->ucCount;
+    bool bFailed = false;
+    ScopeStatus_t xStatus;
+
+    for (uint8_t i = 0; i < pxQueue->ucCount; i++) {
+        bool bOk = bCommandHandlerExecute(&pxQueue->xLatest[pxQueue->ucOrder[i]], pxView, &xStatus);
+        // A failure stays visible over later successes
+        if (!bFailed || !bOk) *pxStatus = xStatus;
+        if (!bOk) bFailed = true;
+    }
+    pxQueue->ucCount = 0;
+    return ulApplied;
+}
@@ -0,0 +1,50 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "command_handler.h"
+
+/*
+ * Coalescing command queue (one per viewer)
+ *
+ * Commands are parsed as they arrive but applied later, all at once: the
+ * network task drains every viewer's queue once per poll pass and publishes
+ * the resulting views to the DSP task in one snapshot (core/dsp_task.h).
+ *
+ * The queue holds at most one command per CommandType_e. A newer command of a
+ * type already queued replaces the older one and moves to the end, so a
+ * slider dragged across 200 pixels between two passes costs one trigger update
+ * and a burst of timebase changes one ADC restart. Commands are applied in the
+ * order of their last update; the work per pass is bounded by
+ * COMMAND_QUEUE_TYPES no matter how many messages arrived.
+ *
+ * Network task only; not thread safe.
+ */
+
+#define COMMAND_QUEUE_TYPES ((uint32_t) CMD_GET_STATUS + 1u)
+
+typedef struct {
+    uint8_t        ucCount;                          // Queued types in ucOrder
+    uint8_t        ucOrder[COMMAND_QUEUE_TYPES];     // CommandType_e, oldest update first
+    ScopeCommand_t xLatest[COMMAND_QUEUE_TYPES];     // Newest command per type
+    uint32_t       ulReceived;                       // Commands pushed since reset
+    uint32_t       ulCoalesced;                      // ...that replaced a queued one
+} CommandQueue_t;
+
+void vCommandQueueReset(CommandQueue_t* pxQueue);
+
+/* Queue a command, replacing a queued one of the same type; false if the type is invalid */
+bool bCommandQueuePush(CommandQueue_t* pxQueue, const ScopeCommand_t* pxCmd);
+
+static inline bool bCommandQueueEmpty(const CommandQueue_t* pxQueue) {
+    return pxQueue->ucCount == 0;
+}
+
+/* Execute the queued commands on pxView (see bCommandHandlerExecute) and empty
+ * the queue. pxStatus gets the result of the last command that failed, or of
+ * the last one if all succeeded. Returns the number of commands executed.
+ */
+uint32_t ulCommandQueueApply(CommandQueue_t* pxQueue, ScopeViewConfig_t* pxView, ScopeStatus_t* pxStatus);
+
+#endif /* COMMAND_QUEUE_H */
@@ -0,0 +1,44 @@
+#include "cpu_load.h"
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+static uint32_t ulLastWall = 0;
+static uint32_t ulLastIdle[CPU_LOAD_CORES];
+static uint8_t ucPercent[CPU_LOAD_CORES];
+static bool bPrimed = false;
+
+uint32_t ulCpuLoadRunTimeCounter(void) {
+    return time_us_32();
+}
+
+static TaskHandle_t xIdleHandle(uint8_t ucCore) {
+#if configNUMBER_OF_CORES > 1
+    return xTaskGetIdleTaskHandleForCore((BaseType_t) ucCore);
+#else
+    return ucCore == 0 ? xTaskGetIdleTaskHandle() : NULL;
+#endif
+}
+
+void vCpuLoadSample(void) {
+    uint32_t ulWall = ulCpuLoadRunTimeCounter();
+    uint32_t ulSpan = ulWall - ulLastWall;
+
+    for (uint8_t ucCore = 0; ucCore < CPU_LOAD_CORES; ucCore++) {
+        TaskHandle_t xIdle = xIdleHandle(ucCore);
+        if (xIdle == NULL) continue;
+        uint32_t ulIdle = (uint32_t) ulTaskGetRunTimeCounter(xIdle);
+        if (bPrimed && ulSpan > 0) {
+            uint32_t ulIdleSpan = ulIdle - ulLastIdle[ucCore];
+            if (ulIdleSpan > ulSpan) ulIdleSpan = ulSpan;
+            ucPercent[ucCore] = (uint8_t)(((uint64_t)(ulSpan - ulIdleSpan) * 100u) / ulSpan);
+        }
+        ulLastIdle[ucCore] = ulIdle;
+    }
+    ulLastWall = ulWall;
+    bPrimed = true;
+}
+
+uint8_t ucCpuLoadGetPercent(uint8_t ucCore) {
+    return ucCore < CPU_LOAD_CORES ? ucPercent[ucCore] : 0;
+}
@@ -0,0 +1,25 @@
+#ifndef CPU_LOAD_H
+#define CPU_LOAD_H
+
+#include <stdint.h>
+
+/*
+ * Per-core utilization from FreeRTOS run time stats
+ *
+ * Busy time of a core is the window length minus the run time of that core's
+ * idle task. vCpuLoadSample() closes one window; call it periodically (about
+ * once a second) from a single task.
+ */
+
+#define CPU_LOAD_CORES 2
+
+/* Run time stats clock (1 MHz), see portGET_RUN_TIME_COUNTER_VALUE */
+uint32_t ulCpuLoadRunTimeCounter(void);
+
+/* Close the current window and start the next one */
+void vCpuLoadSample(void);
+
+/* Busy percentage of a core over the last closed window (0 before the first) */
+uint8_t ucCpuLoadGetPercent(uint8_t ucCore);
+
+#endif /* CPU_LOAD_H */
@@ -0,0 +1,384 @@
+#include "dsp_task.h"
+#include "scope_view.h"
+#include "frame_queue.h"
+#include "metrics.h"
+#include "trace.h"
+#include "drivers/adc_dma.h"
+#include "net/frame_codec.h"
+
+#include "pico/stdlib.h"
+#include <string.h>
+#include <stdio.h>
+
+/* Render streams are sent as FrameView_e, one inter-frame reference each */
+_Static_assert(VIEW_STREAMS == FRAME_VIEW_COUNT, "render streams must match frame views");
+/* Every client's render of one capture stays cached while later clients are processed */
+_Static_assert(VIEW_CACHE_SLOTS >= DSP_MAX_CLIENTS, "renders of one capture must not evict each other");
+
+/* Inter-frame reference for one stream (see FRAME_FLAG_INTER in net/frame_codec.h)
+ * Keyframes are forced when the capture sequence enters a new
+ * FRAME_KEYFRAME_INTERVAL epoch, so every client with the same view ends up
+ * with the same reference and from then on shares one encoded frame.
+ */
+typedef struct {
+    uint16_t usRefSamples[VIEW_MAX_POINTS];  // Last frame queued, raw counts
+    uint16_t usRefCount;                     // 0 => no reference, next frame is a keyframe
+    uint8_t  ucRefEncoding;
+    uint16_t usRefVertLo;
+    uint16_t usRefVertHi;
+    uint32_t ulKeyEpoch;                     // Capture sequence / FRAME_KEYFRAME_INTERVAL of the last keyframe
+    uint32_t ulRefTag;                       // Frame that set this reference (equal tags => equal references)
+} StreamRef_t;
+
+/* Shared with the network task: written there, read here (ulDropped the other way) */
+typedef struct {
+    volatile uint32_t ulGeneration;          // Odd while open, bumped on open and close
+    volatile bool     bCredit;               // Send queue has room
+    volatile uint32_t ulDropped;
+} ClientLink_t;
+
+/* DSP task only */
+typedef struct {
+    uint32_t          ulSeenGeneration;      // References below belong to this generation
+    StreamRef_t       xRef[FRAME_VIEW_COUNT];
+} ClientStream_t;
+
+/* Views of all clients as one versioned snapshot (see ulDspPublishViews) */
+typedef struct {
+    uint32_t          ulVersion;
+    uint32_t          ulGeneration[DSP_MAX_CLIENTS];  // Slot occupant the view belongs to
+    ScopeViewConfig_t xView[DSP_MAX_CLIENTS];
+} ViewSnapshot_t;
+
+static ClientLink_t xLinks[DSP_MAX_CLIENTS];
+static ClientStream_t xStreams[DSP_MAX_CLIENTS];
+
+/* Seqlock: odd while the network task copies xStaged into xPublished */
+static ViewSnapshot_t xStaged;               // Network task only
+static bool bStagedDirty = false;
+static ViewSnapshot_t xPublished;
+static volatile uint32_t ulViewSeq = 0;
+static ViewSnapshot_t xViews;                // DSP task's copy for the current capture
+/* Frames queued for the current capture; a later client whose stream is in the
+ * same state joins the frame instead of encoding its own copy.
+ */
+typedef struct {
+    QueuedFrame_t*        pxFrame;
+    const ScopeRender_t*  pxRender;          // Same render => same samples, trigger and timebase
+    const StreamRef_t*    pxRefAfter;        // Owner's reference after encoding
+    uint32_t              ulRefTagBefore;
+    uint32_t              ulKeyEpochBefore;
+    uint16_t              usVertLo;
+    uint16_t              usVertHi;
+    uint8_t               ucView;
+    uint8_t               ucEncoding;
+    uint8_t               ucFlags;
+} SharedFrame_t;
+
+static SharedFrame_t xShared[DSP_MAX_CLIENTS * VIEW_STREAMS];
+static uint32_t ulSharedCount = 0;
+static uint32_t ulNextRefTag = 1;
+static uint32_t ulFramesShared = 0;
+
+static DspFramesReadyFn_t pxFramesReady = NULL;
+static int iConsumer = -1;
+
+static uint32_t ulTimingLastUs = 0;
+static uint32_t ulTimingMaxUs = 0;
+
+void vDspSetFramesReadyHook(DspFramesReadyFn_t pxHook) {
+    pxFramesReady = pxHook;
+}
+
+void vDspClientOpen(uint8_t ucSlot, const ScopeViewConfig_t* pxView) {
+    if (ucSlot >= DSP_MAX_CLIENTS || !pxView) return;
+    ClientLink_t* pxLink = &xLinks[ucSlot];
+    uint32_t ulGeneration = pxLink->ulGeneration + ((pxLink->ulGeneration & 1u) ? 2u : 1u);
+    // The view is published before the slot opens, tagged with the new occupant
+    xStaged.ulGeneration[ucSlot] = ulGeneration;
+    xStaged.xView[ucSlot] = *pxView;
+    bStagedDirty = true;
+    ulDspPublishViews();
+    taskENTER_CRITICAL();
+    pxLink->bCredit = true;
+    pxLink->ulDropped = 0;
+    pxLink->ulGeneration = ulGeneration;
+    taskEXIT_CRITICAL();
+}
+
+void vDspClientClose(uint8_t ucSlot) {
+    if (ucSlot >= DSP_MAX_CLIENTS) return;
+    ClientLink_t* pxLink = &xLinks[ucSlot];
+    taskENTER_CRITICAL();
+    if (pxLink->ulGeneration & 1u) pxLink->ulGeneration++;
+    pxLink->bCredit = false;
+    taskEXIT_CRITICAL();
+}
+
+void vDspClientSetView(uint8_t ucSlot, const ScopeViewConfig_t* pxView) {
+    if (ucSlot >= DSP_MAX_CLIENTS || !pxView) return;
+    if (memcmp(&xStaged.xView[ucSlot], pxView, sizeof(*pxView)) == 0) return;
+    xStaged.xView[ucSlot] = *pxView;
+    bStagedDirty = true;
+}
+
+uint32_t ulDspPublishViews(void) {
+    if (!bStagedDirty) return xStaged.ulVersion;
+    bStagedDirty = false;
+    xStaged.ulVersion++;
+
+    uint32_t ulSeq = ulViewSeq;
+    __atomic_store_n(&ulViewSeq, ulSeq + 1u, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&xPublished, &xStaged, sizeof(xPublished));
+    __atomic_store_n(&ulViewSeq, ulSeq + 2u, __ATOMIC_RELEASE);
+    return xStaged.ulVersion;
+}
+
+/* Consistent copy of the published views; retried if a publish overlapped */
+static void vReadViews(ViewSnapshot_t* pxOut) {
+    for (;;) {
+        uint32_t ulSeq = __atomic_load_n(&ulViewSeq, __ATOMIC_ACQUIRE);
+        if (ulSeq & 1u) {
+            taskYIELD();
+            continue;
+        }
+        memcpy(pxOut, &xPublished, sizeof(*pxOut));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&ulViewSeq, __ATOMIC_RELAXED) == ulSeq) return;
+    }
+}
+
+void vDspClientSetCredit(uint8_t ucSlot, bool bCanSend) {
+    if (ucSlot < DSP_MAX_CLIENTS) xLinks[ucSlot].bCredit = bCanSend;
+}
+
+uint32_t ulDspClientGeneration(uint8_t ucSlot) {
+    return ucSlot < DSP_MAX_CLIENTS ? xLinks[ucSlot].ulGeneration : 0;
+}
+
+uint32_t ulDspClientDropped(uint8_t ucSlot) {
+    return ucSlot < DSP_MAX_CLIENTS ? xLinks[ucSlot].ulDropped : 0;
+}
+
+void vDspGetTiming(uint32_t* pulLastUs, uint32_t* pulMaxUs) {
+    if (pulLastUs) *pulLastUs = ulTimingLastUs;
+    if (pulMaxUs) *pulMaxUs = ulTimingMaxUs;
+}
+
+uint32_t ulDspFramesShared(void) {
+    return ulFramesShared;
+}
+
+bool bDspGetInputStats(ScopeConsumerStats_t* pxStats) {
+    return bScopeDataGetConsumerStats(iConsumer, pxStats);
+}
+
+/* Encode the current frame for one client stream
+ * Picks keyframe, inter-frame residuals or keep-alive against the last frame
+ * queued on this stream, forcing a keyframe when the format or vertical window
+ * changed or a new FRAME_KEYFRAME_INTERVAL epoch started.
+ */
+static size_t xEncodeForStream(StreamRef_t* pxRef, const FrameInfo_t* pxInfo, const uint16_t* pusSamples,
+                               uint16_t usCount, uint8_t ucEncoding, uint8_t ucFlags,
+                               uint8_t* pucOut, size_t xOutCap) {
+    bool bRefValid = pxRef->usRefCount == usCount &&
+                     pxRef->ucRefEncoding == ucEncoding &&
+                     pxRef->usRefVertLo == pxInfo->usVertLo &&
+                     pxRef->usRefVertHi == pxInfo->usVertHi;
+    uint32_t ulEpoch = pxInfo->ulSequence / FRAME_KEYFRAME_INTERVAL;
+    bool bKeyframe = !bRefValid || !(ucFlags & FRAME_FLAG_INTER) || pxRef->ulKeyEpoch != ulEpoch;
+
+    uint8_t ucFrameFlags;
+    if (bKeyframe) {
+        ucFrameFlags = ucFlags & FRAME_FLAG_DELTA;
+    } else if (bFrameWithinThreshold(pusSamples, pxRef->usRefSamples, usCount, FRAME_KEEPALIVE_THRESHOLD)) {
+        ucFrameFlags = FRAME_FLAG_KEEPALIVE;
+    } else {
+        ucFrameFlags = FRAME_FLAG_INTER;
+    }
+
+    size_t xLen = xFrameEncode(pxInfo, pusSamples, usCount, (FrameEncoding_e) ucEncoding, ucFrameFlags,
+                               pxRef->usRefSamples, pucOut, xOutCap);
+    if (xLen == 0) return 0;
+
+    if (bKeyframe) pxRef->ulKeyEpoch = ulEpoch;
+    /* Keep-alive leaves the reference alone so sub-threshold drift cannot accumulate */
+    if (!(ucFrameFlags & FRAME_FLAG_KEEPALIVE)) {
+        pxRef->ulRefTag = ulNextRefTag++;
+        if (ulNextRefTag == 0) ulNextRefTag = 1;
+        memcpy(pxRef->usRefSamples, pusSamples, (size_t) usCount * sizeof(uint16_t));
+        pxRef->usRefCount = usCount;
+        pxRef->ucRefEncoding = ucEncoding;
+        pxRef->usRefVertLo = pxInfo->usVertLo;
+        pxRef->usRefVertHi = pxInfo->usVertHi;
+    }
+    return xLen;
+}
+
+/* Render and queue the frames of one client; returns true if any was queued */
+static bool bProcessClient(uint8_t ucSlot, const ScopeBuffer_t* pxBuffer, uint32_t ulFs, FrameInfo_t* pxInfo) {
+    ClientLink_t* pxLink = &xLinks[ucSlot];
+    ClientStream_t* pxStream = &xStreams[ucSlot];
+
+    uint32_t ulGeneration = pxLink->ulGeneration;
+    if (!(ulGeneration & 1u)) return false;
+    if (ulGeneration != pxStream->ulSeenGeneration) {
+        /* New occupant: start from keyframes */
+        memset(pxStream->xRef, 0, sizeof(pxStream->xRef));
+        pxStream->ulSeenGeneration = ulGeneration;
+    }
+
+    // Backlogged clients skip this capture; nothing is encoded, so references stay consistent
+    if (!pxLink->bCredit) {
+        pxLink->ulDropped++;
+        return false;
+    }
+
+    // Opened after this capture's snapshot was taken: its view is in the next one
+    if (xViews.ulGeneration[ucSlot] != ulGeneration) return false;
+    const ScopeViewConfig_t* pxView = &xViews.xView[ucSlot];
+
+    uint32_t ulRenderStart = ulMetricsCycles();
+    const ScopeRender_t* pxRender = pxScopeViewRender(pxBuffer, ulFs, pxView);
+    vMetricsStageAdd(METRICS_STAGE_RENDER, ulMetricsCycles() - ulRenderStart);
+    if (pxRender == NULL) return false;
+
+    vCommandHandlerGetVerticalWindow(pxView, &pxInfo->usVertLo, &pxInfo->usVertHi);
+
+    // Overview, then the zoomed window of the same capture if enabled
+    bool bQueued = false;
+    for (uint8_t ucView = 0; ucView < VIEW_STREAMS; ucView++) {
+        const ScopeRenderStream_t* pxOut = &pxRender->xStream[ucView];
+        if (!pxOut->bValid) continue;
+        StreamRef_t* pxRef = &pxStream->xRef[ucView];
+
+        // Same render, format, window and reference as a frame already queued: join it
+        SharedFrame_t* pxShare = NULL;
+        for (uint32_t i = 0; i < ulSharedCount; i++) {
+            SharedFrame_t* pxS = &xShared[i];
+            if (pxS->pxRender == pxRender && pxS->ucView == ucView &&
+                pxS->ucEncoding == pxView->ucFrameEncoding && pxS->ucFlags == pxView->ucFrameFlags &&
+                pxS->usVertLo == pxInfo->usVertLo && pxS->usVertHi == pxInfo->usVertHi &&
+                pxS->ulRefTagBefore == pxRef->ulRefTag && pxS->ulKeyEpochBefore == pxRef->ulKeyEpoch) {
+                pxShare = pxS;
+                break;
+            }
+        }
+        if (pxShare != NULL) {
+            pxShare->pxFrame->ucClientMask |= (uint8_t) (1u << ucSlot);
+            pxShare->pxFrame->ulGeneration[ucSlot] = ulGeneration;
+            *pxRef = *pxShare->pxRefAfter;
+            ulFramesShared++;
+            bQueued = true;
+            continue;
+        }
+
+        QueuedFrame_t* pxFrame = pxFrameQueueReserve();
+        if (pxFrame == NULL) {
+            pxLink->ulDropped++;
+            break;
+        }
+
+        pxInfo->ucView = ucView;
+        pxInfo->fTimePerDivMs = pxOut->fTimePerDivMs;
+        pxInfo->lTriggerPoint = pxOut->xResult.iTriggerPoint;
+
+        uint32_t ulTagBefore = pxRef->ulRefTag;
+        uint32_t ulEpochBefore = pxRef->ulKeyEpoch;
+        uint32_t ulEncodeStart = ulMetricsCycles();
+        TRACE_BEGIN(TRACE_ENCODE);
+        size_t xLen = xEncodeForStream(pxRef, pxInfo, pxOut->usSamples, pxRender->usPoints,
+                                       pxView->ucFrameEncoding, pxView->ucFrameFlags,
+                                       pxFrame->ucData, sizeof(pxFrame->ucData));
+        TRACE_END(TRACE_ENCODE);
+        vMetricsStageAdd(METRICS_STAGE_ENCODE, ulMetricsCycles() - ulEncodeStart);
+        if (xLen == 0) continue;
+
+        pxFrame->ucClientMask = (uint8_t) (1u << ucSlot);
+        pxFrame->ulGeneration[ucSlot] = ulGeneration;
+        pxFrame->usLen = (uint16_t) xLen;
+        vFrameQueueCommit();
+        bQueued = true;
+
+        if (ulSharedCount < sizeof(xShared) / sizeof(xShared[0])) {
+            xShared[ulSharedCount++] = (SharedFrame_t) {
+                .pxFrame = pxFrame, .pxRender = pxRender, .pxRefAfter = pxRef,
+                .ulRefTagBefore = ulTagBefore, .ulKeyEpochBefore = ulEpochBefore,
+                .usVertLo = pxInfo->usVertLo, .usVertHi = pxInfo->usVertHi,
+                .ucView = ucView, .ucEncoding = pxView->ucFrameEncoding, .ucFlags = pxView->ucFrameFlags,
+            };
+        }
+    }
+    return bQueued;
+}
+
+static bool bAnyClientOpen(void) {
+    for (uint8_t i = 0; i < DSP_MAX_CLIENTS; i++) {
+        if (xLinks[i].ulGeneration & 1u) return true;
+    }
+    return false;
+}
+
+/* Task: DSP
+ * Woken by scope_data on every publish (or after ~50 ms to keep viewers alive),
+ * turns the newest capture into frames for every open client.
+ */
+void vDspTask(void* pvParameters) {
+    (void) pvParameters;
+    const TickType_t xUpdatePeriod = pdMS_TO_TICKS(50);  // ~20 FPS fallback
+    uint32_t ulSequence = 0;
+
+    iConsumer = iScopeDataRegisterConsumer("dsp", xTaskGetCurrentTaskHandle());
+    configASSERT(iConsumer >= 0);
+    vMetricsCyclesEnable();
+    TRACE_INIT_CORE();
+    printf("[Core%u] DSP task started\n", get_core_num());
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, xUpdatePeriod);
+        if (!bAnyClientOpen()) continue;
+
+        ScopeBuffer_t xLatest;
+        if (!bScopeDataAcquire(iConsumer, &xLatest, SCOPE_READ_LATEST)) continue;
+
+        uint32_t ulStartUs = time_us_32();
+        uint32_t ulStartCycles = ulMetricsCycles();
+        TRACE_SYNC();
+        uint32_t ulNowMs = to_ms_since_boot(get_absolute_time());
+        uint32_t ulFs = ulAdcDmaGetMeasuredSampleRate();
+
+        // Frame boundary: every client of this capture renders from one view snapshot
+        vReadViews(&xViews);
+
+        // Capture-wide fields, view fields are filled per client
+        FrameInfo_t xInfo = {0};
+        xInfo.ulConfigVersion = xViews.ulVersion;
+        xInfo.ulSequence = ulSequence++;
+        xInfo.ulTimestampMs = xLatest.ulTimestamp;
+        xInfo.ulAgeMs = (xLatest.ulTimestamp <= ulNowMs) ? (ulNowMs - xLatest.ulTimestamp) : 0;
+        xInfo.ulSampleRateHz = ulFs;
+        xInfo.ucChannel = ADC_CHANNEL;
+        xInfo.fVmin = xLatest.min_voltage;
+        xInfo.fVmax = xLatest.max_voltage;
+        xInfo.fVavg = xLatest.avg_voltage;
+
+        // Renders are memoized, so clients sharing a view share the work
+        bool bQueued = false;
+        ulSharedCount = 0;
+        for (uint8_t ucSlot = 0; ucSlot < DSP_MAX_CLIENTS; ucSlot++) {
+            if (bProcessClient(ucSlot, &xLatest, ulFs, &xInfo)) bQueued = true;
+        }
+        // One publish per capture: shared frames got all their clients by now
+        vFrameQueuePublish();
+
+        // Unpin the block so the producer can reuse its slot
+        vScopeDataRelease(iConsumer);
+
+        vMetricsStageAdd(METRICS_STAGE_CAPTURE, ulMetricsCycles() - ulStartCycles);
+        ulTimingLastUs = time_us_32() - ulStartUs;
+        if (ulTimingLastUs > ulTimingMaxUs) ulTimingMaxUs = ulTimingLastUs;
+
+        if (bQueued && pxFramesReady != NULL) pxFramesReady();
+    }
+}
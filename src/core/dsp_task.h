@@ -0,0 +1,60 @@
+#ifndef DSP_TASK_H
+#define DSP_TASK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "command_handler.h"
+#include "scope_data.h"
+
+/*
+ * DSP task: published captures -> ready-to-send frames
+ *
+ * Runs pinned to core 1. For every published buffer it computes statistics,
+ * renders each client's view (trigger search, decimation, zoom) and encodes
+ * the frames into the lock-free frame queue (core/frame_queue.h). The network
+ * task on core 0 only drains that queue into the sockets, so Wi-Fi stalls never
+ * delay DSP and DSP never delays network polling.
+ *
+ * Clients are identified by slot (0..DSP_MAX_CLIENTS-1). The network task owns
+ * the slots and tells the DSP task about them through the functions below; a
+ * slot's generation changes on every open and close, so frames encoded for a
+ * previous occupant are recognised and discarded.
+ */
+
+#define DSP_MAX_CLIENTS 4
+
+/* Task entry; registers as a scope_data consumer (newest block first) */
+void vDspTask(void* pvParameters);
+
+/* Called (from the DSP task) after frames were queued */
+typedef void (*DspFramesReadyFn_t)(void);
+void vDspSetFramesReadyHook(DspFramesReadyFn_t pxHook);
+
+/* Network task side of a client slot.
+ * Views are staged with vDspClientSetView() and handed over together by
+ * ulDspPublishViews() as one snapshot with a new version (seqlock, no lock on
+ * either side). The DSP task takes the snapshot once per capture, so all of a
+ * capture's frames are built from the same configuration and a half-applied
+ * change is never seen. Frames carry the low 16 bits of the snapshot version
+ * (FrameHeader_t.usConfigVersion). Opening a slot publishes its view at once.
+ */
+void vDspClientOpen(uint8_t ucSlot, const ScopeViewConfig_t* pxView);
+void vDspClientClose(uint8_t ucSlot);
+void vDspClientSetView(uint8_t ucSlot, const ScopeViewConfig_t* pxView);
+uint32_t ulDspPublishViews(void);                             // Version now visible to the DSP task
+void vDspClientSetCredit(uint8_t ucSlot, bool bCanSend);     // false => skip frames for now
+uint32_t ulDspClientGeneration(uint8_t ucSlot);
+uint32_t ulDspClientDropped(uint8_t ucSlot);                  // Frames skipped (no credit / queue full)
+
+/* Processing time per capture in microseconds (last, max) */
+void vDspGetTiming(uint32_t* pulLastUs, uint32_t* pulMaxUs);
+
+/* Frames a client joined instead of encoding its own copy (same view and reference) */
+uint32_t ulDspFramesShared(void);
+
+/* Scope ring counters of the DSP consumer (false before the task registered) */
+bool bDspGetInputStats(ScopeConsumerStats_t* pxStats);
+
+#endif /* DSP_TASK_H */
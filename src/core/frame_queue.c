@@ -0,0 +1,75 @@
+#include "frame_queue.h"
+
+_Static_assert((FRAME_QUEUE_SLOTS & (FRAME_QUEUE_SLOTS - 1u)) == 0, "FRAME_QUEUE_SLOTS must be a power of two");
+
+static QueuedFrame_t xSlots[FRAME_QUEUE_SLOTS];
+
+/* Free-running indices: head written by the producer, tail by the consumer */
+static uint32_t ulHead = 0;
+static uint32_t ulTail = 0;
+
+/* Producer only: frames committed but not yet published */
+static uint32_t ulPending = 0;
+/* Consumer only: next frame to take (tail <= read <= head) */
+static uint32_t ulRead = 0;
+
+/* Producer-side counters */
+static uint32_t ulCommitted = 0;
+static uint32_t ulFull = 0;
+static uint32_t ulMaxDepth = 0;
+
+QueuedFrame_t* pxFrameQueueReserve(void) {
+    uint32_t ulH = __atomic_load_n(&ulHead, __ATOMIC_RELAXED) + ulPending;
+    uint32_t ulT = __atomic_load_n(&ulTail, __ATOMIC_ACQUIRE);
+    if (ulH - ulT >= FRAME_QUEUE_SLOTS) {
+        ulFull++;
+        return NULL;
+    }
+    return &xSlots[ulH & (FRAME_QUEUE_SLOTS - 1u)];
+}
+
+void vFrameQueueCommit(void) {
+    ulPending++;
+    ulCommitted++;
+}
+
+void vFrameQueuePublish(void) {
+    if (ulPending == 0) return;
+    uint32_t ulH = __atomic_load_n(&ulHead, __ATOMIC_RELAXED) + ulPending;
+    ulPending = 0;
+    /* Release: the slot contents are visible before the new head */
+    __atomic_store_n(&ulHead, ulH, __ATOMIC_RELEASE);
+    uint32_t ulDepth = ulH - __atomic_load_n(&ulTail, __ATOMIC_ACQUIRE);
+    if (ulDepth > ulMaxDepth) ulMaxDepth = ulDepth;
+}
+
+QueuedFrame_t* pxFrameQueueTake(void) {
+    uint32_t ulH = __atomic_load_n(&ulHead, __ATOMIC_ACQUIRE);
+    if (ulH == ulRead) return NULL;
+    QueuedFrame_t* pxFrame = &xSlots[ulRead & (FRAME_QUEUE_SLOTS - 1u)];
+    pxFrame->ucRefs = 1;
+    ulRead++;
+    return pxFrame;
+}
+
+void vFrameQueueRetain(QueuedFrame_t* pxFrame) {
+    pxFrame->ucRefs++;
+}
+
+void vFrameQueueRelease(QueuedFrame_t* pxFrame) {
+    if (pxFrame == NULL || pxFrame->ucRefs == 0) return;
+    if (--pxFrame->ucRefs != 0) return;
+
+    /* Recycle the released prefix; a held slot keeps later ones until it goes */
+    uint32_t ulT = __atomic_load_n(&ulTail, __ATOMIC_RELAXED);
+    uint32_t ulNew = ulT;
+    while (ulNew != ulRead && xSlots[ulNew & (FRAME_QUEUE_SLOTS - 1u)].ucRefs == 0) ulNew++;
+    /* Release: we are done reading the slots before the producer may reuse them */
+    if (ulNew != ulT) __atomic_store_n(&ulTail, ulNew, __ATOMIC_RELEASE);
+}
+
+void vFrameQueueGetStats(uint32_t* pulCommitted, uint32_t* pulFull, uint32_t* pulMaxDepth) {
+    if (pulCommitted) *pulCommitted = ulCommitted;
+    if (pulFull) *pulFull = ulFull;
+    if (pulMaxDepth) *pulMaxDepth = ulMaxDepth;
+}
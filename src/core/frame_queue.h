@@ -0,0 +1,58 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "command_handler.h"
+#include "dsp_task.h"
+#include "net/frame_codec.h"
+
+/*
+ * Lock-free frame queue (DSP task -> network task)
+ *
+ * Single producer, single consumer ring of encoded frames. The producer
+ * reserves the slot at the head, encodes straight into it and commits; the
+ * frames committed for one capture become visible together on publish, so a
+ * frame can still gain clients (ucClientMask) until then. Head and tail are
+ * only written by their owner and published with release/acquire ordering,
+ * so the two tasks can run on different cores without a lock.
+ *
+ * The consumer takes frames in order and holds them by reference count while
+ * they wait in client batches; each slot is the transmit buffer itself, so a
+ * payload shared by several clients is never copied per client. Slots are
+ * recycled in order once every holder released them.
+ *
+ * A full queue never blocks the producer: pxFrameQueueReserve() returns NULL
+ * and the frame is skipped before it is encoded.
+ */
+
+#define FRAME_QUEUE_SLOTS 16u       /* Power of two: two captures of WS_MAX_CLIENTS x FRAME_VIEW_COUNT */
+
+_Static_assert(DSP_MAX_CLIENTS <= 8, "ucClientMask holds one bit per client");
+
+typedef struct {
+    uint8_t  ucClientMask;          /* Client slots this payload is for */
+    uint8_t  ucRefs;                /* Consumer-side holders (network task only) */
+    uint16_t usLen;
+    uint32_t ulGeneration[DSP_MAX_CLIENTS]; /* Client generation at encode time (stale if it changed) */
+    uint8_t  ucData[FRAME_MAX_SIZE(VIEW_MAX_POINTS)];
+} QueuedFrame_t;
+
+/* Producer: next free slot (NULL if full), mark it filled, then make every
+ * committed frame visible to the consumer.
+ */
+QueuedFrame_t* pxFrameQueueReserve(void);
+void vFrameQueueCommit(void);
+void vFrameQueuePublish(void);
+
+/* Consumer: next frame (NULL if none), held until released. Retain adds a
+ * holder; the take itself counts as one and needs its own release.
+ */
+QueuedFrame_t* pxFrameQueueTake(void);
+void vFrameQueueRetain(QueuedFrame_t* pxFrame);
+void vFrameQueueRelease(QueuedFrame_t* pxFrame);
+
+/* Counters since boot: frames committed, reservations refused, deepest fill */
+void vFrameQueueGetStats(uint32_t* pulCommitted, uint32_t* pulFull, uint32_t* pulMaxDepth);
+
+#endif /* FRAME_QUEUE_H */
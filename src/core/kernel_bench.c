@@ -0,0 +1,197 @@
+#include "kernel_bench.h"
+#include "trigger.h"
+#include "scope_data.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef enum {
+    BENCH_SIGNAL_SINE = 0,
+    BENCH_SIGNAL_SQUARE,
+    BENCH_SIGNAL_NOISE,
+    BENCH_SIGNAL_NO_CROSS,
+    BENCH_SIGNAL_COUNT
+} BenchSignal_e;
+
+static const char *const pcSignalNames[BENCH_SIGNAL_COUNT] = { "sine", "square", "noise", "no_cross" };
+
+static const uint32_t ulBuffers[] = { 256u, 1024u, 4096u, 16384u };
+static const uint32_t ulWidths[] = { 128u, 256u, 512u, 1024u };
+static const float fEdgeAt[] = { 0.1f, 0.5f, 0.9f };
+
+#define BENCH_PERIOD        64u         /* Samples per period of sine / square */
+#define BENCH_LOW           1000u       /* Below the default trigger band (2048 +- 50) */
+
+static uint16_t usSrc[KERNEL_BENCH_MAX_BUFFER];
+static uint16_t usDst[KERNEL_BENCH_MAX_WIDTH];
+
+/* Keeps the optimiser from dropping the timed calls */
+static volatile uint32_t ulSink;
+
+static void vFillSignal(BenchSignal_e eSignal, uint32_t ulLen, float fEdgeAtFrac) {
+    uint32_t ulEdge = eSignal == BENCH_SIGNAL_NO_CROSS ? ulLen : (uint32_t) (fEdgeAtFrac * (float) ulLen);
+    uint32_t ulNoise = 0x9E3779B9u;
+    for (uint32_t i = 0; i < ulLen; i++) {
+        if (i < ulEdge) {
+            usSrc[i] = BENCH_LOW;
+            continue;
+        }
+        uint32_t ulPhase = (i - ulEdge) % BENCH_PERIOD;
+        switch (eSignal) {
+            case BENCH_SIGNAL_SINE:
+                /* Starts at the bottom, first rising edge half a period in; sampled
+                 * half a sample off the level so one step clears the band
+                 */
+                usSrc[i] = (uint16_t) (2048.0f - 1800.0f * cosf(6.2831853f * ((float) ulPhase + 0.5f) / BENCH_PERIOD));
+                break;
+            case BENCH_SIGNAL_SQUARE:
+                usSrc[i] = ulPhase < BENCH_PERIOD / 2u ? 3800u : 300u;
+                break;
+            case BENCH_SIGNAL_NOISE:
+                ulNoise ^= ulNoise << 13;
+                ulNoise ^= ulNoise >> 17;
+                ulNoise ^= ulNoise << 5;
+                usSrc[i] = (uint16_t) (ulNoise & 0x0FFFu);
+                break;
+            default:
+                usSrc[i] = BENCH_LOW;
+                break;
+        }
+    }
+}
+
+typedef struct {
+    const char *pcKernel;
+    uint32_t ulBuffer;
+    uint32_t ulWidth;            // 0: n/a
+    BenchSignal_e eSignal;
+    float fEdgeAt;               // < 0: n/a
+    int iTriggered;              // -1: n/a
+    uint32_t ulSamples;
+} BenchCase_t;
+
+typedef struct {
+    const KernelBenchConfig_t *pxConfig;
+    uint32_t ulResults;
+} BenchRun_t;
+
+/* One call of the kernel under test; returns something derived from its output */
+typedef uint32_t (*BenchCall_t)(const BenchCase_t *pxCase, const void *pvArg);
+
+static void vMeasure(BenchRun_t *pxRun, const BenchCase_t *pxCase, BenchCall_t pxCall, const void *pvArg) {
+    const KernelBenchConfig_t *pxCfg = pxRun->pxConfig;
+    uint32_t ulIterations = 1;
+    uint32_t ulTicks = 0;
+
+    /* Double the batch until it takes long enough to time */
+    for (;;) {
+        uint32_t ulStart = pxCfg->pxClock();
+        for (uint32_t i = 0; i < ulIterations; i++) ulSink += pxCall(pxCase, pvArg);
+        ulTicks = pxCfg->pxClock() - ulStart;
+        if (ulTicks >= pxCfg->ulMinTicks || ulIterations >= (1u << 30)) break;
+        ulIterations *= 2u;
+    }
+
+    double dPerCall = (double) ulTicks / (double) ulIterations;
+    double dPerSample = dPerCall / (double) pxCase->ulSamples;
+    double dNsPerSample = dPerSample * 1e9 / (double) pxCfg->ulTickHz;
+
+    char acWidth[12], acEdge[12];
+    if (pxCase->ulWidth) snprintf(acWidth, sizeof(acWidth), "%lu", (unsigned long) pxCase->ulWidth);
+    else snprintf(acWidth, sizeof(acWidth), "null");
+    if (pxCase->fEdgeAt >= 0.0f) snprintf(acEdge, sizeof(acEdge), "%.2f", (double) pxCase->fEdgeAt);
+    else snprintf(acEdge, sizeof(acEdge), "null");
+
+    printf("%s{\"kernel\":\"%s\",\"buffer\":%lu,\"width\":%s,\"signal\":\"%s\",\"edge_at\":%s,\"triggered\":%s,"
+           "\"samples\":%lu,\"iterations\":%lu,\"ticks_per_call\":%.1f,\"ticks_per_sample\":%.4f,"
+           "\"ns_per_sample\":%.4f,\"samples_per_s\":%.4g}",
+           pxRun->ulResults ? ",\n" : "", pxCase->pcKernel, (unsigned long) pxCase->ulBuffer, acWidth,
+           pcSignalNames[pxCase->eSignal], acEdge,
+           pxCase->iTriggered < 0 ? "null" : (pxCase->iTriggered ? "true" : "false"),
+           (unsigned long) pxCase->ulSamples, (unsigned long) ulIterations, dPerCall, dPerSample, dNsPerSample,
+           dNsPerSample > 0.0 ? 1e9 / dNsPerSample : 0.0);
+    pxRun->ulResults++;
+}
+
+static uint32_t ulCallBuildFrame(const BenchCase_t *pxCase, const void *pvArg) {
+    TriggerResult_t xRes;
+    bTriggerBuildFrame(usSrc, pxCase->ulBuffer, 0, (const TriggerConfig_t *) pvArg, usDst, pxCase->ulWidth, &xRes);
+    return usDst[0] + (uint32_t) xRes.iTriggerIndex;
+}
+
+static uint32_t ulCallFindTrigger(const BenchCase_t *pxCase, const void *pvArg) {
+    const TriggerConfig_t *pxCfg = (const TriggerConfig_t *) pvArg;
+    float fCross;
+    return (uint32_t) lTriggerFindEdge(usSrc, 0, pxCase->ulBuffer, pxCfg->uLevelCounts, pxCfg->eEdge,
+                                       pxCfg->uHysteresis, &fCross);
+}
+
+static uint32_t ulCallDecimate(const BenchCase_t *pxCase, const void *pvArg) {
+    const TriggerResult_t *pxLoc = (const TriggerResult_t *) pvArg;
+    uint32_t ulStart_q16 = (uint32_t) llroundf(pxLoc->fStart * 65536.0f);
+    vTriggerDecimateLinear(usSrc, pxCase->ulBuffer, ulStart_q16, pxLoc->uLen, usDst, pxCase->ulWidth);
+    return usDst[pxCase->ulWidth - 1u];
+}
+
+static uint32_t ulCallStatistics(const BenchCase_t *pxCase, const void *pvArg) {
+    (void) pvArg;
+    ScopeBuffer_t xBuf = { .pusSamples = usSrc };
+    vScopeDataCalculateStatistics(&xBuf, pxCase->ulBuffer);
+    return (uint32_t) xBuf.max_voltage;
+}
+
+uint32_t ulKernelBenchRun(const KernelBenchConfig_t *pxConfig) {
+    if (pxConfig == NULL || pxConfig->pxClock == NULL || pxConfig->ulTickHz == 0) return 0;
+    BenchRun_t xRun = { pxConfig, 0 };
+    uint32_t ulMaxBuffer = pxConfig->ulMaxBuffer;
+    if (ulMaxBuffer == 0 || ulMaxBuffer > KERNEL_BENCH_MAX_BUFFER) ulMaxBuffer = KERNEL_BENCH_MAX_BUFFER;
+
+    TriggerConfig_t xTrig;
+    vTriggerInitDefault(&xTrig);
+
+    printf("{\"bench\":\"kernels\",\"label\":\"%s\",\"tick_unit\":\"%s\",\"tick_hz\":%lu,\"results\":[\n",
+           pxConfig->pcLabel ? pxConfig->pcLabel : "", pxConfig->pcTickUnit ? pxConfig->pcTickUnit : "ticks",
+           (unsigned long) pxConfig->ulTickHz);
+
+    for (size_t b = 0; b < sizeof(ulBuffers) / sizeof(ulBuffers[0]); b++) {
+        uint32_t ulBuffer = ulBuffers[b];
+        if (ulBuffer > ulMaxBuffer) continue;
+
+        for (int s = 0; s < BENCH_SIGNAL_COUNT; s++) {
+            BenchSignal_e eSignal = (BenchSignal_e) s;
+            /* The edge position means nothing without an edge */
+            size_t xEdges = eSignal == BENCH_SIGNAL_NO_CROSS ? 1 : sizeof(fEdgeAt) / sizeof(fEdgeAt[0]);
+            for (size_t e = 0; e < xEdges; e++) {
+                float fEdge = eSignal == BENCH_SIGNAL_NO_CROSS ? -1.0f : fEdgeAt[e];
+                vFillSignal(eSignal, ulBuffer, fEdge);
+
+                float fCross;
+                int lEdge = lTriggerFindEdge(usSrc, 0, ulBuffer, xTrig.uLevelCounts, xTrig.eEdge, xTrig.uHysteresis, &fCross);
+                BenchCase_t xCase = { "find_trigger", ulBuffer, 0, eSignal, fEdge, lEdge >= 0, ulBuffer };
+                vMeasure(&xRun, &xCase, ulCallFindTrigger, &xTrig);
+
+                for (size_t w = 0; w < sizeof(ulWidths) / sizeof(ulWidths[0]); w++) {
+                    TriggerResult_t xLoc;
+                    bTriggerLocate(usSrc, ulBuffer, 0, &xTrig, ulWidths[w], &xLoc);
+                    xCase = (BenchCase_t) { "build_frame", ulBuffer, ulWidths[w], eSignal, fEdge, xLoc.bTriggered, ulBuffer };
+                    vMeasure(&xRun, &xCase, ulCallBuildFrame, &xTrig);
+                }
+            }
+        }
+
+        /* Signal-independent kernels: one sine buffer */
+        vFillSignal(BENCH_SIGNAL_SINE, ulBuffer, 0.0f);
+        for (size_t w = 0; w < sizeof(ulWidths) / sizeof(ulWidths[0]); w++) {
+            TriggerResult_t xLoc;
+            bTriggerLocate(usSrc, ulBuffer, 0, &xTrig, ulWidths[w], &xLoc);
+            BenchCase_t xCase = { "decimate", ulBuffer, ulWidths[w], BENCH_SIGNAL_SINE, -1.0f, -1, xLoc.uLen };
+            vMeasure(&xRun, &xCase, ulCallDecimate, &xLoc);
+        }
+        BenchCase_t xCase = { "statistics", ulBuffer, 0, BENCH_SIGNAL_SINE, -1.0f, -1, ulBuffer };
+        vMeasure(&xRun, &xCase, ulCallStatistics, NULL);
+    }
+
+    printf("\n]}\n");
+    return xRun.ulResults;
+}
@@ -0,0 +1,55 @@
+#ifndef KERNEL_BENCH_H
+#define KERNEL_BENCH_H
+
+#include <stdint.h>
+
+/*
+ * Micro-benchmark sweep of the per-capture DSP kernels
+ *
+ *  - build_frame   bTriggerBuildFrame (trigger search + resampling)
+ *  - find_trigger  lTriggerFindEdge over the whole buffer
+ *  - decimate      vTriggerDecimateLinear over the span bTriggerLocate picks
+ *  - statistics    vScopeDataCalculateStatistics
+ *
+ * swept over buffer sizes, display widths, the position of the first edge
+ * (fraction of the buffer; the signal sits below the trigger band before it)
+ * and signal types: sine, square, noise and no_cross (flat, never crosses, so
+ * the search scans everything).
+ *
+ * Each case is repeated until it took at least ulMinTicks of the supplied
+ * clock. Results are printed to stdout as one JSON object, one result per
+ * line so runs diff cleanly:
+ *
+ *   {"bench":"kernels","label":"...","tick_unit":"ns","tick_hz":1000000000,"results":[
+ *   {"kernel":"build_frame","buffer":1024,"width":256,"signal":"sine","edge_at":0.50,
+ *    "triggered":true,"samples":1024,"iterations":4096,"ticks_per_call":812.4,
+ *    "ticks_per_sample":0.793,"ns_per_sample":0.793,"samples_per_s":1.26e9},
+ *   ...]}
+ *
+ * "samples" is the number of input samples one call covers (the span for
+ * decimate), so ticks_per_sample and samples_per_s compare across kernels.
+ * width / edge_at are null where the kernel does not depend on them.
+ *
+ * The host tool (host/bench_kernels.c) times in nanoseconds; the firmware,
+ * built with -DPICOSCOPE_KERNEL_BENCH=ON, runs the same sweep in a task at
+ * boot and reports DWT cycles (tick_unit "cycles", tick_hz = clk_sys).
+ */
+
+#define KERNEL_BENCH_MAX_BUFFER     16384u
+#define KERNEL_BENCH_MAX_WIDTH      1024u
+
+typedef uint32_t (*KernelBenchClock_t)(void);
+
+typedef struct {
+    KernelBenchClock_t pxClock;  // Free-running tick counter (wraps)
+    const char *pcTickUnit;      // "ns", "cycles"
+    uint32_t ulTickHz;           // Ticks per second
+    uint32_t ulMinTicks;         // Measurement length per case (< 2^31)
+    uint32_t ulMaxBuffer;        // Largest buffer size swept (<= KERNEL_BENCH_MAX_BUFFER)
+    const char *pcLabel;         // Copied into the output (e.g. commit id), may be NULL
+} KernelBenchConfig_t;
+
+/* Run the sweep and print the JSON; returns the number of results */
+uint32_t ulKernelBenchRun(const KernelBenchConfig_t *pxConfig);
+
+#endif /* KERNEL_BENCH_H */
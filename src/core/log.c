@@ -0,0 +1,101 @@
+#include "log.h"
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+
+_Static_assert((LOG_RING_RECORDS & (LOG_RING_RECORDS - 1u)) == 0, "ring index is masked");
+
+#define LOG_FORMAT(id, fmt) [id] = fmt,
+static const char *const pcFormats[LOG_MESSAGE_COUNT] = {
+    LOG_MESSAGES(LOG_FORMAT)
+};
+#undef LOG_FORMAT
+
+/* Bounded multi-producer ring. For the slot at position p (index i = p % N),
+ * ulLap is p - i while the slot is free for p and p - i + 1 once the record
+ * for p is complete; printing frees it for p + N. All zero is the empty ring,
+ * so records logged before the scheduler starts are kept.
+ */
+typedef struct {
+    uint32_t ulLap;
+    uint32_t ulTimeUs;
+    uint16_t usId;
+    uint16_t usArgCount;
+    uint32_t ulArgs[LOG_MAX_ARGS];
+} LogRecord_t;
+
+static LogRecord_t xRing[LOG_RING_RECORDS];
+static uint32_t ulHead = 0;                  // Next position to claim (producers)
+static uint32_t ulTail = 0;                  // Next position to print (vLogTask only)
+static uint32_t ulDropped = 0;
+
+void vLogWrite(LogId_e eId, const uint32_t *pulArgs, uint32_t ulArgCount) {
+    uint32_t ulPos = __atomic_load_n(&ulHead, __ATOMIC_RELAXED);
+    LogRecord_t *pxRec;
+    for (;;) {
+        pxRec = &xRing[ulPos & (LOG_RING_RECORDS - 1u)];
+        uint32_t ulBase = ulPos & ~(LOG_RING_RECORDS - 1u);
+        uint32_t ulLap = __atomic_load_n(&pxRec->ulLap, __ATOMIC_ACQUIRE);
+        if (ulLap == ulBase) {
+            // Free for this position: claim it (another producer may get there first)
+            if (__atomic_compare_exchange_n(&ulHead, &ulPos, ulPos + 1u, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if ((int32_t) (ulLap - ulBase) < 0) {
+            // Still holds the record from the previous lap: full
+            __atomic_fetch_add(&ulDropped, 1u, __ATOMIC_RELAXED);
+            return;
+        } else {
+            ulPos = __atomic_load_n(&ulHead, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (ulArgCount > LOG_MAX_ARGS) ulArgCount = LOG_MAX_ARGS;
+    pxRec->ulTimeUs = time_us_32();
+    pxRec->usId = (uint16_t) eId;
+    pxRec->usArgCount = (uint16_t) ulArgCount;
+    for (uint32_t i = 0; i < ulArgCount; i++) pxRec->ulArgs[i] = pulArgs[i];
+    __atomic_store_n(&pxRec->ulLap, (ulPos & ~(LOG_RING_RECORDS - 1u)) + 1u, __ATOMIC_RELEASE);
+}
+
+uint32_t ulLogDropped(void) {
+    return __atomic_load_n(&ulDropped, __ATOMIC_RELAXED);
+}
+
+static void vPrintRecord(const LogRecord_t *pxRec) {
+    unsigned long a[LOG_MAX_ARGS] = {0};
+    for (uint32_t i = 0; i < pxRec->usArgCount; i++) a[i] = pxRec->ulArgs[i];
+    const char *pcFormat = pxRec->usId < LOG_MESSAGE_COUNT ? pcFormats[pxRec->usId] : "?";
+    printf("[%6lu.%03lu] ", (unsigned long) (pxRec->ulTimeUs / 1000000u),
+           (unsigned long) (pxRec->ulTimeUs / 1000u % 1000u));
+    printf(pcFormat, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+    putchar('\n');
+}
+
+/* Task: Deferred log output
+ * Prints whatever was logged since the last pass; runs only when nothing else
+ * wants the CPU, so USB stdio never delays acquisition or streaming.
+ */
+void vLogTask(void *pvParameters) {
+    (void) pvParameters;
+    uint32_t ulReportedDrops = 0;
+
+    for (;;) {
+        for (;;) {
+            LogRecord_t *pxRec = &xRing[ulTail & (LOG_RING_RECORDS - 1u)];
+            uint32_t ulBase = ulTail & ~(LOG_RING_RECORDS - 1u);
+            if (__atomic_load_n(&pxRec->ulLap, __ATOMIC_ACQUIRE) != ulBase + 1u) break;
+            LogRecord_t xCopy = *pxRec;
+            __atomic_store_n(&pxRec->ulLap, ulBase + LOG_RING_RECORDS, __ATOMIC_RELEASE);
+            ulTail++;
+            vPrintRecord(&xCopy);
+        }
+
+        uint32_t ulDrops = ulLogDropped();
+        if (ulDrops != ulReportedDrops) {
+            printf("log: %lu records dropped (ring full)\n", (unsigned long) (ulDrops - ulReportedDrops));
+            ulReportedDrops = ulDrops;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+    }
+}
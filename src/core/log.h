@@ -0,0 +1,64 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+/*
+ * Deferred binary logging
+ *
+ * A log call stores a message id and up to LOG_MAX_ARGS 32-bit arguments in a
+ * lock-free ring (multi-producer, any task on either core; not from
+ * interrupts) and returns: no formatting, no USB CDC. vLogTask, at the lowest
+ * priority, formats and prints the records with the time they were logged.
+ * If the ring is full the record is dropped and counted; the count is printed
+ * with the next records and exported as picoscope_log_dropped_total.
+ *
+ * Messages are declared in LOG_MESSAGES below. Arguments are printed as
+ * unsigned long, so formats take %lu (or %%) only.
+ *
+ *   LOG(LOG_ADC_STOP);
+ *   LOG(LOG_ADC_RATE_CHANGED, ulHz);
+ *
+ * IPv4 addresses go in as four octet arguments (%lu.%lu.%lu.%lu).
+ */
+
+#define LOG_MAX_ARGS        8u
+#define LOG_RING_RECORDS    64u     /* Power of two */
+#define LOG_DRAIN_MS        20u     /* vLogTask poll period */
+
+#define LOG_MESSAGES(X) \
+    X(LOG_ADC_INIT,          "ADC_DMA: Initializing...") \
+    X(LOG_ADC_STOP,          "ADC_DMA: Stopping...") \
+    X(LOG_ADC_RATE,          "ADC: target=%lu Hz, clk_adc=%lu Hz, clkdiv=%lu, actual=%lu Hz") \
+    X(LOG_ADC_RATE_CHANGED,  "Sample rate changed to %lu Hz") \
+    X(LOG_WS_CONNECTED,      "WS client connected (%lu total)") \
+    X(LOG_WS_DISCONNECTED,   "WS client disconnected (%lu total)") \
+    X(LOG_SCPI_CONNECTED,    "SCPI client connected from %lu.%lu.%lu.%lu") \
+    X(LOG_SCPI_DISCONNECTED, "SCPI client disconnected (%lu.%lu.%lu.%lu)") \
+    X(LOG_UDP_SUBSCRIBED,    "UDP stream for client %lu -> %lu.%lu.%lu.%lu:%lu") \
+    X(LOG_REPORT_LOAD,       "Load: core0 %lu%% core1 %lu%% | ADC %lu overruns | DSP %lu us (max %lu), %lu captures, %lu skipped") \
+    X(LOG_REPORT_FRAMES,     "Frames: %lu clients, %lu renders, %lu cache hits, %lu queued (depth max %lu), %lu queue full, %lu shared") \
+    X(LOG_REPORT_TX,         "TX: %lu B direct, %lu B buffered, %lu UDP datagrams (%lu errors)") \
+    X(LOG_REPORT_POOL,       "mg pool: conn %lu/%lu io %lu/%lu io2 %lu/%lu (high water), %lu heap, %lu failed")
+
+#define LOG_ENUM(id, fmt) id,
+typedef enum {
+    LOG_MESSAGES(LOG_ENUM)
+    LOG_MESSAGE_COUNT
+} LogId_e;
+#undef LOG_ENUM
+
+/* Queue one record; pulArgs holds ulArgCount values (extra ones are ignored) */
+void vLogWrite(LogId_e eId, const uint32_t *pulArgs, uint32_t ulArgCount);
+
+#define LOG(id, ...) \
+    vLogWrite((id), (const uint32_t[]) { 0u, ##__VA_ARGS__ } + 1, \
+              (uint32_t) (sizeof((const uint32_t[]) { 0u, ##__VA_ARGS__ }) / sizeof(uint32_t) - 1u))
+
+/* Records dropped because the ring was full */
+uint32_t ulLogDropped(void);
+
+/* Task: formats and prints queued records (create at tskIDLE_PRIORITY) */
+void vLogTask(void *pvParameters);
+
+#endif /* LOG_H */
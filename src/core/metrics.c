@@ -0,0 +1,74 @@
+#include "metrics.h"
+#include <string.h>
+
+const uint16_t usMetricsLatencyBoundsMs[METRICS_LATENCY_BOUNDS] = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000,
+};
+
+static const char *const pcStageNames[METRICS_STAGE_COUNT] = {
+    [METRICS_STAGE_PUBLISH]   = "publish",
+    [METRICS_STAGE_RENDER]    = "render",
+    [METRICS_STAGE_ENCODE]    = "encode",
+    [METRICS_STAGE_CAPTURE]   = "capture",
+    [METRICS_STAGE_NET_DRAIN] = "net_drain",
+};
+
+/* One writer per stage; readers on the other core may see a torn update and retry */
+static MetricsStageStats_t xStages[METRICS_STAGE_COUNT];
+static volatile uint32_t ulStageSeq[METRICS_STAGE_COUNT];
+
+/* Network task only */
+static MetricsLatency_t xLatency;
+
+void vMetricsStageAdd(MetricsStage_e eStage, uint32_t ulCycles) {
+    if (eStage >= METRICS_STAGE_COUNT) return;
+    MetricsStageStats_t *pxStage = &xStages[eStage];
+    __atomic_store_n(&ulStageSeq[eStage], ulStageSeq[eStage] + 1u, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    pxStage->ulRuns++;
+    pxStage->ulLastCycles = ulCycles;
+    if (ulCycles > pxStage->ulMaxCycles) pxStage->ulMaxCycles = ulCycles;
+    pxStage->ullTotalCycles += ulCycles;
+    __atomic_store_n(&ulStageSeq[eStage], ulStageSeq[eStage] + 1u, __ATOMIC_RELEASE);
+}
+
+void vMetricsGetStage(MetricsStage_e eStage, MetricsStageStats_t *pxStats) {
+    if (eStage >= METRICS_STAGE_COUNT) {
+        memset(pxStats, 0, sizeof(*pxStats));
+        return;
+    }
+    for (;;) {
+        uint32_t ulSeq = __atomic_load_n(&ulStageSeq[eStage], __ATOMIC_ACQUIRE);
+        if (ulSeq & 1u) continue;
+        *pxStats = xStages[eStage];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&ulStageSeq[eStage], __ATOMIC_RELAXED) == ulSeq) return;
+    }
+}
+
+const char *pcMetricsStageName(MetricsStage_e eStage) {
+    return eStage < METRICS_STAGE_COUNT ? pcStageNames[eStage] : "?";
+}
+
+void vMetricsRecordLatency(uint32_t ulMs) {
+    uint32_t i = 0;
+    while (i < METRICS_LATENCY_BOUNDS && ulMs > usMetricsLatencyBoundsMs[i]) i++;
+    xLatency.ulBucket[i]++;
+    xLatency.ulCount++;
+    xLatency.ullSumMs += ulMs;
+}
+
+void vMetricsGetLatency(MetricsLatency_t *pxLatency) {
+    *pxLatency = xLatency;
+}
+
+uint32_t ulMetricsLatencyPercentile(const MetricsLatency_t *pxLatency, uint8_t ucPercent) {
+    if (pxLatency->ulCount == 0) return 0;
+    uint64_t ullRank = ((uint64_t) pxLatency->ulCount * ucPercent + 99u) / 100u;
+    uint64_t ullSeen = 0;
+    for (uint32_t i = 0; i < METRICS_LATENCY_BOUNDS; i++) {
+        ullSeen += pxLatency->ulBucket[i];
+        if (ullSeen >= ullRank) return usMetricsLatencyBoundsMs[i];
+    }
+    return UINT32_MAX;
+}
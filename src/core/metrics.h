@@ -0,0 +1,94 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Pipeline metrics that need instrumentation of their own
+ *
+ *  - Stage cycle counts: the DWT cycle counter (one per core, ARMv8-M
+ *    architectural registers) is read around each hot stage and the
+ *    difference accumulated per stage. Each stage is recorded by one task.
+ *  - Capture-to-send latency: a histogram of the time from capture completion
+ *    (FrameHeader_t.ulTimestampMs) to the frame being written to its socket,
+ *    recorded by the network task.
+ *
+ * Everything else (overruns, drops, queue depths, heap, tasks) is read from
+ * the owning modules when the metrics are rendered, see net/metrics_endpoint.h.
+ */
+
+#ifdef PICOSCOPE_SIM
+
+/* Host simulation (host/sim): nanoseconds stand in for cycles, clock_get_hz() is 1 GHz */
+#include <time.h>
+
+static inline void vMetricsCyclesEnable(void) { }
+
+static inline uint32_t ulMetricsCycles(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ((uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec);
+}
+
+#else
+
+#define METRICS_DEMCR           (*(volatile uint32_t *) 0xE000EDFCu)
+#define METRICS_DWT_CTRL        (*(volatile uint32_t *) 0xE0001000u)
+#define METRICS_DWT_CYCCNT      (*(volatile uint32_t *) 0xE0001004u)
+#define METRICS_DEMCR_TRCENA    (1u << 24)
+#define METRICS_DWT_CYCCNTENA   (1u << 0)
+
+/* Start the cycle counter of the calling core (idempotent) */
+static inline void vMetricsCyclesEnable(void) {
+    METRICS_DEMCR |= METRICS_DEMCR_TRCENA;
+    METRICS_DWT_CTRL |= METRICS_DWT_CYCCNTENA;
+}
+
+/* Cycle counter of the calling core (wraps every ~28 s at 150 MHz) */
+static inline uint32_t ulMetricsCycles(void) {
+    return METRICS_DWT_CYCCNT;
+}
+
+#endif /* PICOSCOPE_SIM */
+
+typedef enum {
+    METRICS_STAGE_PUBLISH = 0,   // Acquisition: statistics and scope ring publish
+    METRICS_STAGE_RENDER,        // DSP: trigger search and decimation of one view
+    METRICS_STAGE_ENCODE,        // DSP: encoding one frame
+    METRICS_STAGE_CAPTURE,       // DSP: whole pass over one capture
+    METRICS_STAGE_NET_DRAIN,     // Network: frame queue drain and batch flush
+    METRICS_STAGE_COUNT
+} MetricsStage_e;
+
+typedef struct {
+    uint32_t ulRuns;
+    uint32_t ulLastCycles;
+    uint32_t ulMaxCycles;
+    uint64_t ullTotalCycles;
+} MetricsStageStats_t;
+
+/* Upper bounds of the latency buckets in ms; one more bucket catches the rest */
+#define METRICS_LATENCY_BOUNDS  11u
+
+typedef struct {
+    uint32_t ulBucket[METRICS_LATENCY_BOUNDS + 1u];   // Not cumulative
+    uint32_t ulCount;
+    uint64_t ullSumMs;
+} MetricsLatency_t;
+
+extern const uint16_t usMetricsLatencyBoundsMs[METRICS_LATENCY_BOUNDS];
+
+void vMetricsStageAdd(MetricsStage_e eStage, uint32_t ulCycles);
+void vMetricsGetStage(MetricsStage_e eStage, MetricsStageStats_t *pxStats);
+const char *pcMetricsStageName(MetricsStage_e eStage);
+
+void vMetricsRecordLatency(uint32_t ulMs);
+void vMetricsGetLatency(MetricsLatency_t *pxLatency);
+
+/* Upper bound (ms) of the bucket holding the given percentile, 0 without samples,
+ * UINT32_MAX if it lies beyond the last bound.
+ */
+uint32_t ulMetricsLatencyPercentile(const MetricsLatency_t *pxLatency, uint8_t ucPercent);
+
+#endif /* METRICS_H */
@@ -1,36 +1,89 @@
 #include "scope_data.h"
+#include "trace.h"
 #include "pico/stdlib.h"
 #include <string.h>
 #include <stdio.h>
 
-/* Internal state: one ready slot and one in-use slot */
-static ScopeBuffer_t xReady = { 0 };
-static ScopeBuffer_t xInUse = { 0 };
+/* Called inside the claim and pin race windows; host/stress_scope_ring.c runs
+ * the other side there. Empty in the firmware.
+ */
+#ifdef SCOPE_DATA_RACE_HOOK
+void SCOPE_DATA_RACE_HOOK(void);
+#else
+#define SCOPE_DATA_RACE_HOOK()
+#endif
+
+_Static_assert(SCOPE_MAX_CONSUMERS < SCOPE_RING_SLOTS, "one ring slot must stay free for the producer");
+_Static_assert(NUM_BUFFERS >= SCOPE_RING_SLOTS + 2, "DMA needs a buffer to fill besides the ring and the one being published");
+
+/* One published block; xBuf is only valid while ulSeq is non-zero */
+typedef struct {
+    ScopeBuffer_t xBuf;
+    AdcBufferHandle_t xHandle;   /* DMA buffer behind xBuf.pusSamples */
+    uint32_t ulSeq;              /* Sequence of the block in this slot, 0 = empty or being rewritten */
+    uint32_t ulRefs;             /* Consumers currently holding the slot */
+} RingSlot_t;
+
+typedef struct {
+    bool         bActive;
+    const char  *pcName;
+    TaskHandle_t xNotify;
+    uint32_t     ulNext;         /* Next sequence this consumer has not seen */
+    int          iHeld;          /* Slot index pinned by this consumer, -1 = none */
+    ScopeConsumerStats_t xStats;
+} Consumer_t;
+
+static RingSlot_t xSlots[SCOPE_RING_SLOTS];
+static Consumer_t xConsumers[SCOPE_MAX_CONSUMERS];
+static uint32_t ulConsumerCount = 0;
+
+/* Last published sequence (first published block is 1, 0 means none) */
+static uint32_t ulPublishSequence = 0;
+static uint32_t ulPublishDrops = 0;
+
+/* Sequence order that survives wrap-around */
+static inline bool bSeqBefore(uint32_t ulA, uint32_t ulB) {
+    return (int32_t)(ulA - ulB) < 0;
+}
 
-/* Web server task handle for notifications */
-static TaskHandle_t xWebServerHandle = NULL;
+static inline Consumer_t *pxConsumer(int iConsumer) {
+    if (iConsumer < 0 || iConsumer >= SCOPE_MAX_CONSUMERS) return NULL;
+    Consumer_t *pxC = &xConsumers[iConsumer];
+    return __atomic_load_n(&pxC->bActive, __ATOMIC_ACQUIRE) ? pxC : NULL;
+}
 
 void vScopeDataInit(void) {
     /* Initialize internal state (set everything to zero) */
-    memset(&xReady, 0, sizeof(xReady));
-    memset(&xInUse, 0, sizeof(xInUse));
-    xWebServerHandle = NULL;
-    printf("Scope data system initialized (zero-copy, owned buffers)\n");
+    memset(xSlots, 0, sizeof(xSlots));
+    memset(xConsumers, 0, sizeof(xConsumers));
+    ulConsumerCount = 0;
+    ulPublishSequence = 0;
+    ulPublishDrops = 0;
+    printf("Scope data system initialized (zero-copy ring, %u slots)\n", (unsigned) SCOPE_RING_SLOTS);
 }
 
-/*  Save task handle for notify on publish */
-void vScopeDataSetWebServerHandle(TaskHandle_t handle) {
-    xWebServerHandle = handle;
+int iScopeDataRegisterConsumer(const char *pcName, TaskHandle_t xNotify) {
+    uint32_t ulId = __atomic_fetch_add(&ulConsumerCount, 1u, __ATOMIC_RELAXED);
+    if (ulId >= SCOPE_MAX_CONSUMERS) return -1;
+
+    Consumer_t *pxC = &xConsumers[ulId];
+    memset(pxC, 0, sizeof(*pxC));
+    pxC->pcName = pcName;
+    pxC->xNotify = xNotify;
+    pxC->iHeld = -1;
+    pxC->ulNext = __atomic_load_n(&ulPublishSequence, __ATOMIC_ACQUIRE) + 1u;
+    __atomic_store_n(&pxC->bActive, true, __ATOMIC_RELEASE);
+    return (int) ulId;
 }
 
 /* Compute min/max/avg in volts for a given buffer */
-static void vCalculateStatistics(ScopeBuffer_t *pBuffer) {
-    if (pBuffer == NULL || pBuffer->pusSamples == NULL || pBuffer->bStatsValid) return;
+void vScopeDataCalculateStatistics(ScopeBuffer_t *pBuffer, uint32_t ulLen) {
+    if (pBuffer == NULL || pBuffer->pusSamples == NULL || ulLen == 0) return;
 
     uint32_t sum = 0;
     uint16_t minv = 4095, maxv = 0;
 
-    for (uint32_t i = 0; i < ADC_BUFFER_SIZE; i++) {
+    for (uint32_t i = 0; i < ulLen; i++) {
         uint16_t s = pBuffer->pusSamples[i];
         sum += s;
         if (s < minv) minv = s;
@@ -38,94 +91,141 @@ static void vCalculateStatistics(ScopeBuffer_t *pBuffer) {
     }
 
     /* Convert raw ADC counts to volts (assumes 3.3V reference from our Pico 3.3V output, 12-bit) */
-    pBuffer->avg_voltage = ((float) sum / ADC_BUFFER_SIZE) * 3.3f / 4095.0f;
+    pBuffer->avg_voltage = ((float) sum / ulLen) * 3.3f / 4095.0f;
     pBuffer->min_voltage = (float) minv * 3.3f / 4095.0f;
     pBuffer->max_voltage = (float) maxv * 3.3f / 4095.0f;
-    pBuffer->bStatsValid = true;
 }
 
 /* Publish completed DMA buffer
- * Called by acquisition task when a DMA buffer completes.
- * If an older "ready" buffer exists, release it back to ADC (drop older).
- * Store the new buffer into the "ready" slot and notify the web task.
+ * Called by acquisition task (the only producer) when a DMA buffer completes.
+ * Takes an empty slot or the oldest one no consumer holds, returns its DMA
+ * buffer to ADC and publishes the new block there. If every slot is pinned,
+ * the new block is dropped instead. Registered consumers are notified.
  */
-void vScopeDataPublishBuffer(uint16_t *buffer, uint32_t timestamp) {
-    taskENTER_CRITICAL();
-    /* Drop older 'ready' if present (always keep the newest) */
-    if (xReady.pusSamples != NULL) {
-        vAdcDmaReleaseBuffer(xReady.pusSamples);
-    }
+void vScopeDataPublishBuffer(uint16_t *buffer, uint32_t timestamp, AdcBufferHandle_t xHandle) {
+    if (buffer == NULL) return;
+
+    uint32_t ulSeq = ulPublishSequence + 1u;
+    if (ulSeq == 0) ulSeq = 1u;                  /* 0 marks an empty slot */
+
+    bool bTried[SCOPE_RING_SLOTS] = { false };
+    RingSlot_t *pxSlot = NULL;
+    for (;;) {
+        /* Victim: an empty slot, else the oldest slot nobody holds */
+        int iVictim = -1;
+        for (int i = 0; i < SCOPE_RING_SLOTS; i++) {
+            if (bTried[i] || __atomic_load_n(&xSlots[i].ulRefs, __ATOMIC_RELAXED) != 0) continue;
+            if (xSlots[i].ulSeq == 0) { iVictim = i; break; }
+            if (iVictim < 0 || bSeqBefore(xSlots[i].ulSeq, xSlots[iVictim].ulSeq)) iVictim = i;
+        }
+        if (iVictim < 0) {
+            /* Every slot pinned: keep what consumers hold, drop the new block */
+            vAdcDmaReleaseBuffer(xHandle);
+            ulPublishDrops++;
+            return;
+        }
 
-    xReady.pusSamples = buffer;
-    xReady.ulTimestamp = timestamp;
-    xReady.bStatsValid = false;
-    taskEXIT_CRITICAL();
+        /* Claim: hide the slot, then make sure no reader pinned it meanwhile */
+        pxSlot = &xSlots[iVictim];
+        uint32_t ulOld = pxSlot->ulSeq;
+        SCOPE_DATA_RACE_HOOK();
+        __atomic_store_n(&pxSlot->ulSeq, 0u, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&pxSlot->ulRefs, __ATOMIC_SEQ_CST) == 0) {
+            if (ulOld != 0) vAdcDmaReleaseBuffer(pxSlot->xHandle);
+            break;
+        }
+        __atomic_store_n(&pxSlot->ulSeq, ulOld, __ATOMIC_SEQ_CST);
+        bTried[iVictim] = true;
+    }
 
-    /* Notify the web server task for low-latency push */
-    if (xWebServerHandle != NULL) {
-        xTaskNotifyGive(xWebServerHandle);
+    pxSlot->xHandle = xHandle;
+    pxSlot->xBuf.pusSamples = buffer;
+    pxSlot->xBuf.ulTimestamp = timestamp;
+    pxSlot->xBuf.ulSequence = ulSeq;
+    TRACE_BEGIN(TRACE_STATS);
+    vScopeDataCalculateStatistics(&pxSlot->xBuf, ADC_BUFFER_SIZE);
+    TRACE_END(TRACE_STATS);
+    __atomic_store_n(&pxSlot->ulSeq, ulSeq, __ATOMIC_RELEASE);
+    __atomic_store_n(&ulPublishSequence, ulSeq, __ATOMIC_RELEASE);
+
+    /* Notify consumers for low-latency processing */
+    for (int i = 0; i < SCOPE_MAX_CONSUMERS; i++) {
+        Consumer_t *pxC = pxConsumer(i);
+        if (pxC != NULL && pxC->xNotify != NULL) xTaskNotifyGive(pxC->xNotify);
     }
 }
 
-
-/* Web server consumer function
- * FIXED: Only promote xReady to xInUse if xInUse was returned previously.
- * This allows the consumer to hold a buffer across multiple calls.
+/* Consumer side: pick the wanted block, pin it, and re-check that the producer
+ * did not start rewriting it; retry with a fresh scan if it did.
  */
-bool bGetLatestScopeData(ScopeBuffer_t *pData, bool bCalculateStats) {
-    if (pData == NULL) return false;
-
-    ScopeBuffer_t xLocalCopy = { 0 };
-    bool bHaveData = false;
-    bool bNeedStats = false;
-
-    taskENTER_CRITICAL();
-    
-    /* FIXED: Only promote if we have a ready buffer AND no in-use buffer
-     * This lets the consumer hold the same buffer across multiple calls */
-    if (xReady.pusSamples != NULL && xInUse.pusSamples == NULL) {
-        /* Promote ready to in_use */
-        xInUse = xReady;
-        memset(&xReady, 0, sizeof(xReady));
-    }
-
-    if (xInUse.pusSamples != NULL) {
-        xLocalCopy = xInUse;
-        bHaveData = true;
-        bNeedStats = (bCalculateStats && !xInUse.bStatsValid);
-    }
-    taskEXIT_CRITICAL();
-
-    if (!bHaveData) return false;
-
-    /* Compute stats outside the critical section to minimise lock time */
-    if (bNeedStats) {
-        ScopeBuffer_t xTmp = xLocalCopy;
-        vCalculateStatistics(&xTmp);
-
-        taskENTER_CRITICAL();
-        if (xInUse.pusSamples == xLocalCopy.pusSamples) {
-            xInUse.avg_voltage = xTmp.avg_voltage;
-            xInUse.min_voltage = xTmp.min_voltage;
-            xInUse.max_voltage = xTmp.max_voltage;
-            xInUse.bStatsValid  = true;
-            xLocalCopy = xInUse;
-        } else {
-            xLocalCopy = xInUse;
+bool bScopeDataAcquire(int iConsumer, ScopeBuffer_t *pData, ScopeReadMode_e eMode) {
+    Consumer_t *pxC = pxConsumer(iConsumer);
+    if (pxC == NULL || pData == NULL) return false;
+    vScopeDataRelease(iConsumer);
+
+    for (uint32_t ulAttempt = 0; ulAttempt < 2u * SCOPE_RING_SLOTS; ulAttempt++) {
+        int iBest = -1;
+        uint32_t ulBestSeq = 0;
+        for (int i = 0; i < SCOPE_RING_SLOTS; i++) {
+            uint32_t ulSeq = __atomic_load_n(&xSlots[i].ulSeq, __ATOMIC_ACQUIRE);
+            if (ulSeq == 0 || bSeqBefore(ulSeq, pxC->ulNext)) continue;
+            bool bBetter = (eMode == SCOPE_READ_LATEST) ? bSeqBefore(ulBestSeq, ulSeq) : bSeqBefore(ulSeq, ulBestSeq);
+            if (iBest < 0 || bBetter) {
+                iBest = i;
+                ulBestSeq = ulSeq;
+            }
+        }
+        if (iBest < 0) return false;
+
+        RingSlot_t *pxSlot = &xSlots[iBest];
+        SCOPE_DATA_RACE_HOOK();
+        __atomic_fetch_add(&pxSlot->ulRefs, 1u, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&pxSlot->ulSeq, __ATOMIC_SEQ_CST) != ulBestSeq) {
+            __atomic_fetch_sub(&pxSlot->ulRefs, 1u, __ATOMIC_RELEASE);
+            pxC->xStats.ulRetries++;
+            continue;
         }
-        taskEXIT_CRITICAL();
+
+        /* Pinned: the producer leaves this slot alone until we release it */
+        *pData = pxSlot->xBuf;
+        pxC->xStats.ulDropped += ulBestSeq - pxC->ulNext;
+        pxC->xStats.ulConsumed++;
+        pxC->ulNext = ulBestSeq + 1u;
+        pxC->iHeld = iBest;
+        return true;
     }
+    return false;
+}
+
+void vScopeDataRelease(int iConsumer) {
+    Consumer_t *pxC = pxConsumer(iConsumer);
+    if (pxC == NULL || pxC->iHeld < 0) return;
+    __atomic_fetch_sub(&xSlots[pxC->iHeld].ulRefs, 1u, __ATOMIC_RELEASE);
+    pxC->iHeld = -1;
+}
 
-    *pData = xLocalCopy;
+bool bScopeDataGetConsumerStats(int iConsumer, ScopeConsumerStats_t *pxStats) {
+    Consumer_t *pxC = pxConsumer(iConsumer);
+    if (pxC == NULL || pxStats == NULL) return false;
+    *pxStats = pxC->xStats;
     return true;
 }
 
-/* Explicitly release the in-use buffer */
-void vScopeDataReleaseBuffer(void) {
-    taskENTER_CRITICAL();
-    if (xInUse.pusSamples != NULL) {
-        vAdcDmaReleaseBuffer(xInUse.pusSamples);
-        memset(&xInUse, 0, sizeof(xInUse));
+const char *pcScopeDataConsumerName(int iConsumer) {
+    Consumer_t *pxC = pxConsumer(iConsumer);
+    return pxC != NULL ? pxC->pcName : NULL;
+}
+
+bool bScopeDataHasNew(int iConsumer) {
+    Consumer_t *pxC = pxConsumer(iConsumer);
+    if (pxC == NULL) return false;
+    for (int i = 0; i < SCOPE_RING_SLOTS; i++) {
+        uint32_t ulSeq = __atomic_load_n(&xSlots[i].ulSeq, __ATOMIC_ACQUIRE);
+        if (ulSeq != 0 && !bSeqBefore(ulSeq, pxC->ulNext)) return true;
     }
-    taskEXIT_CRITICAL();
-}
\ No newline at end of file
+    return false;
+}
+
+uint32_t ulScopeDataPublishDrops(void) {
+    return ulPublishDrops;
+}
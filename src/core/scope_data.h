@@ -7,45 +7,90 @@
 #include "task.h"
 #include "drivers/adc_dma.h"
 
-/* 
- * Zero-copy scope data model
+/*
+ * Zero-copy scope data model: lock-free ring of published blocks
  *
  * Producer (Acquisition task):
- *  - Obtains a DMA buffer pointer via bAdcDmaGetLatestBufferPtr()
- *  - Publishes it to the scope layer via vScopeDataPublishBuffer()
+ *  - Obtains a DMA buffer pointer and handle via bAdcDmaGetLatestBufferPtr()
+ *  - Publishes it via vScopeDataPublishBuffer(); the block gets the next
+ *    sequence number and replaces the oldest block nobody is reading. The
+ *    replaced DMA buffer goes back to ADC via vAdcDmaReleaseBuffer(handle).
  *
- * Consumer (Web server task):
- *  - Calls bGetLatestScopeData() to obtain a stable snapshot pointer
- *  - The scope layer keeps that buffer owned ("in use") until the next consume,
- *    then releases the previous buffer back to ADC via vAdcDmaReleaseBuffer()
+ * Consumers (DSP task, measurements, recorder, ...):
+ *  - Register once and get their own read cursor and drop counters
+ *  - bScopeDataAcquire() pins a block (newest, or next in sequence) and
+ *    vScopeDataRelease() unpins it; a pinned block is never overwritten, so
+ *    each consumer reads at its own pace without holding up the others.
  *
- * This prevents DMA from overwriting the buffer being streamed.
+ * No locks: slots carry a sequence number (0 while being rewritten) and a
+ * reader count. A reader increments the count, then re-checks the sequence;
+ * the producer clears the sequence, then checks the count. Both use
+ * sequentially consistent atomics, so at least one side sees the other and
+ * backs off.
  */
 
+#define SCOPE_RING_SLOTS        4       /* Published blocks kept (each pins a DMA buffer) */
+#define SCOPE_MAX_CONSUMERS     3       /* < SCOPE_RING_SLOTS so one slot is always free */
+
 typedef struct {
     uint16_t *pusSamples;        /* Pointer to DMA buffer memory */
     uint32_t ulTimestamp;        /* Capture completion time (ms since boot) */
-    float    avg_voltage;        /* Lazily computed statistics */
+    uint32_t ulSequence;         /* Publish counter, identifies the capture (first is 1) */
+    float    avg_voltage;        /* Statistics, computed on publish */
     float    min_voltage;
     float    max_voltage;
-    volatile bool bStatsValid;   /* False => stats to be computed */
 } ScopeBuffer_t;
 
+typedef enum {
+    SCOPE_READ_LATEST = 0,       /* Newest block; older unread blocks count as dropped */
+    SCOPE_READ_NEXT              /* Oldest unread block still in the ring (in order) */
+} ScopeReadMode_e;
+
+/* Per-consumer counters */
+typedef struct {
+    uint32_t ulConsumed;         /* Blocks acquired */
+    uint32_t ulDropped;          /* Blocks published but never seen (skipped or overwritten) */
+    uint32_t ulRetries;          /* Acquires that raced the producer and retried */
+} ScopeConsumerStats_t;
+
 /* Initialize scope data system */
 void vScopeDataInit(void);
 
-/* Called by acquisition task when a DMA buffer completes */
-void vScopeDataPublishBuffer(uint16_t *buffer, uint32_t timestamp);
+/* Called by acquisition task when a DMA buffer completes; takes ownership of xHandle */
+void vScopeDataPublishBuffer(uint16_t *buffer, uint32_t timestamp, AdcBufferHandle_t xHandle);
+
+/* Register a consumer; xNotify (may be NULL) is notified on every publish.
+ * Returns the consumer id, or -1 if SCOPE_MAX_CONSUMERS are registered.
+ */
+int iScopeDataRegisterConsumer(const char *pcName, TaskHandle_t xNotify);
 
-/* Set web server task handle for notifications (xTaskNotifyGive) */
-void vScopeDataSetWebServerHandle(TaskHandle_t handle);
+/* Pin a block for consumer iConsumer and copy its descriptor to pData.
+ * Returns false if there is nothing new for this consumer. A block still
+ * held by this consumer is released first.
+ */
+bool bScopeDataAcquire(int iConsumer, ScopeBuffer_t *pData, ScopeReadMode_e eMode);
 
-/* Get latest scope data snapshot, optionally computing stats.
- * Returns true and fills pData with a stable pointer and stats.
+/* True if a block newer than the last one consumer iConsumer acquired is
+ * published. Lets a consumer keep its pinned block (e.g. while stopped)
+ * instead of acquiring, which would release it first.
  */
-bool bGetLatestScopeData(ScopeBuffer_t *pData, bool bCalculateStats);
+bool bScopeDataHasNew(int iConsumer);
+
+/* Unpin the block held by consumer iConsumer (no-op if none) */
+void vScopeDataRelease(int iConsumer);
+
+/* Counters of one consumer; false if the id is not registered */
+bool bScopeDataGetConsumerStats(int iConsumer, ScopeConsumerStats_t *pxStats);
 
-/* Release the currently held buffer (allows promotion of xReady) */
-void vScopeDataReleaseBuffer(void);
+/* Name given at registration; NULL if the id is not registered */
+const char *pcScopeDataConsumerName(int iConsumer);
+
+/* Publishes refused because every slot was pinned (new block dropped) */
+uint32_t ulScopeDataPublishDrops(void);
+
+/* Min/max/average in volts of the first ulLen samples (done on every publish;
+ * public for benchmarking)
+ */
+void vScopeDataCalculateStatistics(ScopeBuffer_t *pBuffer, uint32_t ulLen);
 
-#endif /* SCOPE_DATA_H */
\ No newline at end of file
+#endif /* SCOPE_DATA_H */
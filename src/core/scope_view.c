@@ -0,0 +1,109 @@
+#include "scope_view.h"
+#include <string.h>
+
+typedef struct {
+    ScopeRender_t xRender;
+    uint32_t      ulLastUse;
+    bool          bValid;
+} ViewCacheSlot_t;
+
+static ViewCacheSlot_t xCache[VIEW_CACHE_SLOTS];
+static uint32_t ulUseClock = 0;
+static uint32_t ulRenders = 0;
+static uint32_t ulHits = 0;
+
+/* Field-wise compare so struct padding never causes a miss */
+static bool bTriggerEqual(const TriggerConfig_t* pxA, const TriggerConfig_t* pxB) {
+    return pxA->eMode == pxB->eMode &&
+           pxA->eEdge == pxB->eEdge &&
+           pxA->uLevelCounts == pxB->uLevelCounts &&
+           pxA->uHysteresis == pxB->uHysteresis &&
+           pxA->fTimePerDivMs == pxB->fTimePerDivMs &&
+           pxA->fPretriggerFrac == pxB->fPretriggerFrac &&
+           pxA->eSmoothing == pxB->eSmoothing;
+}
+
+/* Displayed time/div for a window of ulLen samples (config value if Fs unknown) */
+static float fWindowTimePerDivMs(uint32_t ulLen, uint32_t ulFs_hz, float fFallbackMs) {
+    if (ulFs_hz == 0) return fFallbackMs;
+    return (float) ulLen * 1000.0f / ((float) ulFs_hz * 10.0f);
+}
+
+const ScopeRender_t* pxScopeViewRender(const ScopeBuffer_t* pxBuffer, uint32_t ulFs_hz,
+                                       const ScopeViewConfig_t* pxView) {
+    if (!pxBuffer || !pxBuffer->pusSamples || !pxView) return NULL;
+    const TriggerConfig_t* pxTrigger = &pxView->xTrigger;
+    uint16_t usPoints = pxView->usPoints;
+    float fZoomWidth = pxView->fZoomWidth;
+    float fZoomCenter = pxView->fZoomCenter;
+    if (usPoints < VIEW_MIN_POINTS) usPoints = VIEW_MIN_POINTS;
+    if (usPoints > VIEW_MAX_POINTS) usPoints = VIEW_MAX_POINTS;
+
+    ulUseClock++;
+
+    /* Hit: same capture, same view */
+    ViewCacheSlot_t* pxVictim = &xCache[0];
+    for (uint32_t i = 0; i < VIEW_CACHE_SLOTS; i++) {
+        ViewCacheSlot_t* pxSlot = &xCache[i];
+        if (pxSlot->bValid &&
+            pxSlot->xRender.ulBufferSeq == pxBuffer->ulSequence &&
+            pxSlot->xRender.ulFs_hz == ulFs_hz &&
+            pxSlot->xRender.usPoints == usPoints &&
+            pxSlot->xRender.fZoomWidth == fZoomWidth &&
+            (fZoomWidth == 0.0f || pxSlot->xRender.fZoomCenter == fZoomCenter) &&
+            bTriggerEqual(&pxSlot->xRender.xTrigger, pxTrigger)) {
+            pxSlot->ulLastUse = ulUseClock;
+            ulHits++;
+            return &pxSlot->xRender;
+        }
+        /* Prefer empty slots, then renders of older captures, then LRU */
+        if (!pxSlot->bValid) {
+            if (pxVictim->bValid) pxVictim = pxSlot;
+        } else if (pxVictim->bValid) {
+            bool bStale = pxSlot->xRender.ulBufferSeq != pxBuffer->ulSequence;
+            bool bVictimStale = pxVictim->xRender.ulBufferSeq != pxBuffer->ulSequence;
+            if ((bStale && !bVictimStale) ||
+                (bStale == bVictimStale && pxSlot->ulLastUse < pxVictim->ulLastUse)) {
+                pxVictim = pxSlot;
+            }
+        }
+    }
+
+    /* Miss: one trigger search, then render each window into the victim slot */
+    ScopeRender_t* pxRender = &pxVictim->xRender;
+    pxRender->ulBufferSeq = pxBuffer->ulSequence;
+    pxRender->ulFs_hz = ulFs_hz;
+    pxRender->xTrigger = *pxTrigger;
+    pxRender->usPoints = usPoints;
+    pxRender->fZoomWidth = fZoomWidth;
+    pxRender->fZoomCenter = fZoomCenter;
+
+    TriggerResult_t xLoc;
+    bool bLocated = bTriggerLocate(pxBuffer->pusSamples, ADC_BUFFER_SIZE, ulFs_hz, pxTrigger, usPoints, &xLoc);
+
+    ScopeRenderStream_t* pxMain = &pxRender->xStream[VIEW_STREAM_MAIN];
+    pxMain->bValid = bLocated &&
+                     bTriggerRenderWindow(pxBuffer->pusSamples, ADC_BUFFER_SIZE, &xLoc, 0.0f, 1.0f,
+                                          pxMain->usSamples, usPoints, &pxMain->xResult);
+    pxMain->fTimePerDivMs = fWindowTimePerDivMs(pxMain->xResult.uLen, ulFs_hz, pxTrigger->fTimePerDivMs);
+
+    ScopeRenderStream_t* pxZoom = &pxRender->xStream[VIEW_STREAM_ZOOM];
+    pxZoom->bValid = false;
+    if (bLocated && fZoomWidth > 0.0f) {
+        pxZoom->bValid = bTriggerRenderWindow(pxBuffer->pusSamples, ADC_BUFFER_SIZE, &xLoc,
+                                              fZoomCenter - fZoomWidth * 0.5f, fZoomWidth,
+                                              pxZoom->usSamples, usPoints, &pxZoom->xResult);
+        pxZoom->fTimePerDivMs = fWindowTimePerDivMs(pxZoom->xResult.uLen, ulFs_hz,
+                                                    pxTrigger->fTimePerDivMs * fZoomWidth);
+    }
+
+    pxVictim->ulLastUse = ulUseClock;
+    pxVictim->bValid = true;
+    ulRenders++;
+    return pxRender;
+}
+
+void vScopeViewGetStats(uint32_t* pulRenders, uint32_t* pulHits) {
+    if (pulRenders) *pulRenders = ulRenders;
+    if (pulHits) *pulHits = ulHits;
+}
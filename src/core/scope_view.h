@@ -0,0 +1,57 @@
+#ifndef SCOPE_VIEW_H
+#define SCOPE_VIEW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scope_data.h"
+#include "trigger.h"
+#include "command_handler.h"
+
+/*
+ * Per-view rendering with memoization
+ *
+ * Every viewer renders from the same published capture. A render is keyed by
+ * (capture sequence, sample rate, trigger config, point count, zoom window);
+ * viewers that share a configuration get the cached result, so trigger search
+ * and decimation run once per distinct view rather than once per client.
+ *
+ * A render holds up to two streams from one trigger search: the full span and,
+ * if the view has a zoom window, the zoomed sub-window of the same capture.
+ *
+ * Single consumer (the streaming task); not thread safe.
+ */
+
+#define VIEW_CACHE_SLOTS 4
+
+/* Streams of one render (values match FrameView_e on the wire) */
+#define VIEW_STREAM_MAIN 0
+#define VIEW_STREAM_ZOOM 1
+#define VIEW_STREAMS     2
+
+typedef struct {
+    bool            bValid;
+    float           fTimePerDivMs;     /* Effective time/div of this window (10 divisions) */
+    TriggerResult_t xResult;           /* Window and trigger position in its own points */
+    uint16_t        usSamples[VIEW_MAX_POINTS];
+} ScopeRenderStream_t;
+
+typedef struct {
+    uint32_t            ulBufferSeq;   /* ScopeBuffer_t.ulSequence rendered from */
+    uint32_t            ulFs_hz;
+    TriggerConfig_t     xTrigger;
+    uint16_t            usPoints;
+    float               fZoomWidth;
+    float               fZoomCenter;
+    ScopeRenderStream_t xStream[VIEW_STREAMS];
+} ScopeRender_t;
+
+/* Render (or fetch the cached render of) one view of a capture.
+ * Returns NULL if the capture has no samples.
+ */
+const ScopeRender_t* pxScopeViewRender(const ScopeBuffer_t* pxBuffer, uint32_t ulFs_hz,
+                                       const ScopeViewConfig_t* pxView);
+
+/* Cache counters since boot */
+void vScopeViewGetStats(uint32_t* pulRenders, uint32_t* pulHits);
+
+#endif /* SCOPE_VIEW_H */
@@ -0,0 +1,33 @@
+#include "trace.h"
+
+static const char *const pcNames[TRACE_ID_COUNT] = {
+    [TRACE_SYNC_ANCHOR] = "sync",
+    [TRACE_DMA_IRQ]     = "dma_irq",
+    [TRACE_PUBLISH]     = "publish",
+    [TRACE_STATS]       = "stats",
+    [TRACE_TRIGGER]     = "trigger",
+    [TRACE_DECIMATE]    = "decimate",
+    [TRACE_ENCODE]      = "encode",
+    [TRACE_MG_POLL]     = "mg_poll",
+    [TRACE_WS_SEND]     = "ws_send",
+};
+
+const char *pcTraceName(TraceId_e eId) {
+    return (unsigned) eId < TRACE_ID_COUNT ? pcNames[eId] : "?";
+}
+
+#if PICOSCOPE_TRACE
+
+_Static_assert((TRACE_RING_EVENTS & (TRACE_RING_EVENTS - 1u)) == 0, "ring index is masked");
+
+TraceEvent_t xTraceRing[TRACE_CORES][TRACE_RING_EVENTS];
+uint32_t ulTraceHead[TRACE_CORES];
+volatile bool bTracePaused = false;
+TraceEvent_t xTraceLastAnchor[TRACE_CORES];
+
+void vTraceInitCore(void) {
+    vMetricsCyclesEnable();
+    TRACE_SYNC();
+}
+
+#endif /* PICOSCOPE_TRACE */
@@ -0,0 +1,114 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Hot-path tracing (build with -DPICOSCOPE_TRACE=ON)
+ *
+ *   TRACE_BEGIN(TRACE_ENCODE);
+ *   ...
+ *   TRACE_END(TRACE_ENCODE);
+ *
+ * TRACE_BEGIN reads the DWT cycle counter into a local, TRACE_END writes one
+ * span (start cycle, length in cycles, id) into the ring of the core it runs
+ * on. Each core has its own ring; a slot is claimed with one atomic add, so
+ * tasks and interrupts on the same core never share a slot and nothing
+ * blocks. The oldest spans are overwritten. Begin and end must be in the same
+ * block, spans of the same id must not nest. A span whose task moved to the
+ * other core in between is dropped (its cycle count would be meaningless);
+ * tasks that trace are pinned, so this only guards against mistakes.
+ *
+ * The cycle counters of the two cores are not related, so the tasks on each
+ * core call TRACE_SYNC() now and then to record a (cycles, microseconds)
+ * anchor; the export converts every span with the nearest anchor before it
+ * (or the first one after it, for the oldest spans of a ring).
+ *
+ * The trace is downloaded as Chrome trace_event JSON from GET /trace.json
+ * (net/trace_endpoint.h); open it in chrome://tracing or ui.perfetto.dev.
+ *
+ * Without PICOSCOPE_TRACE every macro expands to nothing.
+ */
+
+#ifndef PICOSCOPE_TRACE
+#define PICOSCOPE_TRACE 0
+#endif
+
+typedef enum {
+    TRACE_SYNC_ANCHOR = 0,       // Not a span: ulCycles holds time_us_32()
+    TRACE_DMA_IRQ,               // drivers/adc_dma.c vDmaHandler
+    TRACE_PUBLISH,               // Acquisition task: vScopeDataPublishBuffer
+    TRACE_STATS,                 // scope_data: min/max/average of a capture
+    TRACE_TRIGGER,               // trigger: search of one view
+    TRACE_DECIMATE,              // trigger: resampling of one view
+    TRACE_ENCODE,                // DSP: one frame
+    TRACE_MG_POLL,               // Network task: mg_mgr_poll (includes waiting in select)
+    TRACE_WS_SEND,               // Network task: one WebSocket message to a socket
+    TRACE_ID_COUNT
+} TraceId_e;
+
+#define TRACE_CORES             2u
+#define TRACE_RING_EVENTS       512u        /* Per core, power of two */
+
+typedef struct {
+    uint32_t ulStart;            // DWT cycle counter at TRACE_BEGIN
+    uint32_t ulCycles;           // Span length (anchor: microseconds)
+    uint32_t ulId;               // TraceId_e
+} TraceEvent_t;
+
+const char *pcTraceName(TraceId_e eId);
+
+#if PICOSCOPE_TRACE
+
+#include "metrics.h"
+#include "pico/stdlib.h"
+
+extern TraceEvent_t xTraceRing[TRACE_CORES][TRACE_RING_EVENTS];
+extern uint32_t ulTraceHead[TRACE_CORES];
+extern volatile bool bTracePaused;
+extern TraceEvent_t xTraceLastAnchor[TRACE_CORES];
+
+static inline void vTraceRecord(uint32_t ulCore, TraceId_e eId, uint32_t ulStart, uint32_t ulCycles) {
+    if (bTracePaused) return;
+    uint32_t ulSlot = __atomic_fetch_add(&ulTraceHead[ulCore], 1u, __ATOMIC_RELAXED) & (TRACE_RING_EVENTS - 1u);
+    TraceEvent_t *pxEvent = &xTraceRing[ulCore][ulSlot];
+    pxEvent->ulStart = ulStart;
+    pxEvent->ulCycles = ulCycles;
+    pxEvent->ulId = (uint32_t) eId;
+}
+
+/* End of a span begun on ulCore: dropped if the task migrated meanwhile */
+static inline void vTraceEnd(TraceId_e eId, uint32_t ulCore, uint32_t ulStart) {
+    uint32_t ulEnd = ulMetricsCycles();
+    if (get_core_num() == ulCore) vTraceRecord(ulCore, eId, ulStart, ulEnd - ulStart);
+}
+
+/* Anchor: also kept outside the ring for spans whose anchor was overwritten */
+static inline void vTraceSync(void) {
+    uint32_t ulCore = get_core_num();
+    uint32_t ulCycles = ulMetricsCycles();
+    uint32_t ulUs = time_us_32();
+    if (get_core_num() != ulCore) return;
+    xTraceLastAnchor[ulCore] = (TraceEvent_t) { ulCycles, ulUs, TRACE_SYNC_ANCHOR };
+    vTraceRecord(ulCore, TRACE_SYNC_ANCHOR, ulCycles, ulUs);
+}
+
+/* Start the cycle counter of the calling core and record its first anchor */
+void vTraceInitCore(void);
+
+#define TRACE_BEGIN(id)     const uint32_t ulTraceCore_##id = get_core_num(), ulTraceStart_##id = ulMetricsCycles()
+#define TRACE_END(id)       vTraceEnd((id), ulTraceCore_##id, ulTraceStart_##id)
+#define TRACE_SYNC()        vTraceSync()
+#define TRACE_INIT_CORE()   vTraceInitCore()
+
+#else
+
+#define TRACE_BEGIN(id)     do { } while (0)
+#define TRACE_END(id)       do { } while (0)
+#define TRACE_SYNC()        do { } while (0)
+#define TRACE_INIT_CORE()   do { } while (0)
+
+#endif /* PICOSCOPE_TRACE */
+
+#endif /* TRACE_H */
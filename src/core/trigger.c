@@ -1,11 +1,10 @@
 #include "trigger.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
 
-#include "pico/stdlib.h"
-
 /* Sub-sample linear interpolation helper 
  * returns a*(1-f)+b*f
  * static, returns uint16_t -> us prefix
@@ -24,7 +23,7 @@ static inline uint16_t usReadLerpQ16(const uint16_t* pusSrc, uint32_t ulN, uint3
 }
 
 /* Decimate by resampling with fractional start/step (no averaging) */
-static void vDecimateResampleLinear(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulStart_q16, uint32_t ulSpan, uint16_t* pusDst, uint32_t ulDstLen) {
+void vTriggerDecimateLinearGeneric(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulStart_q16, uint32_t ulSpan, uint16_t* pusDst, uint32_t ulDstLen) {
     if (!pusSrc || !pusDst || !ulSpan || !ulDstLen) return;
     uint32_t ulStep_q16 = (uint32_t)(((uint64_t)ulSpan << 16) / ulDstLen);
     uint32_t ulS = ulStart_q16 + (ulStep_q16 >> 1);
@@ -33,10 +32,97 @@ static void vDecimateResampleLinear(const uint16_t* pusSrc, uint32_t ulSrcLen, u
     }
 }
 
+/* Integer-ratio kernels
+ * When ulSpan is an exact multiple of ulDstLen the Q16 step has no fractional
+ * part, so every output point sits at the same sub-sample phase: the source
+ * index advances by a constant stride and the lerp weights never change.
+ * DECIMATE_KERNEL(step) emits a variant for any width, DECIMATE_KERNEL_W(step, width)
+ * one with a constant trip count the compiler can unroll (256 = default DISPLAY_POINTS).
+ */
+typedef void (*DecimateKernel_t)(const uint16_t* pusSrc, uint32_t ulFrac_q16, uint16_t* pusDst, uint32_t ulDstLen);
+
+#define DECIMATE_KERNEL_BODY(STEP, LEN)                                                         \
+    if (ulFrac_q16 == 0) {                                                                      \
+        for (uint32_t uxI = 0; uxI < (LEN); uxI++) pusDst[uxI] = pusSrc[uxI * (STEP)];          \
+        return;                                                                                 \
+    }                                                                                           \
+    uint32_t ulFa = (1u << 16) - ulFrac_q16;                                                    \
+    for (uint32_t uxI = 0; uxI < (LEN); uxI++) {                                                \
+        const uint16_t* pusS = &pusSrc[uxI * (STEP)];                                           \
+        pusDst[uxI] = (uint16_t)(((uint32_t)pusS[0] * ulFa + (uint32_t)pusS[1] * ulFrac_q16 + 32768u) >> 16); \
+    }
+
+#define DECIMATE_KERNEL(STEP)                                                                   \
+    static void vDecimateStep##STEP(const uint16_t* pusSrc, uint32_t ulFrac_q16, uint16_t* pusDst, uint32_t ulDstLen) { \
+        DECIMATE_KERNEL_BODY(STEP, ulDstLen)                                                    \
+    }
+
+#define DECIMATE_KERNEL_W(STEP, WIDTH)                                                          \
+    static void vDecimateStep##STEP##W##WIDTH(const uint16_t* pusSrc, uint32_t ulFrac_q16, uint16_t* pusDst, uint32_t ulDstLen) { \
+        (void) ulDstLen;                                                                        \
+        DECIMATE_KERNEL_BODY(STEP, WIDTH)                                                       \
+    }
+
+DECIMATE_KERNEL(1)
+DECIMATE_KERNEL(2)
+DECIMATE_KERNEL(3)
+DECIMATE_KERNEL(4)
+DECIMATE_KERNEL(8)
+DECIMATE_KERNEL_W(1, 256)
+DECIMATE_KERNEL_W(2, 256)
+DECIMATE_KERNEL_W(3, 256)
+DECIMATE_KERNEL_W(4, 256)
+DECIMATE_KERNEL_W(8, 256)
+
+/* Dispatch table: first match on (step, width) wins, width 0 matches any */
+static const struct {
+    uint32_t         ulStep;
+    uint32_t         ulDstLen;
+    DecimateKernel_t pxKernel;
+} xDecimateKernels[] = {
+    { 3, 256, vDecimateStep3W256 },
+    { 4, 256, vDecimateStep4W256 },
+    { 2, 256, vDecimateStep2W256 },
+    { 1, 256, vDecimateStep1W256 },
+    { 8, 256, vDecimateStep8W256 },
+    { 1, 0,   vDecimateStep1 },
+    { 2, 0,   vDecimateStep2 },
+    { 3, 0,   vDecimateStep3 },
+    { 4, 0,   vDecimateStep4 },
+    { 8, 0,   vDecimateStep8 },
+};
+
+/* Same output as vTriggerDecimateLinearGeneric, via a specialised kernel when
+ * the ratio is integral and the whole read stays inside the source buffer.
+ */
+void vTriggerDecimateLinear(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulStart_q16, uint32_t ulSpan, uint16_t* pusDst, uint32_t ulDstLen) {
+    if (!pusSrc || !pusDst || !ulSpan || !ulDstLen) return;
+
+    if (ulSpan % ulDstLen == 0) {
+        uint32_t ulStep = ulSpan / ulDstLen;
+        uint32_t ulS = ulStart_q16 + ((ulStep << 16) >> 1);
+        uint32_t ulIndex = ulS >> 16;
+        uint32_t ulFrac = ulS & 0xFFFFu;
+        /* Last source sample touched; the generic path clamps past this point */
+        uint64_t ullLast = (uint64_t)ulIndex + (uint64_t)(ulDstLen - 1u) * ulStep + (ulFrac ? 1u : 0u);
+
+        if (ullLast < ulSrcLen) {
+            for (uint32_t uxK = 0; uxK < sizeof(xDecimateKernels) / sizeof(xDecimateKernels[0]); uxK++) {
+                if (xDecimateKernels[uxK].ulStep != ulStep) continue;
+                if (xDecimateKernels[uxK].ulDstLen != 0 && xDecimateKernels[uxK].ulDstLen != ulDstLen) continue;
+                xDecimateKernels[uxK].pxKernel(&pusSrc[ulIndex], ulFrac, pusDst, ulDstLen);
+                return;
+            }
+        }
+    }
+
+    vTriggerDecimateLinearGeneric(pusSrc, ulSrcLen, ulStart_q16, ulSpan, pusDst, ulDstLen);
+}
+
 /* Trigger search constrained to a safe range
  * returns index (int) -> l prefix for local signed result
  */
-static int lFindTrigger(const uint16_t* pusS, uint32_t ulBegin, uint32_t ulEnd, uint16_t usLevel, TriggerEdge_e eEdge, uint16_t usHyst, float* pfCross) {
+int lTriggerFindEdge(const uint16_t* pusS, uint32_t ulBegin, uint32_t ulEnd, uint16_t usLevel, TriggerEdge_e eEdge, uint16_t usHyst, float* pfCross) {
     if (!pusS || ulEnd <= ulBegin + 1) return -1;
     uint16_t usLo = (usLevel > usHyst) ? (uint16_t)(usLevel - usHyst) : 0;
     uint16_t usHi = (uint16_t)((usLevel + usHyst <= 4095) ? (usLevel + usHyst) : 4095);
@@ -66,17 +152,18 @@ void vTriggerInitDefault(TriggerConfig_t* pxCfg) {
     pxCfg->eSmoothing     = SMOOTH_MINMAX;
 }
 
-/* Build an output frame:
- * 1) Determine span (how many input samples map to DISPLAY_POINTS)
+/* Locate the display window:
+ * 1) Determine span (how many input samples map to DISPLAY_POINTS, narrowed to time/div)
  * 2) Search for trigger (respecting pre-trigger fraction and staying within valid window)
- * 3) Compute fractional start (Q16) such that pretrigger fraction is honored
- * 4) Resample using decimate_resample_linear to produce dst_len points
+ * 3) Compute fractional start such that pretrigger fraction is honored
  */
-bool bTriggerBuildFrame(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulFs_hz, const TriggerConfig_t* pxCfg, uint16_t* pusDst, uint32_t ulDstLen, TriggerResult_t* pxOut) {
-    if (!pusSrc || !ulSrcLen || !pxCfg || !pusDst || !ulDstLen) return false;
+bool bTriggerLocate(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulFs_hz, const TriggerConfig_t* pxCfg, uint32_t ulDstLen, TriggerResult_t* pxOut) {
+    if (!pusSrc || !ulSrcLen || !pxCfg || !ulDstLen || !pxOut) return false;
 
     TriggerResult_t xRes = {0};
     xRes.iTriggerIndex = -1;
+    xRes.iTriggerPoint = -1;
+    xRes.fTriggerPos = -1.0f;
 
     uint32_t ulMax_step = (ulDstLen ? (ulSrcLen / ulDstLen) : 0);
     if (ulMax_step == 0) ulMax_step = 1;
@@ -85,6 +172,14 @@ bool bTriggerBuildFrame(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulFs
     uint32_t ulSpan = ulStep * ulDstLen;
     if (ulSpan == 0 || ulSpan > ulSrcLen) ulSpan = (ulSrcLen < ulDstLen ? ulSrcLen : ulDstLen);
 
+    /* Honour the view's time/div when its span fits inside the default one
+     * (which keeps the trigger search slack); longer spans show what we have.
+     */
+    if (ulFs_hz > 0 && pxCfg->fTimePerDivMs > 0.0f) {
+        float fWant = pxCfg->fTimePerDivMs * 10.0f * (float) ulFs_hz / 1000.0f;
+        if (fWant >= 2.0f && fWant < (float) ulSpan) ulSpan = (uint32_t)(fWant + 0.5f);
+    }
+
     float fPre_frac = pxCfg->fPretriggerFrac;
     if (fPre_frac < 0.0f) fPre_frac = 0.0f;
     if (fPre_frac > 0.9f) fPre_frac = 0.9f;
@@ -99,10 +194,13 @@ bool bTriggerBuildFrame(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulFs
 
     float fT_fine = -1.0f;
     if (pxCfg->eMode != TRIG_MODE_NONE && ulT_begin < ulT_end) {
-        int lT = lFindTrigger(pusSrc, ulT_begin, ulT_end, pxCfg->uLevelCounts, pxCfg->eEdge, pxCfg->uHysteresis, &fT_fine);
+        TRACE_BEGIN(TRACE_TRIGGER);
+        int lT = lTriggerFindEdge(pusSrc, ulT_begin, ulT_end, pxCfg->uLevelCounts, pxCfg->eEdge, pxCfg->uHysteresis, &fT_fine);
+        TRACE_END(TRACE_TRIGGER);
         if (lT >= 0) {
             xRes.iTriggerIndex = lT;
             xRes.bTriggered = true;
+            xRes.fTriggerPos = fT_fine;
         }
     }
 
@@ -116,14 +214,74 @@ bool bTriggerBuildFrame(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulFs
         fStart_f = 0.0f;
     }
 
-    uint32_t ulStart_q16 = (uint32_t) llroundf(fStart_f * 65536.0f);
-
+    xRes.fStart = fStart_f;
     xRes.uStart = (uint32_t) (fStart_f + 0.5f);
     xRes.uLen   = ulSpan;
     xRes.uOutCount = ulDstLen;
+    if (xRes.bTriggered) {
+        float fPoint = (fT_fine - fStart_f) * (float) ulDstLen / (float) ulSpan;
+        if (fPoint >= 0.0f && fPoint < (float) ulDstLen) xRes.iTriggerPoint = (int)(fPoint + 0.5f);
+    }
+
+    *pxOut = xRes;
+    return true;
+}
 
-    vDecimateResampleLinear(pusSrc, ulSrcLen, ulStart_q16, ulSpan, pusDst, ulDstLen);
+/* Render a sub-window of a located span:
+ * the window starts fWinStartFrac into pxLoc's span and covers fWinWidthFrac of
+ * it (0,1 = the located span itself). The trigger search is not repeated; the
+ * start is re-parameterized from pxLoc->fStart and resampled with
+ * vTriggerDecimateLinear.
+ */
+bool bTriggerRenderWindow(const uint16_t* pusSrc, uint32_t ulSrcLen, const TriggerResult_t* pxLoc, float fWinStartFrac, float fWinWidthFrac, uint16_t* pusDst, uint32_t ulDstLen, TriggerResult_t* pxOut) {
+    if (!pusSrc || !ulSrcLen || !pxLoc || !pusDst || !ulDstLen || !pxLoc->uLen) return false;
+
+    if (fWinWidthFrac <= 0.0f || fWinWidthFrac > 1.0f) fWinWidthFrac = 1.0f;
+    if (fWinStartFrac < 0.0f) fWinStartFrac = 0.0f;
+    if (fWinStartFrac > 1.0f - fWinWidthFrac) fWinStartFrac = 1.0f - fWinWidthFrac;
+
+    uint32_t ulSpan = (uint32_t)((float) pxLoc->uLen * fWinWidthFrac + 0.5f);
+    if (ulSpan < 2u) ulSpan = 2u;
+    if (ulSpan > ulSrcLen) ulSpan = ulSrcLen;
+
+    float fStart_f = pxLoc->fStart + fWinStartFrac * (float) pxLoc->uLen;
+    float fMax_start_f = (float)(ulSrcLen - ulSpan);
+    if (fStart_f > fMax_start_f) fStart_f = fMax_start_f;
+    if (fStart_f < 0.0f) fStart_f = 0.0f;
+
+    uint32_t ulStart_q16 = (uint32_t) llroundf(fStart_f * 65536.0f);
+    TRACE_BEGIN(TRACE_DECIMATE);
+    vTriggerDecimateLinear(pusSrc, ulSrcLen, ulStart_q16, ulSpan, pusDst, ulDstLen);
+    TRACE_END(TRACE_DECIMATE);
+
+    if (pxOut) {
+        TriggerResult_t xRes = *pxLoc;
+        xRes.fStart = fStart_f;
+        xRes.uStart = (uint32_t) (fStart_f + 0.5f);
+        xRes.uLen = ulSpan;
+        xRes.uOutCount = ulDstLen;
+        xRes.iTriggerPoint = -1;
+        if (xRes.bTriggered) {
+            float fPoint = (xRes.fTriggerPos - fStart_f) * (float) ulDstLen / (float) ulSpan;
+            if (fPoint >= 0.0f && fPoint < (float) ulDstLen) xRes.iTriggerPoint = (int)(fPoint + 0.5f);
+        }
+        *pxOut = xRes;
+    }
+    return true;
+}
+
+/* Build an output frame: locate the window, then resample the whole span */
+bool bTriggerBuildFrame(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulFs_hz, const TriggerConfig_t* pxCfg, uint16_t* pusDst, uint32_t ulDstLen, TriggerResult_t* pxOut) {
+    if (!pusSrc || !ulSrcLen || !pxCfg || !pusDst || !ulDstLen) return false;
+
+    TriggerResult_t xRes;
+    if (!bTriggerLocate(pusSrc, ulSrcLen, ulFs_hz, pxCfg, ulDstLen, &xRes)) return false;
+
+    uint32_t ulStart_q16 = (uint32_t) llroundf(xRes.fStart * 65536.0f);
+    TRACE_BEGIN(TRACE_DECIMATE);
+    vTriggerDecimateLinear(pusSrc, ulSrcLen, ulStart_q16, xRes.uLen, pusDst, ulDstLen);
+    TRACE_END(TRACE_DECIMATE);
 
     if (pxOut) *pxOut = xRes;
     return true;
-}
\ No newline at end of file
+}
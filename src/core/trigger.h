@@ -60,6 +60,11 @@ typedef struct {
     uint32_t       uLen;
     // Output count actually written to dst (normally DISPLAY_POINTS)
     uint32_t       uOutCount;
+    // Trigger position in output points (-1 if not triggered or outside)
+    int            iTriggerPoint;
+    // Fractional window start and trigger crossing in input samples (-1 if none)
+    float          fStart;
+    float          fTriggerPos;
     // True if an edge was found and used
     bool           bTriggered;
 } TriggerResult_t;
@@ -79,4 +84,39 @@ void vTriggerInitDefault(TriggerConfig_t* pxCfg);
  */
 bool bTriggerBuildFrame(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulFs_hz,
                         const TriggerConfig_t* pxCfg, uint16_t* pusDst, uint32_t ulDstLen,
-                        TriggerResult_t* pxOut);
\ No newline at end of file
+                        TriggerResult_t* pxOut);
+
+/* The two halves of bTriggerBuildFrame, for rendering several windows from
+ * one trigger search (e.g. overview + zoom).
+ * - bTriggerLocate fills pxOut with the span, fractional start and trigger
+ *   position for ulDstLen output points, without resampling.
+ * - bTriggerRenderWindow resamples the sub-window starting fWinStartFrac into
+ *   the located span and covering fWinWidthFrac of it (0, 1 = whole span);
+ *   pxOut (optional) describes that window.
+ */
+bool bTriggerLocate(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulFs_hz,
+                    const TriggerConfig_t* pxCfg, uint32_t ulDstLen, TriggerResult_t* pxOut);
+
+bool bTriggerRenderWindow(const uint16_t* pusSrc, uint32_t ulSrcLen, const TriggerResult_t* pxLoc,
+                          float fWinStartFrac, float fWinWidthFrac, uint16_t* pusDst, uint32_t ulDstLen,
+                          TriggerResult_t* pxOut);
+
+/* Linear resampler used by bTriggerBuildFrame.
+ * Maps ulSpan input samples starting at ulStart_q16 (Q16 fractional index) onto
+ * ulDstLen output points. Integer ratios (ulSpan % ulDstLen == 0) go through
+ * specialised kernels; everything else uses the generic Q16 lerp.
+ */
+void vTriggerDecimateLinear(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulStart_q16, uint32_t ulSpan,
+                            uint16_t* pusDst, uint32_t ulDstLen);
+
+/* Reference resampler (no kernel dispatch), kept for benchmarking and fallback */
+void vTriggerDecimateLinearGeneric(const uint16_t* pusSrc, uint32_t ulSrcLen, uint32_t ulStart_q16, uint32_t ulSpan,
+                                   uint16_t* pusDst, uint32_t ulDstLen);
+
+/* Edge search used by bTriggerLocate, exposed for benchmarking.
+ * Scans [ulBegin + 1, ulEnd) for the first crossing through the hysteresis
+ * band around usLevel; returns the sample index after the crossing (-1 if
+ * none) and the interpolated crossing position in *pfCross (optional).
+ */
+int lTriggerFindEdge(const uint16_t* pusS, uint32_t ulBegin, uint32_t ulEnd, uint16_t usLevel, TriggerEdge_e eEdge,
+                     uint16_t usHyst, float* pfCross);
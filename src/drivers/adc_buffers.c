@@ -0,0 +1,210 @@
+#include "adc_buffers.h"
+#include "adc_dma.h"
+#include "pico/stdlib.h"
+#include <string.h>
+
+static AdcTransferStart_t pxStart = NULL;
+static volatile bool bCaptureRunning = false;
+
+/* Buffer Management
+ * xState is only changed with compare-and-swap (see adc_dma.h), so the ISR and
+ * tasks on either core agree on ownership without a critical section.
+ */
+static AdcBuffer_t xBuffers[NUM_BUFFERS];
+static volatile uint8_t ucWriteIndex = 0;
+
+/* Last completed buffer, candidate for the next handout */
+static volatile uint8_t ucLastCompleted = 0;
+static volatile uint32_t ulStaleReleases = 0;
+static bool bDmaStalled = false;
+
+static volatile uint32_t ulMeasuredSampleRateHz = 0;
+static uint32_t uLastDmaUs = 0;
+
+static inline bool bBufferCas(uint8_t ucIndex, BufferState_t xFrom, BufferState_t xTo) {
+    uint32_t ulExpected = (uint32_t) xFrom;
+    return __atomic_compare_exchange_n(&xBuffers[ucIndex].xState, &ulExpected, (uint32_t) xTo,
+                                       false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+/* Claim the buffer DMA fills next, starting after ucAfter.
+ * Prefers an EMPTY buffer, then overwrites the oldest FULL one; ucAfter itself
+ * is the last resort. A task may hand out or release buffers meanwhile, and a
+ * release always precedes the next handout, so the scan runs twice before
+ * giving up.
+ */
+static int iClaimNextBuffer(uint8_t ucAfter) {
+    for (int iPass = 0; iPass < 2; iPass++) {
+        for (uint8_t i = 1; i <= NUM_BUFFERS; i++) {
+            uint8_t cand = (uint8_t) ((ucAfter + i) % NUM_BUFFERS);
+            if (bBufferCas(cand, BUFFER_EMPTY, BUFFER_FILLING)) return cand;
+        }
+        for (uint8_t i = 1; i < NUM_BUFFERS; i++) {
+            uint8_t cand = (uint8_t) ((ucAfter + i) % NUM_BUFFERS);
+            if (bBufferCas(cand, BUFFER_FULL, BUFFER_FILLING)) {
+                xBuffers[cand].xStats.ulOverwritten++;
+                return cand;
+            }
+        }
+        if (bBufferCas(ucAfter, BUFFER_FULL, BUFFER_FILLING)) {
+            xBuffers[ucAfter].xStats.ulOverruns++;
+            return ucAfter;
+        }
+    }
+    return -1;
+}
+
+static void vStartTransfer(uint8_t ucIndex) {
+    ucWriteIndex = ucIndex;
+    pxStart(xBuffers[ucIndex].usData);
+}
+
+/* True if iClaimNextBuffer() could take a buffer right now */
+static bool bAnyBufferClaimable(void) {
+    for (uint8_t i = 0; i < NUM_BUFFERS; i++) {
+        uint32_t ulState = __atomic_load_n(&xBuffers[i].xState, __ATOMIC_SEQ_CST);
+        if (ulState == BUFFER_EMPTY || ulState == BUFFER_FULL) return true;
+    }
+    return false;
+}
+
+/* No buffer could be claimed: flag the stall for vAdcDmaReleaseBuffer().
+ * A release between the failed claim and the flag did not see it, so look
+ * again once the flag is visible; whoever takes the flag back restarts DMA.
+ */
+static void vStallTransfer(uint8_t ucAfter) {
+    while (bCaptureRunning) {
+        __atomic_store_n(&bDmaStalled, true, __ATOMIC_SEQ_CST);
+        if (!bAnyBufferClaimable()) return;         // Every later release sees the flag
+        if (!__atomic_exchange_n(&bDmaStalled, false, __ATOMIC_SEQ_CST)) return;   // A release took it
+        int iNext = iClaimNextBuffer(ucAfter);
+        if (iNext >= 0) {
+            vStartTransfer((uint8_t) iNext);
+            return;
+        }
+    }
+}
+
+void vAdcBuffersInit(AdcTransferStart_t pxStartTransfer) {
+    pxStart = pxStartTransfer;
+    memset(xBuffers, 0, sizeof(xBuffers));   /* All EMPTY, stats cleared */
+    ucWriteIndex = 0;
+    ucLastCompleted = 0;
+    ulStaleReleases = 0;
+    bDmaStalled = false;
+}
+
+void vAdcBuffersStart(void) {
+    int iFirst = iClaimNextBuffer(ucWriteIndex);
+    bCaptureRunning = true;
+    if (iFirst >= 0) {
+        vStartTransfer((uint8_t) iFirst);
+    } else {
+        vStallTransfer(ucWriteIndex);
+    }
+}
+
+void vAdcBuffersStop(void) {
+    bCaptureRunning = false;
+    __atomic_store_n(&bDmaStalled, false, __ATOMIC_RELEASE);
+
+    /* Drop captures not handed out; PROCESSING buffers stay with their holders */
+    for (uint8_t i = 0; i < NUM_BUFFERS; i++) {
+        bBufferCas(i, BUFFER_FILLING, BUFFER_EMPTY);
+        bBufferCas(i, BUFFER_FULL, BUFFER_EMPTY);
+    }
+}
+
+void vAdcBuffersCompleteTransfer(void) {
+    /* Transfer is complete which means buffer is full */
+    uint8_t completed = ucWriteIndex;
+    AdcBuffer_t *pxDone = &xBuffers[completed];
+    pxDone->ulTimestamp = to_ms_since_boot(get_absolute_time());
+    pxDone->xStats.ulFills++;
+    __atomic_store_n(&pxDone->xState, (uint32_t) BUFFER_FULL, __ATOMIC_RELEASE);
+    ucLastCompleted = completed; /* Remember which one completed */
+
+    /* Consumers pin published buffers in the scope ring for as long as they
+     * read them, so the next buffer in order may still be in use.
+     */
+    if (bCaptureRunning) {
+        int iNext = iClaimNextBuffer(completed);
+        if (iNext >= 0) {
+            vStartTransfer((uint8_t) iNext);
+        } else {
+            /* Every buffer handed out: vAdcDmaReleaseBuffer() restarts DMA */
+            vStallTransfer(completed);
+        }
+    }
+
+    uint32_t now_us = time_us_32();
+    if (uLastDmaUs != 0) {
+        uint32_t dt_us = now_us - uLastDmaUs;
+        if (dt_us) ulMeasuredSampleRateHz = (uint32_t) (((uint64_t) ADC_BUFFER_SIZE * 1000000u) / dt_us);
+    }
+    uLastDmaUs = now_us;
+}
+
+/* Zero-copy version: Returns pointer to DMA buffer (setting it to PROCESSING) */
+bool bAdcDmaGetLatestBufferPtr(uint16_t** pusBufferPtr, uint32_t* pulTimestamp, AdcBufferHandle_t* pxHandle) {
+    if (pusBufferPtr == NULL || pulTimestamp == NULL || pxHandle == NULL) return false;
+
+    /* The CAS fails if the ISR already started refilling it or it was handed out */
+    uint8_t latest = ucLastCompleted;
+    if (!bBufferCas(latest, BUFFER_FULL, BUFFER_PROCESSING)) return false;
+
+    /* Owned from here on: nobody else writes these fields until release */
+    AdcBuffer_t *pxBuf = &xBuffers[latest];
+    pxBuf->ulGeneration++;
+    if ((pxBuf->ulGeneration & 0x00FFFFFFu) == 0) pxBuf->ulGeneration++;   /* Handle never 0 */
+    pxBuf->xStats.ulHandouts++;
+
+    *pusBufferPtr = pxBuf->usData;
+    *pulTimestamp = pxBuf->ulTimestamp;
+    *pxHandle = (pxBuf->ulGeneration << 8) | latest;
+    return true;
+}
+
+/* Release a previously handed-out DMA buffer (setting it to EMPTY) */
+void vAdcDmaReleaseBuffer(AdcBufferHandle_t xHandle) {
+    uint8_t ucIndex = ADC_BUFFER_HANDLE_INDEX(xHandle);
+    if (xHandle == ADC_BUFFER_HANDLE_INVALID || ucIndex >= NUM_BUFFERS ||
+        (xBuffers[ucIndex].ulGeneration << 8) != (xHandle & ~0xFFu) ||
+        !bBufferCas(ucIndex, BUFFER_PROCESSING, BUFFER_EMPTY)) {
+        __atomic_fetch_add(&ulStaleReleases, 1u, __ATOMIC_RELAXED);   // Releases come from several tasks
+        return;
+    }
+
+    /* DMA ran out of buffers: this one is free now, restart the transfer */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);        // EMPTY visible before the flag is read (vStallTransfer)
+    if (bCaptureRunning && __atomic_exchange_n(&bDmaStalled, false, __ATOMIC_SEQ_CST)) {
+        int iNext = iClaimNextBuffer(ucIndex);
+        if (iNext >= 0) {
+            vStartTransfer((uint8_t) iNext);
+        } else {
+            vStallTransfer(ucIndex);
+        }
+    }
+}
+
+bool bAdcDmaGetBufferStats(uint8_t ucIndex, AdcBufferStats_t* pxStats) {
+    if (ucIndex >= NUM_BUFFERS || pxStats == NULL) return false;
+    *pxStats = xBuffers[ucIndex].xStats;
+    return true;
+}
+
+uint32_t ulAdcDmaGetOverruns(void) {
+    uint32_t ulTotal = 0;
+    for (int i = 0; i < NUM_BUFFERS; i++) ulTotal += xBuffers[i].xStats.ulOverruns;
+    return ulTotal;
+}
+
+uint32_t ulAdcDmaGetStaleReleases(void) {
+    return ulStaleReleases;
+}
+
+uint32_t ulAdcDmaGetMeasuredSampleRate(void) { return ulMeasuredSampleRateHz; }
+
+bool bAdcDmaIsRunning(void) {
+    return bCaptureRunning;
+}
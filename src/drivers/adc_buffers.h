@@ -0,0 +1,29 @@
+#ifndef ADC_BUFFERS_H
+#define ADC_BUFFERS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* ADC buffer state machine (adc_buffers.c)
+ * Hardware independent half of drivers/adc_dma.h: claiming, publishing,
+ * handout, release and the stall handshake. The platform (DMA driver or host
+ * simulation) only moves samples: it starts a transfer into the buffer it is
+ * given and calls vAdcBuffersCompleteTransfer() once the buffer is filled.
+ */
+
+/* Start filling pusData (ADC_BUFFER_SIZE samples); called from any context */
+typedef void (*AdcTransferStart_t)(uint16_t *pusData);
+
+/* All buffers EMPTY and stats cleared; capture must be stopped */
+void vAdcBuffersInit(AdcTransferStart_t pxStartTransfer);
+
+/* Claim a buffer and start the first transfer (stalls if all are handed out) */
+void vAdcBuffersStart(void);
+
+/* Stop claiming and drop captures not handed out; handed-out buffers stay valid */
+void vAdcBuffersStop(void);
+
+/* Current transfer done: publish it FULL and start the next one (DMA ISR) */
+void vAdcBuffersCompleteTransfer(void);
+
+#endif
@@ -1,79 +1,44 @@
 #include "adc_dma.h"
+#include "adc_buffers.h"
 #include "pico/stdlib.h"
-#include "stdio.h"
 #include "hardware/dma.h"
 #include "hardware/adc.h"
 #include "hardware/clocks.h"
+#include "core/trace.h"
+#include "core/log.h"
 #include "FreeRTOS.h"    
 #include "task.h"
-#include <string.h>
 
 /* DMA Globals */
 static int iDmaChannel;
 static dma_channel_config dmaConfig;
-static volatile bool bCaptureRunning = false;
-
-/* Buffer Management */
-static AdcBuffer_t xBuffers[NUM_BUFFERS];
-static volatile uint8_t ucWriteIndex = 0;
-static volatile uint32_t ulBufferTimestamp[NUM_BUFFERS];
-
-/* Track last completed buffer explicitly for safe handout */
-static volatile uint8_t ucLastCompleted = 0;
 
 /* Target sample rate (Hz). Default ~512 kSPS like before */
 static uint32_t ulTargetSampleRateHz = 10000;
-static volatile uint32_t ulMeasuredSampleRateHz = 0;
-static uint32_t uLastDmaUs = 0;
+
+/* Buffer hand-over lives in adc_buffers.c: point DMA at the buffer it claimed */
+static void vStartTransfer(uint16_t *pusData) {
+    dma_channel_configure(
+        iDmaChannel,
+        &dmaConfig,
+        pusData,
+        &adc_hw->fifo,
+        ADC_BUFFER_SIZE,
+        true
+    );
+}
 
 /* DMA Completion Handler 
  * Gets called with interupt when a DMA transfer completes.
- * Checks which buffer was filled and updates states accordingly.
+ * Publishes the filled buffer as FULL and claims the next one.
  */
 static void vDmaHandler() {
+    TRACE_BEGIN(TRACE_DMA_IRQ);
     if (dma_channel_get_irq0_status(iDmaChannel)) {
         dma_channel_acknowledge_irq0(iDmaChannel);
-        
-        /* Transfer is complete which means buffer is full */
-        uint8_t completed = ucWriteIndex;
-        xBuffers[completed].xState = BUFFER_FULL;
-        ulBufferTimestamp[completed] = to_ms_since_boot(get_absolute_time());
-        ucLastCompleted = completed; /* Remember which one completed */
-        
-        /* Get index to next buffer */
-        uint8_t next = (uint8_t) ((completed + 1) % NUM_BUFFERS);
-
-        /* Avoid overwriting a PROCESSING buffer.
-         * With 3 buffers, the ISR should rarely hit this case because
-         * one is FILLING, one is FULL, and one is PROCESSING.
-         * If it does happen, reuse the just-completed buffer (drop older frame).
-         */
-        if (xBuffers[next].xState == BUFFER_PROCESSING) {
-            next = completed;     /* Reuse current buffer */
-            ulOverruns++;         /* Count the drop */
-        }
-        
-        /* Update buffer state and start transfer with next buffer info */
-        if (bCaptureRunning) {
-            ucWriteIndex = next;
-            xBuffers[ucWriteIndex].xState = BUFFER_FILLING;
-            dma_channel_configure(
-                iDmaChannel,
-                &dmaConfig,
-                xBuffers[ucWriteIndex].usData,
-                &adc_hw->fifo,
-                ADC_BUFFER_SIZE,
-                true
-            );
-        }
-        
-        uint32_t now_us = time_us_32();
-        if (uLastDmaUs != 0) {
-            uint32_t dt_us = now_us - uLastDmaUs;
-            if (dt_us) ulMeasuredSampleRateHz = (ADC_BUFFER_SIZE * 1000000u) / dt_us;
-        }
-        uLastDmaUs = now_us;
+        vAdcBuffersCompleteTransfer();
     }
+    TRACE_END(TRACE_DMA_IRQ);
 }
 
 
@@ -98,8 +63,7 @@ void vApplyAdcSampleRate(void) {
     adc_set_clkdiv(div);
 
     uint32_t actual_fs = clk_adc_hz / div;
-    printf("ADC: target=%lu Hz, clk_adc=%lu Hz, clkdiv=%lu, actual=%lu Hz\n",
-           ulTargetSampleRateHz, clk_adc_hz, div, actual_fs);
+    LOG(LOG_ADC_RATE, ulTargetSampleRateHz, clk_adc_hz, div, actual_fs);
 }
 
 /* ADC DMA Initialization
@@ -108,10 +72,10 @@ void vApplyAdcSampleRate(void) {
  * Enables DMA interupts for buffer management w/ triple buffering.
  */
 void vAdcDmaInit() {
-    printf("ADC_DMA: Initializing...\n");
+    LOG(LOG_ADC_INIT);
 
     /* ADDED: Stop everything first if already initialized */
-    if (bCaptureRunning) {
+    if (bAdcDmaIsRunning()) {
         vAdcDmaStop();
     }
     
@@ -180,44 +144,24 @@ void vAdcDmaInit() {
     irq_set_enabled(DMA_IRQ_0, true);
 
     /* Initialize buffer states */
-    for(int i = 0; i < NUM_BUFFERS; i++) {
-        xBuffers[i].xState = BUFFER_EMPTY;
-        ulBufferTimestamp[i] = 0;     /* init timestamps */
-    }
-
-    ucWriteIndex = 0;                  /* explicit init */
-    ucLastCompleted = 0;               /* init last-completed */
-    ulOverruns = 0;                    /* reset overruns */
+    vAdcBuffersInit(vStartTransfer);
 }
 
 void vAdcDmaStartContinous() {
-    /* Start continuous capture */
-    bCaptureRunning = true;
-    ucWriteIndex = 0;
-    
     /* Drain FIFO before starting */
     adc_fifo_drain();
     
-    /* Begin our first transfer */
-    xBuffers[ucWriteIndex].xState = BUFFER_FILLING;
-    
     /* Start ADC AFTER setting clock divider */
     adc_run(true);
     
-    dma_channel_configure(
-        iDmaChannel,
-        &dmaConfig,
-        xBuffers[ucWriteIndex].usData,
-        &adc_hw->fifo,
-        ADC_BUFFER_SIZE,
-        true /* Start immediately */
-    );
+    /* Begin our first transfer */
+    vAdcBuffersStart();
 }
 
 void vAdcDmaStop() {
-    if (!bCaptureRunning) return;
+    if (!bAdcDmaIsRunning()) return;
     
-    printf("ADC_DMA: Stopping...\n");
+    LOG(LOG_ADC_STOP);
     
     /* Stop ADC conversion */
     adc_run(false);
@@ -231,53 +175,7 @@ void vAdcDmaStop() {
     /* Drain FIFO */
     adc_fifo_drain();
     
-    bCaptureRunning = false;
-    
-    /* ADDED: Reset buffer states */
-    taskENTER_CRITICAL();
-    for (int i = 0; i < NUM_BUFFERS; i++) {
-        xBuffers[i].xState = BUFFER_EMPTY;
-        ulBufferTimestamp[i] = 0;
-    }
-    ucWriteIndex = 0;
-    ucLastCompleted = 0;
-    taskEXIT_CRITICAL();
-}
-
-/* Zero-copy version: Returns pointer to DMA buffer (setting it to PROCESSING) */
-bool bAdcDmaGetLatestBufferPtr(uint16_t** pusBufferPtr, uint32_t* pulTimestamp) {
-    if (pusBufferPtr == NULL || pulTimestamp == NULL) return false;
-
-    bool ok = false;
-
-    /* CHANGE: Use a critical section to avoid races with ISR and use ucLastCompleted */
-    taskENTER_CRITICAL();
-    uint8_t latest = ucLastCompleted;
-
-    if (xBuffers[latest].xState == BUFFER_FULL) {
-        xBuffers[latest].xState = BUFFER_PROCESSING;  /* CHANGE: transfer ownership safely */
-        *pusBufferPtr = xBuffers[latest].usData;
-        *pulTimestamp = ulBufferTimestamp[latest];
-        ok = true;
-    }
-    taskEXIT_CRITICAL();
-
-    return ok;
-}
-
-/* Release a previously handed-out DMA buffer (setting it to EMPTY) */
-void vAdcDmaReleaseBuffer(uint16_t* pusBufferPtr) {
-    if (pusBufferPtr == NULL) return;
-
-    /* CHANGE: Protect against ISR while changing state */
-    taskENTER_CRITICAL();
-    for (int i = 0; i < NUM_BUFFERS; i++) {
-        if (xBuffers[i].usData == pusBufferPtr && xBuffers[i].xState == BUFFER_PROCESSING) {
-            xBuffers[i].xState = BUFFER_EMPTY;
-            break;
-        }
-    }
-    taskEXIT_CRITICAL();
+    vAdcBuffersStop();
 }
 
 /* Public API: change Fs and safely restart if running */
@@ -288,7 +186,7 @@ void vAdcDmaSetSampleRate(uint32_t ulHz) {
     ulTargetSampleRateHz = ulHz;
     
     // If capture is running, stop and restart with new rate
-    bool was_running = bCaptureRunning;
+    bool was_running = bAdcDmaIsRunning();
     if (was_running) {
         vAdcDmaStop();
     }
@@ -299,15 +197,9 @@ void vAdcDmaSetSampleRate(uint32_t ulHz) {
         vAdcDmaStartContinous();
     }
     
-    printf("Sample rate changed to %lu Hz\n", ulHz);
+    LOG(LOG_ADC_RATE_CHANGED, ulHz);
 }
 
 uint32_t ulAdcDmaGetSampleRate(void) {
     return ulTargetSampleRateHz;
 }
-
-uint32_t ulAdcDmaGetMeasuredSampleRate(void) { return ulMeasuredSampleRateHz; }
-
-bool bAdcDmaIsRunning(void) {
-    return bCaptureRunning;
-}
\ No newline at end of file
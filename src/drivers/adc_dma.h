@@ -2,14 +2,21 @@
 #define ADC_DMA_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "hardware/adc.h"
 
 #define ADC_CHANNEL         0      /* ADC channel (GPIO26) */
 #define ADC_PIN            26      /* Raspberry Pico 2 W GPIO pin number for ADC0 */
 #define ADC_BUFFER_SIZE    1024    /* Number of samples per buffer */
-#define NUM_BUFFERS        3       /* CHANGE: Triple buffering eliminates starvation */
+#define NUM_BUFFERS        6       /* Scope ring slots + one filling + one awaiting publish */
 
-/* Buffer states */
+/* Buffer states
+ * Ownership moves only by compare-and-swap on xState:
+ *   EMPTY/FULL -> FILLING     DMA ISR claims the next buffer to fill
+ *   FILLING -> FULL           DMA ISR, transfer complete
+ *   FULL -> PROCESSING        bAdcDmaGetLatestBufferPtr() hands it out
+ *   PROCESSING -> EMPTY       vAdcDmaReleaseBuffer()
+ */
 typedef enum {
     BUFFER_EMPTY = 0,
     BUFFER_FILLING,
@@ -17,22 +24,48 @@ typedef enum {
     BUFFER_PROCESSING
 } BufferState_t;
 
+/* Per-buffer counters */
+typedef struct {
+    uint32_t ulFills;            /* DMA transfers completed into this buffer */
+    uint32_t ulHandouts;         /* Times handed out for processing */
+    uint32_t ulOverwritten;      /* Refilled while FULL: capture never handed out */
+    uint32_t ulOverruns;         /* Refilled right after completing, all others busy */
+} AdcBufferStats_t;
+
 /* Buffer structure */
 typedef struct {
     uint16_t usData[ADC_BUFFER_SIZE];
-    BufferState_t xState;
+    uint32_t xState;             /* BufferState_t, accessed atomically */
+    uint32_t ulGeneration;       /* Bumped on every handout, part of the handle */
+    uint32_t ulTimestamp;        /* Completion time (ms since boot) */
+    AdcBufferStats_t xStats;
 } AdcBuffer_t;
 
-/* Overrun counter when ISR has to reuse current buffer to avoid PROCESSING */
-static volatile uint32_t ulOverruns = 0;
+/* Handle of a handed-out buffer: index in the low byte, generation above it.
+ * A handle goes stale once the buffer is released, so a late or double
+ * release is recognised instead of freeing someone else's capture.
+ */
+typedef uint32_t AdcBufferHandle_t;
+
+#define ADC_BUFFER_HANDLE_INVALID   0u
+#define ADC_BUFFER_HANDLE_INDEX(h)  ((uint8_t) ((h) & 0xFFu))
 
 void vAdcDmaInit(void);
 void vAdcDmaStartContinous(void);
 void vAdcDmaStop(void);
-bool bAdcDmaGetLatestBufferPtr(uint16_t** pusBufferPtr, uint32_t* pulTimestamp);
 
-/* Release a previously handed-out DMA buffer back to the pool */
-void vAdcDmaReleaseBuffer(uint16_t* pusBufferPtr);
+/* Hand out the most recently completed buffer (zero-copy) */
+bool bAdcDmaGetLatestBufferPtr(uint16_t** pusBufferPtr, uint32_t* pulTimestamp, AdcBufferHandle_t* pxHandle);
+
+/* Return a handed-out buffer to the pool (stale handles are counted and ignored) */
+void vAdcDmaReleaseBuffer(AdcBufferHandle_t xHandle);
+
+/* Counters of buffer ucIndex (< NUM_BUFFERS); false if out of range */
+bool bAdcDmaGetBufferStats(uint8_t ucIndex, AdcBufferStats_t* pxStats);
+/* Captures lost because every other buffer was busy (sum of ulOverruns) */
+uint32_t ulAdcDmaGetOverruns(void);
+/* Releases with a stale or invalid handle */
+uint32_t ulAdcDmaGetStaleReleases(void);
 
 /* Change sampling rate at runtime (Hz). Will safely restart DMA if needed. */
 void vAdcDmaSetSampleRate(uint32_t ulHz);
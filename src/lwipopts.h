@@ -44,6 +44,11 @@
 // Time
 #define LWIP_TIMEVAL_PRIVATE 0
 
+// Loopback: Mongoose's wake-up socket pair (mg_wakeup) talks over 127.0.0.1
+#define LWIP_NETIF_LOOPBACK 1
+#define LWIP_HAVE_LOOPIF 1
+#define LWIP_LOOPBACK_MAX_PBUFS 8
+
 #endif
 
 #endif
\ No newline at end of file
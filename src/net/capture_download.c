@@ -0,0 +1,188 @@
+#include "capture_download.h"
+#include "core/scope_data.h"
+#include "drivers/adc_dma.h"
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "third_party/mongoose.h"
+#undef poll
+
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+    CAPTURE_FMT_BIN = 0,
+    CAPTURE_FMT_CSV,
+    CAPTURE_FMT_WAV,
+} CaptureFormat_e;
+
+/* Per-connection transfer state, kept in c->data while a download runs */
+#define CAPTURE_STATE_MAGIC 0xCDu
+
+typedef struct {
+    uint8_t  ucMagic;               // CAPTURE_STATE_MAGIC while active
+    uint8_t  ucFormat;              // CaptureFormat_e
+    uint16_t usNext;                // Next sample to send
+    uint32_t ulSampleRate;          // At the start of the transfer (CSV time column)
+} DownloadState_t;
+
+_Static_assert(sizeof(DownloadState_t) <= MG_DATA_SIZE, "download state lives in mg_connection::data");
+
+static const struct {
+    const char *pcUri;
+    const char *pcType;
+} xFormats[] = {
+    [CAPTURE_FMT_BIN] = { "/capture.bin", "application/octet-stream" },
+    [CAPTURE_FMT_CSV] = { "/capture.csv", "text/csv" },
+    [CAPTURE_FMT_WAV] = { "/capture.wav", "audio/wav" },
+};
+
+/* Capture pinned for the running downloads (own scope_data consumer) */
+static int iConsumer = -1;
+static bool bHeld = false;
+static ScopeBuffer_t xFrozen;
+static uint32_t ulActive = 0;
+
+static inline DownloadState_t *pxState(struct mg_connection *c) {
+    return (DownloadState_t *) c->data;
+}
+
+static bool bIsDownload(struct mg_connection *c) {
+    return pxState(c)->ucMagic == CAPTURE_STATE_MAGIC;
+}
+
+/* Newest capture, unless downloads are running on the frozen one */
+static bool bFreezeCapture(void) {
+    if (iConsumer < 0) return false;
+    if (ulActive == 0 && (!bHeld || bScopeDataHasNew(iConsumer))) {
+        bHeld = bScopeDataAcquire(iConsumer, &xFrozen, SCOPE_READ_LATEST);
+    }
+    return bHeld;
+}
+
+static void vPutLe16(uint8_t *p, uint16_t v) { p[0] = (uint8_t) v; p[1] = (uint8_t) (v >> 8); }
+static void vPutLe32(uint8_t *p, uint32_t v) { vPutLe16(p, (uint16_t) v); vPutLe16(p + 2, (uint16_t) (v >> 16)); }
+
+static size_t xWavHeader(uint8_t *pucOut, uint32_t ulRate, uint32_t ulSamples) {
+    uint32_t ulData = ulSamples * 2u;
+    memcpy(pucOut, "RIFF", 4);
+    vPutLe32(pucOut + 4, 36u + ulData);
+    memcpy(pucOut + 8, "WAVEfmt ", 8);
+    vPutLe32(pucOut + 16, 16);              // fmt chunk size
+    vPutLe16(pucOut + 20, 1);               // PCM
+    vPutLe16(pucOut + 22, 1);               // Mono
+    vPutLe32(pucOut + 24, ulRate);
+    vPutLe32(pucOut + 28, ulRate * 2u);     // Byte rate
+    vPutLe16(pucOut + 32, 2);               // Block align
+    vPutLe16(pucOut + 34, 16);              // Bits per sample
+    memcpy(pucOut + 36, "data", 4);
+    vPutLe32(pucOut + 40, ulData);
+    return 44;
+}
+
+/* Next piece of the body, at most CAPTURE_CHUNK_SIZE bytes; 0 when done */
+static size_t xFillChunk(DownloadState_t *pxDl, char *pcOut) {
+    const uint16_t *pusSamples = xFrozen.pusSamples;
+    uint32_t i = pxDl->usNext;
+    size_t n = 0;
+
+    switch ((CaptureFormat_e) pxDl->ucFormat) {
+        case CAPTURE_FMT_BIN:
+        case CAPTURE_FMT_WAV:
+            for (; i < ADC_BUFFER_SIZE && n + 2 <= CAPTURE_CHUNK_SIZE; i++, n += 2) {
+                uint16_t usValue = pusSamples[i] & 0x0FFFu;
+                if (pxDl->ucFormat == CAPTURE_FMT_WAV) usValue = (uint16_t) ((int16_t) (usValue - 2048) * 16);
+                vPutLe16((uint8_t *) pcOut + n, usValue);
+            }
+            break;
+        case CAPTURE_FMT_CSV: {
+            double dDt = pxDl->ulSampleRate ? 1.0 / (double) pxDl->ulSampleRate : 0.0;
+            char acRow[48];
+            for (; i < ADC_BUFFER_SIZE; i++) {
+                uint16_t usCounts = pusSamples[i] & 0x0FFFu;
+                int iRow = snprintf(acRow, sizeof(acRow), "%lu,%.9f,%u,%.4f\n", (unsigned long) i, dDt * i,
+                                    usCounts, (double) usCounts * 3.3 / 4095.0);
+                if (iRow <= 0 || n + (size_t) iRow > CAPTURE_CHUNK_SIZE) break;
+                memcpy(pcOut + n, acRow, (size_t) iRow);
+                n += (size_t) iRow;
+            }
+            break;
+        }
+    }
+    pxDl->usNext = (uint16_t) i;
+    return n;
+}
+
+static void vFinish(struct mg_connection *c) {
+    memset(pxState(c), 0, sizeof(DownloadState_t));
+    if (ulActive > 0) ulActive--;
+}
+
+void vCaptureDownloadInit(void) {
+    if (iConsumer < 0) iConsumer = iScopeDataRegisterConsumer("download", NULL);
+    if (iConsumer < 0) printf("Capture download: no scope_data consumer slot, downloads disabled\n");
+}
+
+void vCaptureDownloadOnWrite(struct mg_connection *c) {
+    if (!bIsDownload(c)) return;
+    DownloadState_t *pxDl = pxState(c);
+    char acChunk[CAPTURE_CHUNK_SIZE];
+    while (c->send.len < CAPTURE_SEND_LOW_WATER) {
+        size_t n = xFillChunk(pxDl, acChunk);
+        if (n == 0) {
+            mg_http_write_chunk(c, "", 0);      // Last chunk
+            vFinish(c);
+            return;
+        }
+        mg_http_write_chunk(c, acChunk, n);
+    }
+}
+
+void vCaptureDownloadOnClose(struct mg_connection *c) {
+    if (bIsDownload(c)) vFinish(c);
+}
+
+bool bCaptureDownloadHandle(struct mg_connection *c, const char *pcUri, size_t xUriLen) {
+    int iFormat = -1;
+    for (size_t i = 0; i < sizeof(xFormats) / sizeof(xFormats[0]); i++) {
+        if (strlen(xFormats[i].pcUri) == xUriLen && memcmp(xFormats[i].pcUri, pcUri, xUriLen) == 0) iFormat = (int) i;
+    }
+    if (iFormat < 0) return false;
+
+    if (bIsDownload(c)) {
+        mg_http_reply(c, 409, "", "Download in progress\n");
+        return true;
+    }
+    if (!bFreezeCapture()) {
+        mg_http_reply(c, 503, "Retry-After: 1\r\n", "No capture available\n");
+        return true;
+    }
+
+    ulActive++;
+    DownloadState_t *pxDl = pxState(c);
+    pxDl->ucMagic = CAPTURE_STATE_MAGIC;
+    pxDl->ucFormat = (uint8_t) iFormat;
+    pxDl->usNext = 0;
+    pxDl->ulSampleRate = ulAdcDmaGetSampleRate();
+
+    char acHdr[384];
+    int n = snprintf(acHdr, sizeof(acHdr),
+                     "HTTP/1.1 200 OK\r\nContent-Type: %s\r\n"
+                     "Content-Disposition: attachment; filename=\"capture_%lu%s\"\r\n"
+                     "X-Sample-Rate: %lu\r\nX-Samples: %u\r\nX-Sequence: %lu\r\nX-Timestamp-Ms: %lu\r\n"
+                     "X-Volts-Per-Count: %.9f\r\nCache-Control: no-store\r\nTransfer-Encoding: chunked\r\n\r\n",
+                     xFormats[iFormat].pcType, (unsigned long) xFrozen.ulSequence, xFormats[iFormat].pcUri + 8,
+                     (unsigned long) pxDl->ulSampleRate, (unsigned) ADC_BUFFER_SIZE,
+                     (unsigned long) xFrozen.ulSequence, (unsigned long) xFrozen.ulTimestamp, 3.3 / 4095.0);
+    mg_send(c, acHdr, (size_t) n);
+
+    if (iFormat == CAPTURE_FMT_WAV) {
+        uint8_t ucWav[44];
+        mg_http_write_chunk(c, (const char *) ucWav, xWavHeader(ucWav, pxDl->ulSampleRate, ADC_BUFFER_SIZE));
+    } else if (iFormat == CAPTURE_FMT_CSV) {
+        mg_http_write_chunk(c, "index,time_s,counts,volts\n", 26);
+    }
+    vCaptureDownloadOnWrite(c);
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef CAPTURE_DOWNLOAD_H
+#define CAPTURE_DOWNLOAD_H
+
+// Do NOT include mongoose.h here to avoid leaking lwIP macros like poll
+
+#include <stddef.h>
+#include <stdbool.h>
+
+struct mg_connection;
+
+/*
+ * HTTP capture download: GET /capture.bin, /capture.csv, /capture.wav
+ *
+ * Streams the newest raw capture (ADC_BUFFER_SIZE samples) as a chunked
+ * response. The body is produced CAPTURE_CHUNK_SIZE bytes at a time whenever
+ * the connection's send buffer drains below CAPTURE_SEND_LOW_WATER
+ * (MG_EV_WRITE), so it is never held in RAM as a whole.
+ *
+ * The capture stays pinned in scope_data (own consumer) for the whole
+ * transfer; acquisition goes on in the other ring slots. Downloads that run at
+ * the same time share the pinned capture; the next download after they all
+ * finished takes the newest one.
+ *
+ *  - .bin  uint16 little endian ADC counts (12 bit)
+ *  - .csv  index,time_s,counts,volts
+ *  - .wav  16-bit mono PCM at the sample rate, mid-scale (2048) = 0
+ *
+ * Metadata headers: X-Sample-Rate (Hz), X-Samples, X-Sequence,
+ * X-Timestamp-Ms (capture completion) and X-Volts-Per-Count.
+ */
+
+#define CAPTURE_CHUNK_SIZE      512u
+#define CAPTURE_SEND_LOW_WATER  1024u
+
+/* Register the scope_data consumer (before the first request) */
+void vCaptureDownloadInit(void);
+
+/* Handle a request for uri (e.g. "/capture.csv"); false if it is not a capture URI */
+bool bCaptureDownloadHandle(struct mg_connection *c, const char *pcUri, size_t xUriLen);
+
+/* Send buffer drained / connection closing (all HTTP connections) */
+void vCaptureDownloadOnWrite(struct mg_connection *c);
+void vCaptureDownloadOnClose(struct mg_connection *c);
+
+#endif /* CAPTURE_DOWNLOAD_H */
@@ -0,0 +1,206 @@
+#include "frame_codec.h"
+#include <string.h>
+
+/* Nibble stream writer for the delta varint payload */
+typedef struct {
+    uint8_t* pucBuf;
+    size_t   xCap;
+    size_t   xNibbles;
+    bool     bOverflow;
+} NibbleWriter_t;
+
+static inline void vPutNibble(NibbleWriter_t* pxW, uint8_t ucNibble) {
+    size_t xByte = pxW->xNibbles >> 1;
+    if (xByte >= pxW->xCap) {
+        pxW->bOverflow = true;
+        return;
+    }
+    if ((pxW->xNibbles & 1u) == 0) {
+        pxW->pucBuf[xByte] = (uint8_t)(ucNibble & 0x0Fu);
+    } else {
+        pxW->pucBuf[xByte] |= (uint8_t)((ucNibble & 0x0Fu) << 4);
+    }
+    pxW->xNibbles++;
+}
+
+/* 3 data bits per nibble, bit 3 set while more groups follow */
+static inline void vPutVarint(NibbleWriter_t* pxW, uint32_t ulValue) {
+    while (ulValue > 0x7u) {
+        vPutNibble(pxW, (uint8_t)(0x8u | (ulValue & 0x7u)));
+        ulValue >>= 3;
+    }
+    vPutNibble(pxW, (uint8_t) ulValue);
+}
+
+static inline uint32_t ulZigzag(int32_t lValue) {
+    return ((uint32_t) lValue << 1) ^ (uint32_t)(lValue >> 31);
+}
+
+/* Map ADC counts onto 0..255 across the vertical window */
+static inline uint8_t ucQuantize(uint16_t usSample, uint16_t usLo, uint16_t usHi) {
+    if (usSample <= usLo) return 0;
+    if (usSample >= usHi) return 255;
+    return (uint8_t)(((uint32_t)(usSample - usLo) * 255u + ((usHi - usLo) >> 1)) / (uint32_t)(usHi - usLo));
+}
+
+static inline uint16_t usToMillivolts(float fVolts) {
+    if (fVolts <= 0.0f) return 0;
+    if (fVolts >= 65.535f) return 0xFFFFu;
+    return (uint16_t)(fVolts * 1000.0f + 0.5f);
+}
+
+/* Symbol i of the stream for a given encoding (what delta coding operates on) */
+static inline uint16_t usSymbol(const uint16_t* pusSamples, uint16_t usIndex, FrameEncoding_e eEncoding,
+                                uint16_t usLo, uint16_t usHi) {
+    uint16_t usSample = pusSamples[usIndex];
+    switch (eEncoding) {
+        case FRAME_ENC_PACK12: return (uint16_t)(usSample & 0x0FFFu);
+        case FRAME_ENC_QUANT8: return ucQuantize(usSample, usLo, usHi);
+        default:               return usSample;
+    }
+}
+
+static size_t xEncodeDelta(const uint16_t* pusSamples, uint16_t usCount, FrameEncoding_e eEncoding,
+                           uint16_t usLo, uint16_t usHi, uint8_t* pucOut, size_t xCap) {
+    NibbleWriter_t xW = { pucOut, xCap, 0, false };
+    int32_t lPrev = 0;
+    for (uint16_t i = 0; i < usCount; i++) {
+        int32_t lSym = (int32_t) usSymbol(pusSamples, i, eEncoding, usLo, usHi);
+        vPutVarint(&xW, ulZigzag(lSym - lPrev));
+        lPrev = lSym;
+    }
+    if (xW.bOverflow) return 0;
+    return (xW.xNibbles + 1u) >> 1;
+}
+
+static size_t xEncodeInter(const uint16_t* pusSamples, const uint16_t* pusRef, uint16_t usCount,
+                           FrameEncoding_e eEncoding, uint16_t usLo, uint16_t usHi, uint8_t* pucOut, size_t xCap) {
+    NibbleWriter_t xW = { pucOut, xCap, 0, false };
+    for (uint16_t i = 0; i < usCount; i++) {
+        int32_t lCur = (int32_t) usSymbol(pusSamples, i, eEncoding, usLo, usHi);
+        int32_t lRef = (int32_t) usSymbol(pusRef, i, eEncoding, usLo, usHi);
+        vPutVarint(&xW, ulZigzag(lCur - lRef));
+    }
+    if (xW.bOverflow) return 0;
+    return (xW.xNibbles + 1u) >> 1;
+}
+
+static size_t xEncodePlain(const uint16_t* pusSamples, uint16_t usCount, FrameEncoding_e eEncoding,
+                           uint16_t usLo, uint16_t usHi, uint8_t* pucOut, size_t xCap) {
+    size_t xLen = 0;
+    switch (eEncoding) {
+        case FRAME_ENC_U16:
+            xLen = (size_t) usCount * 2u;
+            if (xLen > xCap) return 0;
+            for (uint16_t i = 0; i < usCount; i++) {
+                pucOut[2u * i]      = (uint8_t)(pusSamples[i] & 0xFFu);
+                pucOut[2u * i + 1u] = (uint8_t)(pusSamples[i] >> 8);
+            }
+            return xLen;
+
+        case FRAME_ENC_PACK12: {
+            xLen = ((size_t) usCount * 3u + 1u) / 2u;
+            if (xLen > xCap) return 0;
+            uint8_t* pucW = pucOut;
+            uint16_t i = 0;
+            for (; i + 1u < usCount; i += 2u) {
+                uint16_t usA = pusSamples[i] & 0x0FFFu;
+                uint16_t usB = pusSamples[i + 1u] & 0x0FFFu;
+                *pucW++ = (uint8_t)(usA & 0xFFu);
+                *pucW++ = (uint8_t)((usA >> 8) | ((usB & 0x0Fu) << 4));
+                *pucW++ = (uint8_t)(usB >> 4);
+            }
+            if (i < usCount) {
+                uint16_t usA = pusSamples[i] & 0x0FFFu;
+                *pucW++ = (uint8_t)(usA & 0xFFu);
+                *pucW++ = (uint8_t)(usA >> 8);
+            }
+            return xLen;
+        }
+
+        case FRAME_ENC_QUANT8:
+            xLen = usCount;
+            if (xLen > xCap) return 0;
+            for (uint16_t i = 0; i < usCount; i++) pucOut[i] = ucQuantize(pusSamples[i], usLo, usHi);
+            return xLen;
+
+        default:
+            return 0;
+    }
+}
+
+bool bFrameWithinThreshold(const uint16_t* pusSamples, const uint16_t* pusRef, uint16_t usCount,
+                           uint32_t ulThreshold) {
+    if (!pusSamples || !pusRef) return false;
+    for (uint16_t i = 0; i < usCount; i++) {
+        int32_t lDiff = (int32_t) pusSamples[i] - (int32_t) pusRef[i];
+        if (lDiff < 0) lDiff = -lDiff;
+        if ((uint32_t) lDiff > ulThreshold) return false;
+    }
+    return true;
+}
+
+size_t xFrameEncode(const FrameInfo_t* pxInfo, const uint16_t* pusSamples, uint16_t usCount,
+                    FrameEncoding_e eEncoding, uint8_t ucFlags, const uint16_t* pusRef,
+                    uint8_t* pucOut, size_t xOutCap) {
+    if (!pxInfo || !pusSamples || !pucOut || eEncoding >= FRAME_ENC_COUNT) return 0;
+    if (xOutCap < sizeof(FrameHeader_t)) return 0;
+    if ((ucFlags & FRAME_FLAG_INTER) && !pusRef) return 0;
+
+    uint16_t usLo = pxInfo->usVertLo;
+    uint16_t usHi = pxInfo->usVertHi;
+    if (usHi <= usLo) {
+        usLo = 0;
+        usHi = 4095;
+    }
+
+    uint8_t* pucPayload = pucOut + sizeof(FrameHeader_t);
+    size_t xCap = xOutCap - sizeof(FrameHeader_t);
+    size_t xPayloadLen = 0;
+    if (ucFlags & FRAME_FLAG_KEEPALIVE) {
+        ucFlags = FRAME_FLAG_KEEPALIVE;
+    } else {
+        if (ucFlags & FRAME_FLAG_INTER) {
+            ucFlags = FRAME_FLAG_INTER;
+            xPayloadLen = xEncodeInter(pusSamples, pusRef, usCount, eEncoding, usLo, usHi, pucPayload, xCap);
+        } else if (ucFlags & FRAME_FLAG_DELTA) {
+            ucFlags = FRAME_FLAG_DELTA;
+            xPayloadLen = xEncodeDelta(pusSamples, usCount, eEncoding, usLo, usHi, pucPayload, xCap);
+        } else {
+            ucFlags = 0;
+            xPayloadLen = xEncodePlain(pusSamples, usCount, eEncoding, usLo, usHi, pucPayload, xCap);
+        }
+        if (usCount > 0 && (xPayloadLen == 0 || xPayloadLen > 0xFFFFu)) return 0;
+    }
+
+    FrameHeader_t xHdr;
+    memset(&xHdr, 0, sizeof(xHdr));
+    xHdr.usMagic        = FRAME_MAGIC;
+    xHdr.ucVersion      = FRAME_VERSION;
+    xHdr.ucHeaderLen    = (uint8_t) sizeof(FrameHeader_t);
+    xHdr.ucEncoding     = (uint8_t) eEncoding;
+    xHdr.ucFlags        = ucFlags;
+    xHdr.ucChannel      = pxInfo->ucChannel;
+    xHdr.ucView         = pxInfo->ucView;
+    xHdr.ulSequence     = pxInfo->ulSequence;
+    xHdr.ulTimestampMs  = pxInfo->ulTimestampMs;
+    xHdr.usAgeMs        = (uint16_t)(pxInfo->ulAgeMs > 0xFFFFu ? 0xFFFFu : pxInfo->ulAgeMs);
+    xHdr.usSampleCount  = usCount;
+    xHdr.ulSampleRateHz = pxInfo->ulSampleRateHz;
+    xHdr.fTimePerDivMs  = pxInfo->fTimePerDivMs;
+    xHdr.sTriggerPoint  = -1;
+    if (pxInfo->lTriggerPoint >= 0 && pxInfo->lTriggerPoint < (int32_t) usCount) {
+        xHdr.sTriggerPoint = (int16_t) pxInfo->lTriggerPoint;
+        xHdr.ucFlags |= FRAME_FLAG_TRIGGERED;
+    }
+    xHdr.usVertLo       = usLo;
+    xHdr.usVertHi       = usHi;
+    xHdr.usVminMv       = usToMillivolts(pxInfo->fVmin);
+    xHdr.usVmaxMv       = usToMillivolts(pxInfo->fVmax);
+    xHdr.usVavgMv       = usToMillivolts(pxInfo->fVavg);
+    xHdr.usPayloadLen   = (uint16_t) xPayloadLen;
+    xHdr.usConfigVersion = (uint16_t) pxInfo->ulConfigVersion;
+
+    memcpy(pucOut, &xHdr, sizeof(xHdr));
+    return sizeof(FrameHeader_t) + xPayloadLen;
+}
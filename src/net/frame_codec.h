@@ -0,0 +1,133 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Waveform frame format v2 (WebSocket binary messages)
+ *
+ * Every frame starts with a FrameHeader_t. The header carries its own length,
+ * so the decoder finds the payload at ucHeaderLen and older clients can skip
+ * fields appended by later versions. All fields are little endian.
+ *
+ * A message may carry several frames back to back (batching on busy links);
+ * each one ends at ucHeaderLen + usPayloadLen.
+ *
+ * Payload encodings (ucEncoding):
+ *  - FRAME_ENC_U16:    one uint16_t per sample (12-bit ADC counts)
+ *  - FRAME_ENC_PACK12: two 12-bit samples in three bytes
+ *                      b0 = a[7:0], b1 = a[11:8] | b[3:0] << 4, b2 = b[11:4]
+ *  - FRAME_ENC_QUANT8: one byte per sample, 0..255 across the vertical window
+ *                      [usVertLo .. usVertHi] (counts outside are clamped)
+ *
+ * FRAME_FLAG_DELTA: the symbol stream of the encoding above (16/12-bit counts or
+ * 8-bit codes) is delta coded against the previous symbol (first against 0),
+ * zigzag mapped and written as nibble varints: 3 data bits plus a continuation
+ * bit (0x8) per nibble, least significant group first, low nibble of each byte
+ * first. A trailing unused nibble is zero.
+ *
+ * Inter-frame coding (per client, against the last frame sent to it):
+ *  - FRAME_FLAG_INTER:     payload holds symbol residuals against the previous
+ *                          frame, zigzag mapped and nibble varint coded as above.
+ *                          Sent only when encoding, window and count match the
+ *                          reference; the client adds them to its last symbols.
+ *  - FRAME_FLAG_KEEPALIVE: no payload; every sample is within the threshold of
+ *                          the previous frame, so the client keeps its trace and
+ *                          only refreshes the header fields.
+ * Frames with neither flag are keyframes and reset the client's reference.
+ * Each FrameView_e stream (ucView) has its own reference.
+ *
+ * usConfigVersion is the view snapshot the frame was rendered with; command
+ * replies carry the same number, so a client knows from which frame on its
+ * settings are in effect.
+ */
+
+#define FRAME_MAGIC          0x5350u    /* "PS" on the wire */
+#define FRAME_VERSION        2u
+
+typedef enum {
+    FRAME_ENC_U16 = 0,
+    FRAME_ENC_PACK12,
+    FRAME_ENC_QUANT8,
+    FRAME_ENC_COUNT
+} FrameEncoding_e;
+
+/* Stream within a client's view: one capture can yield several frames */
+typedef enum {
+    FRAME_VIEW_MAIN = 0,         /* Full span */
+    FRAME_VIEW_ZOOM,             /* Zoomed sub-window of the same capture */
+    FRAME_VIEW_COUNT
+} FrameView_e;
+
+#define FRAME_FLAG_DELTA       0x01u    /* Payload is delta + nibble varint coded */
+#define FRAME_FLAG_TRIGGERED   0x02u    /* Trigger edge found, sTriggerPoint valid */
+#define FRAME_FLAG_INTER       0x04u    /* Payload is residuals against the previous frame */
+#define FRAME_FLAG_KEEPALIVE   0x08u    /* No payload, previous frame still valid */
+
+/* Keep-alive threshold in ADC counts (~6 mV) and forced keyframe interval */
+#define FRAME_KEEPALIVE_THRESHOLD   8u
+#define FRAME_KEYFRAME_INTERVAL     32u
+
+typedef struct __attribute__((packed)) {
+    uint16_t usMagic;            // offset 0
+    uint8_t  ucVersion;          // offset 2
+    uint8_t  ucHeaderLen;        // offset 3, payload starts here
+    uint8_t  ucEncoding;         // offset 4, FrameEncoding_e
+    uint8_t  ucFlags;            // offset 5, FRAME_FLAG_*
+    uint8_t  ucChannel;          // offset 6, ADC input
+    uint8_t  ucView;             // offset 7, FrameView_e
+    uint32_t ulSequence;         // offset 8, frame counter
+    uint32_t ulTimestampMs;      // offset 12, capture completion time
+    uint16_t usAgeMs;            // offset 16, capture-to-send age (saturating)
+    uint16_t usSampleCount;      // offset 18, display points in payload
+    uint32_t ulSampleRateHz;     // offset 20
+    float    fTimePerDivMs;      // offset 24
+    int16_t  sTriggerPoint;      // offset 28, trigger position in display points (-1 none)
+    uint16_t usVertLo;           // offset 30, vertical window in ADC counts
+    uint16_t usVertHi;           // offset 32
+    uint16_t usVminMv;           // offset 34, buffer statistics in millivolts
+    uint16_t usVmaxMv;           // offset 36
+    uint16_t usVavgMv;           // offset 38
+    uint16_t usPayloadLen;       // offset 40
+    uint16_t usConfigVersion;    // offset 42, view snapshot the frame was built from (low 16 bits)
+} FrameHeader_t;                 // 44 bytes
+
+/* Frame metadata filled in by the streamer before encoding */
+typedef struct {
+    uint32_t ulSequence;
+    uint32_t ulTimestampMs;
+    uint32_t ulAgeMs;
+    uint32_t ulSampleRateHz;
+    float    fTimePerDivMs;
+    int32_t  lTriggerPoint;      // -1 if not triggered
+    uint8_t  ucChannel;
+    uint8_t  ucView;             // FrameView_e
+    uint32_t ulConfigVersion;    // See ulDspPublishViews()
+    uint16_t usVertLo;
+    uint16_t usVertHi;
+    float    fVmin;
+    float    fVmax;
+    float    fVavg;
+} FrameInfo_t;
+
+/* Worst-case encoded size for usCount samples (delta varint of 16-bit symbols) */
+#define FRAME_MAX_SIZE(usCount)  (sizeof(FrameHeader_t) + (size_t)(usCount) * 3u + 1u)
+
+/* Encode one frame into pucOut.
+ * ucFlags selects FRAME_FLAG_DELTA, FRAME_FLAG_INTER or FRAME_FLAG_KEEPALIVE;
+ * pusRef is the previous frame (same count, raw counts) and is required for
+ * FRAME_FLAG_INTER only.
+ * Returns the number of bytes written, or 0 if the arguments are invalid or
+ * xOutCap is too small.
+ */
+size_t xFrameEncode(const FrameInfo_t* pxInfo, const uint16_t* pusSamples, uint16_t usCount,
+                    FrameEncoding_e eEncoding, uint8_t ucFlags, const uint16_t* pusRef,
+                    uint8_t* pucOut, size_t xOutCap);
+
+/* True if every sample is within ulThreshold counts of the reference */
+bool bFrameWithinThreshold(const uint16_t* pusSamples, const uint16_t* pusRef, uint16_t usCount,
+                           uint32_t ulThreshold);
+
+#endif /* FRAME_CODEC_H */
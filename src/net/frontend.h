@@ -1,5 +0,0 @@
-#pragma once
-#include <stddef.h>
-
-extern const char frontend_index_html[];
-extern const size_t frontend_index_html_len;
\ No newline at end of file
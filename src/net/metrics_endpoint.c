@@ -0,0 +1,364 @@
+#include "metrics_endpoint.h"
+#include "mg_handler.h"
+#include "mg_pool.h"
+#include "udp_stream.h"
+#include "core/metrics.h"
+#include "core/scope_data.h"
+#include "core/scope_view.h"
+#include "core/frame_queue.h"
+#include "core/dsp_task.h"
+#include "core/cpu_load.h"
+#include "core/log.h"
+#include "drivers/adc_dma.h"
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "pico/cyw43_arch.h"
+
+#include "third_party/mongoose.h"
+#undef poll
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Text rendered into a small buffer and sent as one HTTP chunk whenever it fills */
+typedef struct {
+    struct mg_connection *c;
+    size_t xLen;
+    char acBuf[METRICS_CHUNK_SIZE];
+} MetricsWriter_t;
+
+/* Per-connection transfer state, kept in c->data while /metrics is streamed */
+#define METRICS_STATE_MAGIC 0x3Du
+
+typedef struct {
+    uint8_t ucMagic;                // METRICS_STATE_MAGIC while sending
+    uint8_t ucStep;                 // Next entry of xSteps
+} MetricsState_t;
+
+_Static_assert(sizeof(MetricsState_t) <= MG_DATA_SIZE, "metrics state lives in mg_connection::data");
+
+static TaskStatus_t xTasks[METRICS_MAX_TASKS];
+
+static void vFlush(MetricsWriter_t *pxW) {
+    if (pxW->xLen == 0) return;
+    mg_http_write_chunk(pxW->c, pxW->acBuf, pxW->xLen);
+    pxW->xLen = 0;
+}
+
+static void vPrint(MetricsWriter_t *pxW, const char *pcFmt, ...) {
+    for (int iTry = 0; iTry < 2; iTry++) {
+        va_list ap;
+        va_start(ap, pcFmt);
+        size_t xRoom = sizeof(pxW->acBuf) - pxW->xLen;
+        int n = vsnprintf(pxW->acBuf + pxW->xLen, xRoom, pcFmt, ap);
+        va_end(ap);
+        if (n < 0) return;
+        if ((size_t) n < xRoom) {
+            pxW->xLen += (size_t) n;
+            return;
+        }
+        // Did not fit: send what is there and render the line again (lines are short)
+        vFlush(pxW);
+    }
+}
+
+/* # HELP / # TYPE preamble of one metric family */
+static void vFamily(MetricsWriter_t *pxW, const char *pcName, const char *pcType, const char *pcHelp) {
+    vPrint(pxW, "# HELP picoscope_%s %s\n# TYPE picoscope_%s %s\n", pcName, pcHelp, pcName, pcType);
+}
+
+static void vScalar(MetricsWriter_t *pxW, const char *pcName, const char *pcType, const char *pcHelp,
+                    unsigned long ulValue) {
+    vFamily(pxW, pcName, pcType, pcHelp);
+    vPrint(pxW, "picoscope_%s %lu\n", pcName, ulValue);
+}
+
+static void vWriteUptime(MetricsWriter_t *pxW) {
+    vScalar(pxW, "uptime_seconds", "counter", "Time since boot", (unsigned long) (time_us_64() / 1000000u));
+}
+
+static void vWriteAdcBuffers(MetricsWriter_t *pxW) {
+    AdcBufferStats_t xBuf[NUM_BUFFERS];
+    for (uint8_t i = 0; i < NUM_BUFFERS; i++) {
+        if (!bAdcDmaGetBufferStats(i, &xBuf[i])) memset(&xBuf[i], 0, sizeof(xBuf[i]));
+    }
+    vFamily(pxW, "adc_buffer_fills_total", "counter", "DMA transfers completed per buffer");
+    for (uint8_t i = 0; i < NUM_BUFFERS; i++) {
+        vPrint(pxW, "picoscope_adc_buffer_fills_total{buffer=\"%u\"} %lu\n", i, (unsigned long) xBuf[i].ulFills);
+    }
+    vFamily(pxW, "adc_buffer_overwritten_total", "counter", "Captures refilled before they were handed out");
+    for (uint8_t i = 0; i < NUM_BUFFERS; i++) {
+        vPrint(pxW, "picoscope_adc_buffer_overwritten_total{buffer=\"%u\"} %lu\n", i,
+               (unsigned long) xBuf[i].ulOverwritten);
+    }
+    vFamily(pxW, "adc_buffer_overruns_total", "counter", "Captures lost because every other buffer was busy");
+    for (uint8_t i = 0; i < NUM_BUFFERS; i++) {
+        vPrint(pxW, "picoscope_adc_buffer_overruns_total{buffer=\"%u\"} %lu\n", i, (unsigned long) xBuf[i].ulOverruns);
+    }
+}
+
+static void vWriteAdcRate(MetricsWriter_t *pxW) {
+    vScalar(pxW, "adc_stale_releases_total", "counter", "Buffer releases with a stale handle",
+            ulAdcDmaGetStaleReleases());
+    vFamily(pxW, "adc_sample_rate_hz", "gauge", "ADC sample rate");
+    vPrint(pxW, "picoscope_adc_sample_rate_hz{kind=\"target\"} %lu\npicoscope_adc_sample_rate_hz{kind=\"measured\"} %lu\n",
+           (unsigned long) ulAdcDmaGetSampleRate(), (unsigned long) ulAdcDmaGetMeasuredSampleRate());
+
+    vScalar(pxW, "publish_drops_total", "counter", "Captures not published because every ring slot was pinned",
+            ulScopeDataPublishDrops());
+}
+
+static void vWriteConsumers(MetricsWriter_t *pxW) {
+    ScopeConsumerStats_t xStats[SCOPE_MAX_CONSUMERS];
+    const char *pcNames[SCOPE_MAX_CONSUMERS];
+    for (int i = 0; i < SCOPE_MAX_CONSUMERS; i++) {
+        pcNames[i] = bScopeDataGetConsumerStats(i, &xStats[i]) ? pcScopeDataConsumerName(i) : NULL;
+    }
+    vFamily(pxW, "consumer_consumed_total", "counter", "Captures acquired per scope_data consumer");
+    for (int i = 0; i < SCOPE_MAX_CONSUMERS; i++) {
+        if (pcNames[i] == NULL) continue;
+        vPrint(pxW, "picoscope_consumer_consumed_total{consumer=\"%s\"} %lu\n", pcNames[i],
+               (unsigned long) xStats[i].ulConsumed);
+    }
+    vFamily(pxW, "consumer_dropped_total", "counter", "Captures published but never seen per consumer");
+    for (int i = 0; i < SCOPE_MAX_CONSUMERS; i++) {
+        if (pcNames[i] == NULL) continue;
+        vPrint(pxW, "picoscope_consumer_dropped_total{consumer=\"%s\"} %lu\n", pcNames[i],
+               (unsigned long) xStats[i].ulDropped);
+    }
+}
+
+static void vWriteLatency(MetricsWriter_t *pxW) {
+    MetricsLatency_t xLat;
+    vMetricsGetLatency(&xLat);
+    vFamily(pxW, "capture_to_send_latency_ms", "histogram", "Capture completion to frame written to its socket");
+    unsigned long ulCumulative = 0;
+    for (uint32_t i = 0; i < METRICS_LATENCY_BOUNDS; i++) {
+        ulCumulative += xLat.ulBucket[i];
+        vPrint(pxW, "picoscope_capture_to_send_latency_ms_bucket{le=\"%u\"} %lu\n",
+               (unsigned) usMetricsLatencyBoundsMs[i], ulCumulative);
+    }
+    vPrint(pxW, "picoscope_capture_to_send_latency_ms_bucket{le=\"+Inf\"} %lu\n"
+                "picoscope_capture_to_send_latency_ms_sum %llu\npicoscope_capture_to_send_latency_ms_count %lu\n",
+           (unsigned long) xLat.ulCount, (unsigned long long) xLat.ullSumMs, (unsigned long) xLat.ulCount);
+}
+
+static void vWriteStages(MetricsWriter_t *pxW) {
+    MetricsStageStats_t xStage[METRICS_STAGE_COUNT];
+    for (int i = 0; i < METRICS_STAGE_COUNT; i++) vMetricsGetStage((MetricsStage_e) i, &xStage[i]);
+
+    vFamily(pxW, "stage_cycles_total", "counter", "CPU cycles spent per pipeline stage");
+    for (int i = 0; i < METRICS_STAGE_COUNT; i++) {
+        vPrint(pxW, "picoscope_stage_cycles_total{stage=\"%s\"} %llu\n", pcMetricsStageName((MetricsStage_e) i),
+               (unsigned long long) xStage[i].ullTotalCycles);
+    }
+    vFamily(pxW, "stage_runs_total", "counter", "Runs per pipeline stage");
+    for (int i = 0; i < METRICS_STAGE_COUNT; i++) {
+        vPrint(pxW, "picoscope_stage_runs_total{stage=\"%s\"} %lu\n", pcMetricsStageName((MetricsStage_e) i),
+               (unsigned long) xStage[i].ulRuns);
+    }
+    vFamily(pxW, "stage_cycles_max", "gauge", "Longest run per pipeline stage in CPU cycles");
+    for (int i = 0; i < METRICS_STAGE_COUNT; i++) {
+        vPrint(pxW, "picoscope_stage_cycles_max{stage=\"%s\"} %lu\n", pcMetricsStageName((MetricsStage_e) i),
+               (unsigned long) xStage[i].ulMaxCycles);
+    }
+}
+
+static void vWriteCpu(MetricsWriter_t *pxW) {
+    vScalar(pxW, "cpu_hz", "gauge", "System clock (stage cycles per second)", (unsigned long) clock_get_hz(clk_sys));
+    vFamily(pxW, "cpu_load_percent", "gauge", "Busy time per core over the last second");
+    for (uint8_t i = 0; i < CPU_LOAD_CORES; i++) {
+        vPrint(pxW, "picoscope_cpu_load_percent{core=\"%u\"} %u\n", i, ucCpuLoadGetPercent(i));
+    }
+    uint32_t ulDspUs, ulDspMaxUs;
+    vDspGetTiming(&ulDspUs, &ulDspMaxUs);
+    vFamily(pxW, "dsp_pass_us", "gauge", "DSP task time per capture");
+    vPrint(pxW, "picoscope_dsp_pass_us{kind=\"last\"} %lu\npicoscope_dsp_pass_us{kind=\"max\"} %lu\n",
+           (unsigned long) ulDspUs, (unsigned long) ulDspMaxUs);
+}
+
+static void vWriteFrames(MetricsWriter_t *pxW) {
+    uint32_t ulRenders, ulHits, ulQueued, ulFull, ulDepth;
+    vScopeViewGetStats(&ulRenders, &ulHits);
+    vFrameQueueGetStats(&ulQueued, &ulFull, &ulDepth);
+    vScalar(pxW, "view_renders_total", "counter", "Captures rendered for a view", ulRenders);
+    vScalar(pxW, "view_cache_hits_total", "counter", "Renders served from the render cache", ulHits);
+    vScalar(pxW, "frames_queued_total", "counter", "Frames committed to the frame queue", ulQueued);
+    vScalar(pxW, "frame_queue_full_total", "counter", "Frames not encoded because the frame queue was full", ulFull);
+    vScalar(pxW, "frame_queue_depth_max", "gauge", "Most frames queued at once", ulDepth);
+    vScalar(pxW, "frames_shared_total", "counter", "Client frames served by a frame encoded for another client",
+            ulDspFramesShared());
+}
+
+static void vWriteTx(MetricsWriter_t *pxW) {
+    uint32_t ulDirect, ulBuffered, ulUdp, ulUdpErr;
+    vWebsocketGetTxStats(&ulDirect, &ulBuffered);
+    vUdpStreamGetStats(&ulUdp, &ulUdpErr);
+    vFamily(pxW, "tx_bytes_total", "counter", "Frame bytes written to sockets");
+    vPrint(pxW, "picoscope_tx_bytes_total{path=\"direct\"} %lu\npicoscope_tx_bytes_total{path=\"buffered\"} %lu\n",
+           (unsigned long) ulDirect, (unsigned long) ulBuffered);
+    vScalar(pxW, "udp_datagrams_total", "counter", "Frames sent as UDP datagrams", ulUdp);
+    vScalar(pxW, "udp_errors_total", "counter", "UDP sends that failed", ulUdpErr);
+    vScalar(pxW, "ws_clients", "gauge", "Connected WebSocket viewers", (unsigned long) xWebsocketCount);
+}
+
+static void vWriteClients(MetricsWriter_t *pxW) {
+    static const struct { const char *pcName; const char *pcType; const char *pcHelp; } xClientFamilies[] = {
+        { "client_send_queue_bytes", "gauge", "Bytes waiting for the socket (send buffer and pending batch)" },
+        { "client_send_queue_max_bytes", "gauge", "Largest send queue seen when queueing a frame" },
+        { "client_frames_sent_total", "counter", "Frames delivered to the client" },
+        { "client_frames_dropped_total", "counter", "Captures skipped for the client" },
+        { "client_drain_latency_ms", "gauge", "Queue-to-drained time of the last backlog" },
+    };
+    for (size_t f = 0; f < sizeof(xClientFamilies) / sizeof(xClientFamilies[0]); f++) {
+        vFamily(pxW, xClientFamilies[f].pcName, xClientFamilies[f].pcType, xClientFamilies[f].pcHelp);
+        for (size_t i = 0; i < WS_MAX_CLIENTS; i++) {
+            const WsClient_t *pxClient = &xWebsocketClients[i];
+            if (pxClient->pxConn == NULL) continue;
+            const WsClientStats_t *pxStats = &pxClient->xStats;
+            uint32_t ulValue[] = {
+                (uint32_t) (pxClient->pxConn->send.len + pxClient->usBatchLen), pxStats->ulQueueMax,
+                pxStats->ulFramesSent, pxStats->ulFramesDropped, pxStats->ulLatencyLastMs,
+            };
+            vPrint(pxW, "picoscope_%s{slot=\"%u\"} %lu\n", xClientFamilies[f].pcName, (unsigned) i,
+                   (unsigned long) ulValue[f]);
+        }
+    }
+}
+
+static void vWriteHeap(MetricsWriter_t *pxW) {
+    vScalar(pxW, "heap_free_bytes", "gauge", "FreeRTOS heap free", (unsigned long) xPortGetFreeHeapSize());
+    vScalar(pxW, "heap_min_free_bytes", "gauge", "FreeRTOS heap minimum ever free",
+            (unsigned long) xPortGetMinimumEverFreeHeapSize());
+    vScalar(pxW, "log_dropped_total", "counter", "Log records dropped because the log ring was full", ulLogDropped());
+}
+
+static void vWritePool(MetricsWriter_t *pxW) {
+    static const char *const pcClasses[MG_POOL_CLASSES] = { "small", "conn", "io", "io2" };
+    MgPoolStats_t xPool;
+    vMgPoolGetStats(&xPool);
+    static const struct { const char *pcName; const char *pcType; const char *pcHelp; } xPoolFamilies[] = {
+        { "mg_pool_blocks", "gauge", "Blocks per Mongoose pool size class" },
+        { "mg_pool_in_use", "gauge", "Blocks in use" },
+        { "mg_pool_high_water", "gauge", "Most blocks in use at once" },
+        { "mg_pool_fallbacks_total", "counter", "Allocations served by the heap because the pool was empty" },
+    };
+    for (size_t f = 0; f < sizeof(xPoolFamilies) / sizeof(xPoolFamilies[0]); f++) {
+        vFamily(pxW, xPoolFamilies[f].pcName, xPoolFamilies[f].pcType, xPoolFamilies[f].pcHelp);
+        for (int i = 0; i < MG_POOL_CLASSES; i++) {
+            const MgPoolClassStats_t *pxC = &xPool.xClass[i];
+            uint32_t ulValue[] = { pxC->ulBlocks, pxC->ulInUse, pxC->ulHighWater, pxC->ulFallbacks };
+            vPrint(pxW, "picoscope_%s{class=\"%s\",size=\"%lu\"} %lu\n", xPoolFamilies[f].pcName, pcClasses[i],
+                   (unsigned long) pxC->ulBlockSize, (unsigned long) ulValue[f]);
+        }
+    }
+    vScalar(pxW, "mg_pool_heap_allocs_total", "counter", "Mongoose allocations served by the heap", xPool.ulHeapAllocs);
+    vScalar(pxW, "mg_pool_failures_total", "counter", "Mongoose allocations that failed", xPool.ulFailures);
+}
+
+static void vWriteTaskStacks(MetricsWriter_t *pxW) {
+    UBaseType_t uxCount = uxTaskGetSystemState(xTasks, METRICS_MAX_TASKS, NULL);
+    vFamily(pxW, "task_stack_high_water_bytes", "gauge", "Least free stack a task ever had");
+    for (UBaseType_t i = 0; i < uxCount; i++) {
+        vPrint(pxW, "picoscope_task_stack_high_water_bytes{task=\"%s\"} %lu\n", xTasks[i].pcTaskName,
+               (unsigned long) (xTasks[i].usStackHighWaterMark * sizeof(StackType_t)));
+    }
+}
+
+static void vWriteTaskRunTime(MetricsWriter_t *pxW) {
+    UBaseType_t uxCount = uxTaskGetSystemState(xTasks, METRICS_MAX_TASKS, NULL);
+    vFamily(pxW, "task_run_time_us_total", "counter", "Time a task has run (wraps at 2^32)");
+    for (UBaseType_t i = 0; i < uxCount; i++) {
+        vPrint(pxW, "picoscope_task_run_time_us_total{task=\"%s\"} %lu\n", xTasks[i].pcTaskName,
+               (unsigned long) xTasks[i].ulRunTimeCounter);
+    }
+}
+
+/* Body in order; each step is a few metric families, rendered in one go */
+static void (*const xSteps[])(MetricsWriter_t *pxW) = {
+    vWriteUptime, vWriteAdcBuffers, vWriteAdcRate, vWriteConsumers, vWriteLatency, vWriteStages, vWriteCpu,
+    vWriteFrames, vWriteTx, vWriteClients, vWriteHeap, vWritePool, vWriteTaskStacks, vWriteTaskRunTime,
+};
+
+#define METRICS_STEPS   (sizeof(xSteps) / sizeof(xSteps[0]))
+
+void vMetricsEndpointOnWrite(struct mg_connection *c) {
+    MetricsState_t *pxState = (MetricsState_t *) c->data;
+    if (pxState->ucMagic != METRICS_STATE_MAGIC) return;
+    static MetricsWriter_t xWriter;
+    xWriter.c = c;
+    xWriter.xLen = 0;
+    while (c->send.len < METRICS_SEND_LOW_WATER) {
+        if (pxState->ucStep >= METRICS_STEPS) {
+            mg_http_write_chunk(c, "", 0);      // Last chunk
+            memset(pxState, 0, sizeof(*pxState));
+            return;
+        }
+        xSteps[pxState->ucStep++](&xWriter);
+        vFlush(&xWriter);
+    }
+}
+
+bool bMetricsEndpointHandle(struct mg_connection *c, const char *pcUri, size_t xUriLen) {
+    if (xUriLen != 8 || memcmp(pcUri, "/metrics", 8) != 0) return false;
+
+    mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                 "Cache-Control: no-store\r\nTransfer-Encoding: chunked\r\n\r\n");
+    MetricsState_t *pxState = (MetricsState_t *) c->data;
+    pxState->ucMagic = METRICS_STATE_MAGIC;
+    pxState->ucStep = 0;
+    vMetricsEndpointOnWrite(c);
+    return true;
+}
+
+void vMetricsEndpointSendJson(struct mg_connection *c) {
+    char acResp[1024];
+    size_t n = 0;
+
+    MetricsLatency_t xLat;
+    vMetricsGetLatency(&xLat);
+    ScopeConsumerStats_t xInput = {0};
+    bDspGetInputStats(&xInput);
+    n += (size_t) snprintf(acResp + n, sizeof(acResp) - n,
+                           "{\"metrics\":{\"overruns\":%lu,\"publish_drops\":%lu,\"dsp_dropped\":%lu,"
+                           "\"latency_ms\":{\"count\":%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu},"
+                           "\"heap_free\":%lu,\"heap_min_free\":%lu,\"cpu_hz\":%lu,\"cycles\":{",
+                           (unsigned long) ulAdcDmaGetOverruns(), (unsigned long) ulScopeDataPublishDrops(),
+                           (unsigned long) xInput.ulDropped, (unsigned long) xLat.ulCount,
+                           (unsigned long) ulMetricsLatencyPercentile(&xLat, 50),
+                           (unsigned long) ulMetricsLatencyPercentile(&xLat, 90),
+                           (unsigned long) ulMetricsLatencyPercentile(&xLat, 99),
+                           (unsigned long) xPortGetFreeHeapSize(), (unsigned long) xPortGetMinimumEverFreeHeapSize(),
+                           (unsigned long) clock_get_hz(clk_sys));
+
+    // Per stage: average and longest run in cycles
+    for (int i = 0; i < METRICS_STAGE_COUNT && n < sizeof(acResp); i++) {
+        MetricsStageStats_t xStage;
+        vMetricsGetStage((MetricsStage_e) i, &xStage);
+        unsigned long ulAvg = xStage.ulRuns ? (unsigned long) (xStage.ullTotalCycles / xStage.ulRuns) : 0ul;
+        n += (size_t) snprintf(acResp + n, sizeof(acResp) - n, "%s\"%s\":[%lu,%lu]", i ? "," : "",
+                               pcMetricsStageName((MetricsStage_e) i), ulAvg, (unsigned long) xStage.ulMaxCycles);
+    }
+    if (n < sizeof(acResp)) n += (size_t) snprintf(acResp + n, sizeof(acResp) - n, "},\"queues\":[");
+    for (size_t i = 0; i < WS_MAX_CLIENTS && n < sizeof(acResp); i++) {
+        const WsClient_t *pxClient = &xWebsocketClients[i];
+        long lQueued = pxClient->pxConn ? (long) (pxClient->pxConn->send.len + pxClient->usBatchLen) : -1;
+        n += (size_t) snprintf(acResp + n, sizeof(acResp) - n, "%s%ld", i ? "," : "", lQueued);
+    }
+
+    // Least free stack per task, bytes
+    UBaseType_t uxCount = uxTaskGetSystemState(xTasks, METRICS_MAX_TASKS, NULL);
+    if (n < sizeof(acResp)) n += (size_t) snprintf(acResp + n, sizeof(acResp) - n, "],\"stack_free\":{");
+    for (UBaseType_t i = 0; i < uxCount && n < sizeof(acResp); i++) {
+        n += (size_t) snprintf(acResp + n, sizeof(acResp) - n, "%s\"%s\":%lu", i ? "," : "", xTasks[i].pcTaskName,
+                               (unsigned long) (xTasks[i].usStackHighWaterMark * sizeof(StackType_t)));
+    }
+    if (n < sizeof(acResp)) n += (size_t) snprintf(acResp + n, sizeof(acResp) - n, "}}}");
+    if (n >= sizeof(acResp)) n = sizeof(acResp) - 1;
+    mg_ws_send(c, acResp, n, WEBSOCKET_OP_TEXT);
+}
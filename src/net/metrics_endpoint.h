@@ -0,0 +1,52 @@
+#ifndef METRICS_ENDPOINT_H
+#define METRICS_ENDPOINT_H
+
+// Do NOT include mongoose.h here to avoid leaking lwIP macros like poll
+
+#include <stddef.h>
+#include <stdbool.h>
+
+struct mg_connection;
+
+/*
+ * Pipeline metrics: GET /metrics and the WebSocket "metrics" command
+ *
+ * /metrics answers in the Prometheus text format (version 0.0.4), all names
+ * prefixed picoscope_. The body is streamed from MG_EV_WRITE: whenever the
+ * send buffer is below METRICS_SEND_LOW_WATER the next few metric families are
+ * rendered and sent as chunks of at most METRICS_CHUNK_SIZE bytes, so a scrape
+ * stays within the mg_pool I/O blocks instead of growing one ~10 KB buffer:
+ *
+ *  - adc_buffer_{fills,overwritten,overruns}_total{buffer}, adc_stale_releases_total,
+ *    adc_sample_rate_hz{kind="target|measured"}
+ *  - publish_drops_total, consumer_{consumed,dropped}_total{consumer}
+ *  - capture_to_send_latency_ms histogram (capture completion to socket write)
+ *  - stage_cycles_total / stage_runs_total / stage_cycles_max{stage} (core/metrics.h),
+ *    cpu_hz, cpu_load_percent{core}, dsp_pass_us{kind="last|max"}
+ *  - frame queue, render cache and transmit counters
+ *  - client_send_queue_bytes{slot} (Mongoose send buffer + pending batch) and
+ *    the other per-client delivery counters of the "client_stats" command
+ *  - heap_free_bytes, heap_min_free_bytes, mg_pool_* per size class
+ *  - task_stack_high_water_bytes{task} (least free stack ever),
+ *    task_run_time_us_total{task}
+ *
+ * The "metrics" command replies with one JSON object summarising the same
+ * values (latency percentiles instead of the histogram).
+ *
+ * Network task only.
+ */
+
+#define METRICS_CHUNK_SIZE      512u
+#define METRICS_SEND_LOW_WATER  1024u
+#define METRICS_MAX_TASKS       16u     /* Tasks listed per request */
+
+/* Handle GET /metrics; false if uri is not /metrics */
+bool bMetricsEndpointHandle(struct mg_connection *c, const char *pcUri, size_t xUriLen);
+
+/* Continue a running /metrics response (MG_EV_WRITE) */
+void vMetricsEndpointOnWrite(struct mg_connection *c);
+
+/* Reply to the WebSocket "metrics" command */
+void vMetricsEndpointSendJson(struct mg_connection *c);
+
+#endif /* METRICS_ENDPOINT_H */
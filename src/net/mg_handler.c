@@ -1,34 +1,394 @@
 #include "mg_handler.h"
 #include "third_party/mongoose.h" 
 #include "core/command_handler.h"
+#include "core/command_queue.h"
+#include "core/dsp_task.h"
+#include "core/cpu_load.h"
 
 #include "pico/stdlib.h"
-#include "net/frontend.h"
+#include "net/web_assets.h"
+#include "net/udp_stream.h"
+#include "net/capture_download.h"
+#include "net/ws_command.h"
+#include "net/mg_pool.h"
+#include "net/metrics_endpoint.h"
+#include "core/metrics.h"
+#include "core/trace.h"
+#include "core/log.h"
+#include "net/trace_endpoint.h"
+#include "net/web_server.h"
 #include "FreeRTOS.h"
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 
 /* Define the global variables */
 struct mg_mgr xWebsocketManager;
-struct mg_connection *xWebsocketConnections[4];
+WsClient_t xWebsocketClients[WS_MAX_CLIENTS];
 size_t xWebsocketCount = 0;
 
+_Static_assert(WS_MAX_CLIENTS <= DSP_MAX_CLIENTS, "every WebSocket client needs a DSP slot");
+
+static inline uint8_t ucSlotOf(const WsClient_t *pxClient) {
+    return (uint8_t)(pxClient - xWebsocketClients);
+}
+
+/* Drop a batch without sending it (connection going away) */
+static void vWebsocketDiscardBatch(WsClient_t *pxClient) {
+    for (uint8_t i = 0; i < pxClient->ucBatchCount; i++) vFrameQueueRelease(pxClient->pxBatch[i]);
+    pxClient->ucBatchCount = 0;
+    pxClient->usBatchLen = 0;
+}
+
 static void vWebsocketAdd(struct mg_connection *c) {
-    if (xWebsocketCount < (sizeof xWebsocketConnections / sizeof xWebsocketConnections[0])) {
-        xWebsocketConnections[xWebsocketCount++] = c;
-        printf("WS client connected (%zu total)\n", xWebsocketCount);
+    for (size_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        WsClient_t *pxClient = &xWebsocketClients[i];
+        if (pxClient->pxConn != NULL) continue;
+        memset(pxClient, 0, sizeof(*pxClient));
+        pxClient->pxConn = c;
+        vCommandHandlerInitView(&pxClient->xView);
+        vDspClientOpen((uint8_t) i, &pxClient->xView);
+        xWebsocketCount++;
+        LOG(LOG_WS_CONNECTED, xWebsocketCount);
+        return;
     }
 }
 
 static void vWebsocketRemove(struct mg_connection *c) {
-    for (size_t i = 0; i < xWebsocketCount; i++) {
-        if (xWebsocketConnections[i] == c) {
-            for (size_t j = i + 1; j < xWebsocketCount; j++) xWebsocketConnections[j - 1] = xWebsocketConnections[j];
-            xWebsocketConnections[--xWebsocketCount] = NULL;
-            printf("WS client disconnected (%zu total)\n", xWebsocketCount);
+    WsClient_t *pxClient = pxWebsocketFind(c);
+    if (pxClient == NULL) return;
+    vDspClientClose(ucSlotOf(pxClient));
+    vUdpStreamUnsubscribe(ucSlotOf(pxClient));
+    vWebsocketDiscardBatch(pxClient);
+    memset(pxClient, 0, sizeof(*pxClient));
+    xWebsocketCount--;
+    LOG(LOG_WS_DISCONNECTED, xWebsocketCount);
+}
+
+WsClient_t *pxWebsocketFind(struct mg_connection *c) {
+    if (c == NULL) return NULL;
+    for (size_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (xWebsocketClients[i].pxConn == c) return &xWebsocketClients[i];
+    }
+    return NULL;
+}
+
+void vWebsocketUpdateCredits(void) {
+    for (size_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        WsClient_t *pxClient = &xWebsocketClients[i];
+        struct mg_connection *c = pxClient->pxConn;
+        if (c == NULL) continue;
+        // UDP subscribers have no send queue: every frame goes out, losses are the receiver's
+        bool bCanSend = c->is_websocket && !c->is_closing &&
+                        (bUdpStreamActive((uint8_t) i) || c->send.len + pxClient->usBatchLen < WS_SEND_QUEUE_LIMIT);
+        vDspClientSetCredit((uint8_t) i, bCanSend);
+        pxClient->xStats.ulFramesDropped = ulDspClientDropped((uint8_t) i);
+    }
+}
+
+/* Capture-to-send latency of a frame leaving now (FrameHeader_t.ulTimestampMs) */
+static void vRecordFrameLatency(const QueuedFrame_t *pxFrame, uint32_t ulNowMs) {
+    uint32_t ulCaptureMs;
+    memcpy(&ulCaptureMs, pxFrame->ucData + offsetof(FrameHeader_t, ulTimestampMs), sizeof(ulCaptureMs));
+    vMetricsRecordLatency(ulNowMs - ulCaptureMs);
+}
+
+static uint32_t ulTxDirectBytes = 0;
+static uint32_t ulTxBufferedBytes = 0;
+
+/* Server-to-client WebSocket header (FIN, unmasked) for a binary message */
+static size_t xWsBinaryHeader(uint8_t *pucHdr, size_t xLen) {
+    pucHdr[0] = 0x80u | WEBSOCKET_OP_BINARY;
+    if (xLen < 126u) {
+        pucHdr[1] = (uint8_t) xLen;
+        return 2;
+    }
+    pucHdr[1] = 126u;
+    pucHdr[2] = (uint8_t) (xLen >> 8);
+    pucHdr[3] = (uint8_t) xLen;
+    return 4;
+}
+
+/* Write one message made of ucCount frames. With nothing queued in Mongoose the
+ * header and frames go to the socket in one writev (lwIP copies them once into
+ * its pbufs); any part the socket does not take is appended to c->send so the
+ * byte order is kept.
+ */
+static void vWebsocketWriteMessage(WsClient_t *pxClient, QueuedFrame_t *const *ppxFrames, uint8_t ucCount,
+                                   size_t xLen, uint64_t ullNow) {
+    TRACE_BEGIN(TRACE_WS_SEND);
+    struct mg_connection *c = pxClient->pxConn;
+    uint8_t ucHdr[4];
+    struct iovec xIov[1 + WS_BATCH_FRAMES];
+    xIov[0].iov_base = ucHdr;
+    xIov[0].iov_len = xWsBinaryHeader(ucHdr, xLen);
+    for (uint8_t i = 0; i < ucCount; i++) {
+        xIov[1 + i].iov_base = ppxFrames[i]->ucData;
+        xIov[1 + i].iov_len = ppxFrames[i]->usLen;
+    }
+
+    size_t xTotal = xIov[0].iov_len + xLen;
+    size_t xDone = 0;
+    if (c->send.len == 0) {
+        long n = (long) lwip_writev((int) (size_t) c->fd, xIov, 1 + ucCount);
+        if (n > 0) xDone = (size_t) n;
+    }
+    uint32_t ulNowMs = to_ms_since_boot(get_absolute_time());
+    for (uint8_t i = 0; i < ucCount; i++) vRecordFrameLatency(ppxFrames[i], ulNowMs);
+    ulTxDirectBytes += (uint32_t) xDone;
+    ulTxBufferedBytes += (uint32_t) (xTotal - xDone);
+
+    size_t xSkip = xDone;
+    for (int i = 0; i < 1 + ucCount; i++) {
+        if (xSkip >= xIov[i].iov_len) {
+            xSkip -= xIov[i].iov_len;
+            continue;
+        }
+        mg_send(c, (const uint8_t *) xIov[i].iov_base + xSkip, xIov[i].iov_len - xSkip);
+        xSkip = 0;
+    }
+
+    pxClient->xStats.ulMessagesSent++;
+    pxClient->xStats.ulBytesSent += (uint32_t) xLen;
+    pxClient->ullLastMessageMs = ullNow;
+    TRACE_END(TRACE_WS_SEND);
+}
+
+static void vWebsocketFlushBatch(WsClient_t *pxClient, uint64_t ullNow) {
+    if (pxClient->ucBatchCount == 0) return;
+    vWebsocketWriteMessage(pxClient, pxClient->pxBatch, pxClient->ucBatchCount, pxClient->usBatchLen, ullNow);
+    for (uint8_t i = 0; i < pxClient->ucBatchCount; i++) vFrameQueueRelease(pxClient->pxBatch[i]);
+    pxClient->ucBatchCount = 0;
+    pxClient->usBatchLen = 0;
+    pxClient->ullBatchSinceMs = 0;
+}
+
+/* Frames are self-delimiting (ucHeaderLen + usPayloadLen), so a batch is
+ * just frames back to back in one binary message.
+ */
+void vWebsocketSendFrame(WsClient_t *pxClient, QueuedFrame_t *pxFrame) {
+    struct mg_connection *c = pxClient->pxConn;
+    if (bUdpStreamActive(ucSlotOf(pxClient))) {
+        if (bUdpStreamSend(ucSlotOf(pxClient), pxFrame->ucData, pxFrame->usLen)) {
+            vRecordFrameLatency(pxFrame, to_ms_since_boot(get_absolute_time()));
+            pxClient->xStats.ulFramesSent++;
+            pxClient->xStats.ulMessagesSent++;
+            pxClient->xStats.ulBytesSent += pxFrame->usLen;
+        }
+        return;
+    }
+    uint64_t ullNow = mg_millis();
+    size_t xLen = pxFrame->usLen;
+    size_t xQueued = c->send.len + pxClient->usBatchLen;
+    if (xQueued > pxClient->xStats.ulQueueMax) pxClient->xStats.ulQueueMax = (uint32_t) xQueued;
+    if (pxClient->ullPendingSinceMs == 0) pxClient->ullPendingSinceMs = ullNow;
+    pxClient->xStats.ulFramesSent++;
+
+    if (pxClient->usBatchLen + xLen > WS_BATCH_MAX || pxClient->ucBatchCount == WS_BATCH_FRAMES) {
+        vWebsocketFlushBatch(pxClient, ullNow);
+    }
+    if (xLen > WS_BATCH_MAX) {
+        vWebsocketWriteMessage(pxClient, &pxFrame, 1, xLen, ullNow);
+        return;
+    }
+    if (pxClient->ucBatchCount == 0) pxClient->ullBatchSinceMs = ullNow;
+    vFrameQueueRetain(pxFrame);
+    pxClient->pxBatch[pxClient->ucBatchCount++] = pxFrame;
+    pxClient->usBatchLen += (uint16_t) xLen;
+    pxClient->usBatchLastFrame = (uint16_t) xLen;
+}
+
+/* Backlog drained (socket took everything): close out the latency sample */
+static void vWebsocketNoteDrained(WsClient_t *pxClient) {
+    struct mg_connection *c = pxClient->pxConn;
+    if (pxClient->ullPendingSinceMs == 0 || c->send.len != 0 || pxClient->usBatchLen != 0) return;
+
+    uint32_t ulLatency = (uint32_t)(mg_millis() - pxClient->ullPendingSinceMs);
+    WsClientStats_t *pxStats = &pxClient->xStats;
+    pxStats->ulLatencyLastMs = ulLatency;
+    pxStats->ulLatencyAvgMs = pxStats->ulLatencyAvgMs ? (pxStats->ulLatencyAvgMs * 7u + ulLatency) / 8u : ulLatency;
+    if (ulLatency > pxStats->ulLatencyMaxMs) pxStats->ulLatencyMaxMs = ulLatency;
+    pxClient->ullPendingSinceMs = 0;
+}
+
+void vWebsocketFlushBatches(void) {
+    uint64_t ullNow = mg_millis();
+    for (size_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        WsClient_t *pxClient = &xWebsocketClients[i];
+        if (pxClient->pxConn == NULL || pxClient->usBatchLen == 0) continue;
+        bool bBusy = pxClient->pxConn->send.len > 0 ||
+                     (ullNow - pxClient->ullLastMessageMs) < WS_BATCH_BUSY_GAP_MS;
+        bool bFull = pxClient->usBatchLen + pxClient->usBatchLastFrame > WS_BATCH_MAX ||
+                     pxClient->ucBatchCount == WS_BATCH_FRAMES;
+        bool bDue = (ullNow - pxClient->ullBatchSinceMs) >= WS_BATCH_MAX_DELAY_MS;
+        if (!bBusy || bFull || bDue) {
+            vWebsocketFlushBatch(pxClient, ullNow);
+            vWebsocketNoteDrained(pxClient);
+        }
+    }
+}
+
+int iWebsocketBatchWaitMs(void) {
+    uint64_t ullNow = mg_millis();
+    int iWait = -1;
+    for (size_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        const WsClient_t *pxClient = &xWebsocketClients[i];
+        if (pxClient->pxConn == NULL || pxClient->usBatchLen == 0) continue;
+        uint64_t ullDue = pxClient->ullBatchSinceMs + WS_BATCH_MAX_DELAY_MS;
+        int iLeft = ullDue > ullNow ? (int) (ullDue - ullNow) : 0;
+        if (iWait < 0 || iLeft < iWait) iWait = iLeft;
+    }
+    return iWait;
+}
+
+void vWebsocketGetTxStats(uint32_t *pulDirect, uint32_t *pulBuffered) {
+    if (pulDirect) *pulDirect = ulTxDirectBytes;
+    if (pulBuffered) *pulBuffered = ulTxBufferedBytes;
+}
+
+static void vWebsocketOnWrite(struct mg_connection *c) {
+    WsClient_t *pxClient = pxWebsocketFind(c);
+    if (pxClient != NULL) vWebsocketNoteDrained(pxClient);
+}
+
+/* Longest client object below: 133 characters of keys, a comma, "false" and 12 10-digit numbers */
+#define WS_CLIENT_STATS_JSON_MAX    260
+/* Longest "],\"cpu\":[100,100]}" tail plus the terminator */
+#define WS_CLIENT_STATS_TAIL_MAX    24
+
+/* Reply with per-client delivery counters and per-core load as JSON.
+ * A client object that does not fit whole is left out, so the reply stays valid.
+ */
+static void vSendClientStats(struct mg_connection *c) {
+    char acResp[16 + WS_MAX_CLIENTS * WS_CLIENT_STATS_JSON_MAX + WS_CLIENT_STATS_TAIL_MAX];
+    const size_t xLimit = sizeof(acResp) - WS_CLIENT_STATS_TAIL_MAX;
+    size_t n = (size_t) snprintf(acResp, sizeof(acResp), "{\"clients\":[");
+    bool bFirst = true;
+    for (size_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        const WsClient_t *pxClient = &xWebsocketClients[i];
+        const WsClientStats_t *pxStats = &pxClient->xStats;
+        if (pxClient->pxConn == NULL) continue;
+        size_t xLen = (size_t) snprintf(acResp + n, xLimit - n,
+                               "%s{\"id\":%lu,\"self\":%s,\"sent\":%lu,\"msgs\":%lu,\"dropped\":%lu,\"bytes\":%lu,"
+                               "\"queued\":%lu,\"queue_max\":%lu,\"lat_ms\":%lu,\"lat_avg_ms\":%lu,\"lat_max_ms\":%lu,"
+                               "\"cmds\":%lu,\"coalesced\":%lu}",
+                               bFirst ? "" : ",", (unsigned long) pxClient->pxConn->id,
+                               pxClient->pxConn == c ? "true" : "false",
+                               (unsigned long) pxStats->ulFramesSent, (unsigned long) pxStats->ulMessagesSent,
+                               (unsigned long) pxStats->ulFramesDropped,
+                               (unsigned long) pxStats->ulBytesSent, (unsigned long) pxClient->pxConn->send.len,
+                               (unsigned long) pxStats->ulQueueMax, (unsigned long) pxStats->ulLatencyLastMs,
+                               (unsigned long) pxStats->ulLatencyAvgMs, (unsigned long) pxStats->ulLatencyMaxMs,
+                               (unsigned long) pxClient->xCommands.ulReceived,
+                               (unsigned long) pxClient->xCommands.ulCoalesced);
+        if (xLen >= xLimit - n) break;      /* Truncated: drop the partial object */
+        n += xLen;
+        bFirst = false;
+    }
+    n += (size_t) snprintf(acResp + n, sizeof(acResp) - n, "],\"cpu\":[%u,%u]}",
+                           ucCpuLoadGetPercent(0), ucCpuLoadGetPercent(1));
+    mg_ws_send(c, acResp, n, WEBSOCKET_OP_TEXT);
+}
+
+/* Command reply; ulApplied and ulVersion are 0 for replies that change no settings */
+static void vSendStatus(struct mg_connection *c, const ScopeStatus_t *pxStatus, uint32_t ulApplied, uint32_t ulVersion) {
+    char resp[160];
+    int n = snprintf(resp, sizeof(resp),
+                     "{\"success\":%s,\"msg\":\"%s\",\"applied\":%lu,\"version\":%lu}",
+                     pxStatus->bSuccess ? "true" : "false", pxStatus->acMessage,
+                     (unsigned long) ulApplied, (unsigned long) ulVersion);
+    mg_ws_send(c, resp, (size_t) n, WEBSOCKET_OP_TEXT);
+}
+
+void vWebsocketApplyCommands(void) {
+    ScopeStatus_t xStatus[WS_MAX_CLIENTS];
+    uint32_t ulApplied[WS_MAX_CLIENTS] = {0};
+
+    for (size_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        WsClient_t *pxClient = &xWebsocketClients[i];
+        if (pxClient->pxConn == NULL || bCommandQueueEmpty(&pxClient->xCommands)) continue;
+        ulApplied[i] = ulCommandQueueApply(&pxClient->xCommands, &pxClient->xView, &xStatus[i]);
+        if (bUdpStreamActive((uint8_t) i)) pxClient->xView.ucFrameFlags &= (uint8_t) ~FRAME_FLAG_INTER;
+        vDspClientSetView((uint8_t) i, &pxClient->xView);
+    }
+
+    // Acquisition changes of all clients and SCPI, then one view snapshot
+    bCommandHandlerCommit();
+    uint32_t ulVersion = ulDspPublishViews();
+
+    for (size_t i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (ulApplied[i] == 0) continue;
+        vSendStatus(xWebsocketClients[i].pxConn, &xStatus[i], ulApplied[i], ulVersion);
+    }
+}
+
+/* One decoded command: settings are queued, the rest is answered at once */
+static void vWebsocketCommand(struct mg_connection *c, const WsCommand_t *pxWs, bool bKnown) {
+    ScopeStatus_t xStatus = {0};
+    WsClient_t *pxClient = pxWebsocketFind(c);
+
+    if (!bKnown) {
+        /* vSendStatus() quotes acMessage: echo the name JSON-escaped, cut between whole escapes */
+        size_t n = (size_t) snprintf(xStatus.acMessage, sizeof(xStatus.acMessage), "Unknown command: ");
+        for (size_t i = 0; i < pxWs->xNameLen; i++) {
+            char ch = pxWs->pcName[i];
+            if ((unsigned char) ch < 0x20 || (unsigned char) ch > 0x7E) ch = '?';   // No \u escapes, no split UTF-8
+            char acEsc[3];
+            size_t xEsc = mg_snprintf(acEsc, sizeof(acEsc), "%M", mg_print_esc, 1, &ch);
+            if (xEsc >= sizeof(xStatus.acMessage) - n) break;
+            memcpy(xStatus.acMessage + n, acEsc, xEsc);
+            n += xEsc;
+        }
+        xStatus.acMessage[n] = '\0';
+        vSendStatus(c, &xStatus, 0, 0);
+        return;
+    }
+    if (pxWs->bScope) {
+        // Settings are answered once applied (vWebsocketApplyCommands)
+        if (pxClient != NULL) {
+            bCommandQueuePush(&pxClient->xCommands, &pxWs->xCmd);
+            return;
+        }
+        // No viewer slot: acts on the default view like SCPI
+        bCommandHandlerExecute(&pxWs->xCmd, NULL, &xStatus);
+        vSendStatus(c, &xStatus, 0, 0);
+        return;
+    }
+
+    double dValue = pxWs->dValue;
+    switch (pxWs->eOpcode) {
+        case WS_OP_CLIENT_STATS:
+            vSendClientStats(c);
+            return;
+        case WS_OP_METRICS:
+            vMetricsEndpointSendJson(c);
+            return;
+        case WS_OP_UDP_SUBSCRIBE: {
+            // Frames go to this peer's address on the given port (net/udp_stream.h)
+            uint32_t ulAddr = 0;
+            memcpy(&ulAddr, c->rem.ip, sizeof(ulAddr));
+            xStatus.bSuccess = pxClient != NULL && !c->rem.is_ip6 && dValue >= 1.0 && dValue <= 65535.0 &&
+                               bUdpStreamSubscribe(ucSlotOf(pxClient), ulAddr, (uint16_t) dValue);
+            if (xStatus.bSuccess) {
+                vWebsocketDiscardBatch(pxClient);
+                // Datagrams can be lost, so a UDP stream carries keyframes only
+                pxClient->xView.ucFrameFlags &= (uint8_t) ~FRAME_FLAG_INTER;
+                vDspClientSetView(ucSlotOf(pxClient), &pxClient->xView);
+                snprintf(xStatus.acMessage, sizeof(xStatus.acMessage), "UDP stream to port %u", (unsigned) dValue);
+            } else {
+                snprintf(xStatus.acMessage, sizeof(xStatus.acMessage), "UDP subscribe failed");
+            }
             break;
         }
+        case WS_OP_UDP_UNSUBSCRIBE:
+            if (pxClient) vUdpStreamUnsubscribe(ucSlotOf(pxClient));
+            xStatus.bSuccess = true;
+            snprintf(xStatus.acMessage, sizeof(xStatus.acMessage), "UDP stream stopped");
+            break;
+        default:
+            break;
     }
+    vSendStatus(c, &xStatus, 0, 0);
 }
 
 /* Compare request URI with a literal path */
@@ -44,12 +404,17 @@ void vEventHandler(struct mg_connection *c, int ev, void *ev_data, void *fn_data
     switch (ev) {
         case MG_EV_HTTP_MSG: {
             struct mg_http_message *hm = (struct mg_http_message *) ev_data;
-            /* Serve HTML page or upgrade to WebSocket */
-            if (bUriEquals(hm, "/")) {
-                extern const char frontend_index_html[];  // your HTML
-                mg_http_reply(c, 200, "Content-Type: text/html\r\n", "%s", frontend_index_html);
-            } else if (bUriEquals(hm, "/ws")) {
+            /* Upgrade to WebSocket, or serve an asset, capture download or metrics */
+            if (bUriEquals(hm, "/ws")) {
                 mg_ws_upgrade(c, hm, NULL);
+            } else if (bWebAssetServe(c, hm)) {
+                // Gzipped page/script/style from flash (net/web_assets.h)
+            } else if (bCaptureDownloadHandle(c, hm->uri.buf, hm->uri.len)) {
+                // Streamed from MG_EV_WRITE (net/capture_download.h)
+            } else if (bMetricsEndpointHandle(c, hm->uri.buf, hm->uri.len)) {
+                // Prometheus text format (net/metrics_endpoint.h)
+            } else if (bTraceEndpointHandle(c, hm->uri.buf, hm->uri.len)) {
+                // Chrome trace_event JSON, streamed from MG_EV_WRITE (net/trace_endpoint.h)
             } else {
                 mg_http_reply(c, 404, "", "Not found");
             }
@@ -58,6 +423,15 @@ void vEventHandler(struct mg_connection *c, int ev, void *ev_data, void *fn_data
         case MG_EV_WS_OPEN:
             vWebsocketAdd(c);
             break;
+        case MG_EV_WRITE:
+            if (c->is_websocket) vWebsocketOnWrite(c);
+            else {
+                vWebAssetOnWrite(c);
+                vCaptureDownloadOnWrite(c);
+                vTraceEndpointOnWrite(c);
+                vMetricsEndpointOnWrite(c);
+            }
+            break;
         case MG_EV_WS_MSG: {
             struct mg_ws_message *wm = (struct mg_ws_message *) ev_data;
             
@@ -67,72 +441,29 @@ void vEventHandler(struct mg_connection *c, int ev, void *ev_data, void *fn_data
                 break;
             }
             
-            // Parse JSON command
-            char json[256];
-            size_t n = wm->data.len < sizeof(json)-1 ? wm->data.len : sizeof(json)-1;
-            memcpy(json, wm->data.buf, n);
-            json[n] = '\0';
-            
-            // Example: {"cmd":"trigger_level","value":1.65}
-            char *cmd_str = mg_json_get_str(mg_str(json), "$.cmd");
-            if (cmd_str != NULL) {
-                double value = 0.0;
-                mg_json_get_num(mg_str(json), "$.value", &value);
-        
-                ScopeCommand_t xCmd = {0};
-                ScopeStatus_t xStatus = {0};
-        
-                // Map command string to CommandType_e and set value
-                if (strcmp(cmd_str, "trigger_level") == 0) {
-                    xCmd.eType = CMD_TRIGGER_LEVEL;
-                    xCmd.uValue.fTriggerLevel = (float)value;
-                    bCommandHandlerExecute(&xCmd, &xStatus);
-                } else if (strcmp(cmd_str, "trigger_mode") == 0) {
-                    xCmd.eType = CMD_TRIGGER_MODE;
-                    xCmd.uValue.eTriggerMode = (TriggerMode_e)((int)value);
-                    bCommandHandlerExecute(&xCmd, &xStatus);
-                } else if (strcmp(cmd_str, "trigger_edge") == 0) {
-                    xCmd.eType = CMD_TRIGGER_EDGE;
-                    xCmd.uValue.eTriggerEdge = (TriggerEdge_e)((int)value);
-                    bCommandHandlerExecute(&xCmd, &xStatus);
-                } else if (strcmp(cmd_str, "timebase_scale") == 0) {
-                    xCmd.eType = CMD_TIMEBASE_SCALE;
-                    xCmd.uValue.fTimePerDiv = (float)value;
-                    bCommandHandlerExecute(&xCmd, &xStatus);
-                } else if (strcmp(cmd_str, "run_stop") == 0) {
-                    xCmd.eType = CMD_RUN_STOP;
-                    xCmd.uValue.bRunning = ((int)value != 0);
-                    bCommandHandlerExecute(&xCmd, &xStatus);
-                } else {
-                    snprintf(xStatus.acMessage, sizeof(xStatus.acMessage), "Unknown command: %s", cmd_str);
-                    xStatus.bSuccess = false;
-                }
-        
-                // Send response
-                char resp[128];
-                snprintf(resp, sizeof(resp), 
-                         "{\"success\":%s,\"msg\":\"%s\"}", 
-                         xStatus.bSuccess ? "true" : "false",
-                         xStatus.acMessage);
-                mg_ws_send(c, resp, strlen(resp), WEBSOCKET_OP_TEXT);
-                
-                mg_free(cmd_str);  // Free with Mongoose allocator
-            }
+            // Decoded in place: no copy, no allocation (net/ws_command.h)
+            WsCommand_t xWs;
+            WsCommandResult_e eResult = (wm->flags & 0x0Fu) == WEBSOCKET_OP_BINARY
+                ? eWsCommandParseBinary((const uint8_t *) wm->data.buf, wm->data.len, &xWs)
+                : eWsCommandParseJson(wm->data.buf, wm->data.len, &xWs);
+            if (eResult == WS_CMD_OK || eResult == WS_CMD_UNKNOWN) vWebsocketCommand(c, &xWs, eResult == WS_CMD_OK);
             break;
         }
+        case MG_EV_WAKEUP:
+            vWebServerOnWakeup();
+            break;
         case MG_EV_CLOSE:
             if (c->is_websocket) vWebsocketRemove(c);
+            else {
+                vCaptureDownloadOnClose(c);
+                vTraceEndpointOnClose(c);
+            }
             break;
         default:
             break;
     }
 }
 
-/* Mongoose allocators (required) - choose C library or FreeRTOS heap */
-void *mg_calloc(size_t cnt, size_t size) {
-    size_t total = cnt * size;
-    void *ptr = pvPortMalloc(total);
-    if (ptr) memset(ptr, 0, total);
-    return ptr;
-}
-void mg_free(void *ptr) { vPortFree(ptr); }
\ No newline at end of file
+/* Mongoose allocators (required) - size-class pools over the FreeRTOS heap (net/mg_pool.h) */
+void *mg_calloc(size_t cnt, size_t size) { return pvMgPoolCalloc(cnt, size); }
+void mg_free(void *ptr) { vMgPoolFree(ptr); }
\ No newline at end of file
@@ -5,6 +5,12 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+
+#include "core/command_handler.h"
+#include "core/command_queue.h"
+#include "core/frame_queue.h"
+#include "frame_codec.h"
 
 #define DISPLAY_POINTS 256
 
@@ -12,23 +18,100 @@
 struct mg_mgr;
 struct mg_connection;
 
-/* Binary packet for WebSocket streaming; packed to avoid any padding bytes. */
-typedef struct __attribute__((packed)) {
-    uint32_t ulTimestampMs;      // 4 bytes, offset 0
-    uint32_t ulAgeMs;            // 4 bytes, offset 4
-    uint32_t ulSampleCount;      // 4 bytes, offset 8
-    uint32_t ulSampleRateHz;     // 4 bytes, offset 12  ← MISSING!
-    float vmin;                  // 4 bytes, offset 16
-    float vmax;                  // 4 bytes, offset 20
-    float vavg;                  // 4 bytes, offset 24
-    uint16_t usSamples[DISPLAY_POINTS];  // 512 bytes starting at offset 28
-} ScopePacket_t;
+/* Waveform frames are streamed in the v2 format from net/frame_codec.h */
+
+#define WS_MAX_CLIENTS 4         /* One DSP client slot each (core/dsp_task.h) */
+
+/* Flow control: the DSP task only encodes frames for a client while its
+ * connection's send buffer holds less than this many bytes; otherwise the
+ * capture is skipped for that client and the next one is the freshest frame.
+ */
+#define WS_SEND_QUEUE_LIMIT 1024u
+
+/* Frame batching: while a client's link is busy (Mongoose still holds unsent
+ * data, or the last message went out less than WS_BATCH_BUSY_GAP_MS ago),
+ * frames are packed back to back into one binary message of at most
+ * WS_BATCH_MAX bytes (one TCP segment incl. the 4-byte WebSocket header).
+ * A batch is sent once it cannot take another frame, the link is idle again,
+ * or its first frame waited WS_BATCH_MAX_DELAY_MS. On an idle link every
+ * frame goes out at the end of the drain pass that queued it.
+ */
+#define WS_BATCH_MAX            1456u
+#define WS_BATCH_FRAMES         4u
+#define WS_BATCH_BUSY_GAP_MS    16u
+#define WS_BATCH_MAX_DELAY_MS   20u
+
+/* Transmit path: a batch holds references to frame queue slots (no staging
+ * copy) and goes out as WebSocket header + frames in one gather write straight
+ * into the lwIP socket when Mongoose has nothing queued for the connection.
+ * Only what the socket does not take is copied into Mongoose's send buffer.
+ */
+
+/* Per-client delivery counters (exposed via the "client_stats" command) */
+typedef struct {
+    uint32_t ulFramesSent;
+    uint32_t ulMessagesSent;       // WebSocket messages carrying those frames (batching)
+    uint32_t ulFramesDropped;      // Skipped by the DSP task (send queue over the limit or frame queue full)
+    uint32_t ulBytesSent;
+    uint32_t ulQueueMax;           // Largest send buffer seen when queueing, bytes
+    uint32_t ulLatencyLastMs;      // Queue-to-drained time of the last backlog
+    uint32_t ulLatencyAvgMs;       // EWMA (1/8) of the above
+    uint32_t ulLatencyMaxMs;
+} WsClientStats_t;
+
+/* Per-client state owned by the network task. Slots are stable (pxConn NULL =
+ * free) and the index is the client's DSP slot; the DSP task keeps the
+ * inter-frame references.
+ */
+typedef struct {
+    struct mg_connection *pxConn;
+    ScopeViewConfig_t xView;                 // Trigger/timebase/points/format for this client
+    CommandQueue_t xCommands;                // Received settings, applied by vWebsocketApplyCommands()
+    uint64_t ullPendingSinceMs;              // First frame queued since the buffer was last empty (0 = idle)
+    uint64_t ullBatchSinceMs;                // First frame in pxBatch was queued
+    uint64_t ullLastMessageMs;               // Last binary message written
+    uint16_t usBatchLen;                     // Bytes in pxBatch
+    uint16_t usBatchLastFrame;               // Size of the last frame batched (room check)
+    uint8_t  ucBatchCount;
+    QueuedFrame_t *pxBatch[WS_BATCH_FRAMES]; // Retained frame queue slots
+    WsClientStats_t xStats;
+} WsClient_t;
 
 /* WebSocket connection tracking */
 extern struct mg_mgr xWebsocketManager;
-extern struct mg_connection *xWebsocketConnections[4];
+extern WsClient_t xWebsocketClients[WS_MAX_CLIENTS];
 extern size_t xWebsocketCount;
 
+/* Look up the client slot for a connection (NULL if not a tracked WebSocket) */
+WsClient_t *pxWebsocketFind(struct mg_connection *c);
+
+/* Tell the DSP task which clients have room in their send queue
+ * (WS_SEND_QUEUE_LIMIT) and refresh the drop counters.
+ */
+void vWebsocketUpdateCredits(void);
+
+/* Apply every client's queued commands (core/command_queue.h), commit the
+ * acquisition changes and publish the views to the DSP task as one snapshot.
+ * Each client that sent settings gets one reply with the last result, the
+ * number of commands applied and the snapshot version its frames will carry
+ * (FrameHeader_t.usConfigVersion). Call once per network loop pass.
+ */
+void vWebsocketApplyCommands(void);
+
+/* Queue one encoded frame to a client (batched, see WS_BATCH_MAX); retains it.
+ * Clients with a UDP stream (net/udp_stream.h) get it as a datagram instead.
+ */
+void vWebsocketSendFrame(WsClient_t *pxClient, QueuedFrame_t *pxFrame);
+
+/* Send the batches that are due; call after each drain pass */
+void vWebsocketFlushBatches(void);
+
+/* Milliseconds until the oldest pending batch is due, -1 if none */
+int iWebsocketBatchWaitMs(void);
+
+/* Frame bytes written straight to sockets vs. through Mongoose's send buffer */
+void vWebsocketGetTxStats(uint32_t *pulDirect, uint32_t *pulBuffered);
+
 /* Event handler function */
 void vEventHandler(struct mg_connection *c, int ev, void *ev_data, void *fn_data);
 
@@ -0,0 +1,122 @@
+#include "mg_pool.h"
+#include "third_party/mongoose.h"
+#undef poll
+
+#include "FreeRTOS.h"
+#include <string.h>
+#include <stdio.h>
+
+/* Free blocks are linked through their first word */
+typedef struct FreeBlock {
+    struct FreeBlock *pxNext;
+} FreeBlock_t;
+
+typedef struct {
+    uint8_t *pucArena;              // ulBlocks * ulBlockSize bytes, NULL if not carved
+    FreeBlock_t *pxFree;
+    MgPoolClassStats_t xStats;
+} PoolClass_t;
+
+#define MG_POOL_ALIGN(x)   (((x) + 7u) & ~7u)
+
+/* Ascending block sizes: a request takes the first class it fits */
+static PoolClass_t xClasses[MG_POOL_CLASSES] = {
+    { .xStats = { .ulBlockSize = MG_POOL_SMALL_SIZE,                            .ulBlocks = MG_POOL_SMALL_BLOCKS } },
+    { .xStats = { .ulBlockSize = MG_POOL_ALIGN(sizeof(struct mg_connection)),   .ulBlocks = MG_POOL_CONN_BLOCKS } },
+    { .xStats = { .ulBlockSize = MG_POOL_ALIGN(MG_IO_SIZE),                     .ulBlocks = MG_POOL_IO_BLOCKS } },
+    { .xStats = { .ulBlockSize = MG_POOL_ALIGN(2u * MG_IO_SIZE),                .ulBlocks = MG_POOL_IO2_BLOCKS } },
+};
+
+_Static_assert(MG_POOL_SMALL_SIZE < sizeof(struct mg_connection), "classes must be in ascending order");
+_Static_assert(sizeof(struct mg_connection) < MG_IO_SIZE, "classes must be in ascending order");
+
+static uint32_t ulHeapAllocs = 0;
+static uint32_t ulHeapInUse = 0;
+static uint32_t ulFailures = 0;
+
+bool bMgPoolInit(void) {
+    bool bAll = true;
+    for (uint32_t i = 0; i < MG_POOL_CLASSES; i++) {
+        PoolClass_t *pxClass = &xClasses[i];
+        if (pxClass->pucArena != NULL) continue;
+        uint32_t ulSize = pxClass->xStats.ulBlockSize;
+        pxClass->pucArena = (uint8_t *) pvPortMalloc((size_t) ulSize * pxClass->xStats.ulBlocks);
+        if (pxClass->pucArena == NULL) {
+            printf("mg_pool: no arena for %lu-byte blocks, using the heap\n", (unsigned long) ulSize);
+            bAll = false;
+            continue;
+        }
+        // Thread the free list in address order
+        for (uint32_t b = pxClass->xStats.ulBlocks; b-- > 0;) {
+            FreeBlock_t *pxBlock = (FreeBlock_t *) (pxClass->pucArena + (size_t) b * ulSize);
+            pxBlock->pxNext = pxClass->pxFree;
+            pxClass->pxFree = pxBlock;
+        }
+    }
+    return bAll;
+}
+
+static PoolClass_t *pxOwner(const void *pvPtr) {
+    for (uint32_t i = 0; i < MG_POOL_CLASSES; i++) {
+        const PoolClass_t *pxClass = &xClasses[i];
+        if (pxClass->pucArena == NULL) continue;
+        const uint8_t *pucEnd = pxClass->pucArena + (size_t) pxClass->xStats.ulBlockSize * pxClass->xStats.ulBlocks;
+        if ((const uint8_t *) pvPtr >= pxClass->pucArena && (const uint8_t *) pvPtr < pucEnd) return &xClasses[i];
+    }
+    return NULL;
+}
+
+void *pvMgPoolCalloc(size_t xCount, size_t xSize) {
+    if (xSize != 0 && xCount > SIZE_MAX / xSize) return NULL;
+    size_t xTotal = xCount * xSize;
+
+    for (uint32_t i = 0; i < MG_POOL_CLASSES; i++) {
+        PoolClass_t *pxClass = &xClasses[i];
+        if (xTotal > pxClass->xStats.ulBlockSize) continue;
+        FreeBlock_t *pxBlock = pxClass->pxFree;
+        if (pxBlock == NULL) {
+            pxClass->xStats.ulFallbacks++;
+            break;
+        }
+        pxClass->pxFree = pxBlock->pxNext;
+        pxClass->xStats.ulAllocs++;
+        if (++pxClass->xStats.ulInUse > pxClass->xStats.ulHighWater) pxClass->xStats.ulHighWater = pxClass->xStats.ulInUse;
+        memset(pxBlock, 0, xTotal);
+        return pxBlock;
+    }
+
+    void *pvPtr = pvPortMalloc(xTotal);
+    if (pvPtr == NULL) {
+        ulFailures++;
+        return NULL;
+    }
+    ulHeapAllocs++;
+    ulHeapInUse++;
+    memset(pvPtr, 0, xTotal);
+    return pvPtr;
+}
+
+void vMgPoolFree(void *pvPtr) {
+    if (pvPtr == NULL) return;
+    PoolClass_t *pxClass = pxOwner(pvPtr);
+    if (pxClass == NULL) {
+        vPortFree(pvPtr);
+        if (ulHeapInUse > 0) ulHeapInUse--;
+        return;
+    }
+    FreeBlock_t *pxBlock = (FreeBlock_t *) pvPtr;
+    pxBlock->pxNext = pxClass->pxFree;
+    pxClass->pxFree = pxBlock;
+    pxClass->xStats.ulInUse--;
+}
+
+void vMgPoolGetStats(MgPoolStats_t *pxStats) {
+    for (uint32_t i = 0; i < MG_POOL_CLASSES; i++) {
+        pxStats->xClass[i] = xClasses[i].xStats;
+        // A class without an arena has no blocks to offer
+        if (xClasses[i].pucArena == NULL) pxStats->xClass[i].ulBlocks = 0;
+    }
+    pxStats->ulHeapAllocs = ulHeapAllocs;
+    pxStats->ulHeapInUse = ulHeapInUse;
+    pxStats->ulFailures = ulFailures;
+}
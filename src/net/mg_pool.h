@@ -0,0 +1,63 @@
+#ifndef MG_POOL_H
+#define MG_POOL_H
+
+// Do NOT include mongoose.h here to avoid leaking lwIP macros like poll
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Fixed-size block pools behind mg_calloc()/mg_free()
+ *
+ * Mongoose allocates a handful of sizes over and over: connection structs,
+ * send/receive buffers in MG_IO_SIZE steps (mg_iobuf_resize allocates the new
+ * size before freeing the old one) and small strings and timers. Serving those
+ * from heap_4 churns its free list and fragments configTOTAL_HEAP_SIZE, so
+ * each size class gets a pool of equal blocks instead: allocation and free pop
+ * and push a free list, O(1) and without coalescing.
+ *
+ * The pool arenas are carved out of the FreeRTOS heap once by bMgPoolInit().
+ * A request goes to the smallest class it fits; if that pool is empty or the
+ * request is larger than every class it falls back to pvPortMalloc (counted).
+ *
+ * Used by the network task only (Mongoose's single thread); not thread safe.
+ */
+
+#define MG_POOL_CLASSES         4
+
+/* Blocks per class: small allocations, connections, one and two I/O buffers */
+#define MG_POOL_SMALL_SIZE      64u
+#define MG_POOL_SMALL_BLOCKS    24u
+#define MG_POOL_CONN_BLOCKS     12u     /* WS_MAX_CLIENTS + HTTP + SCPI + listeners + wake-up pair */
+#define MG_POOL_IO_BLOCKS       24u     /* MG_IO_SIZE: receive and send buffer of each connection */
+#define MG_POOL_IO2_BLOCKS      8u      /* 2 * MG_IO_SIZE: backlogged send buffers */
+
+typedef struct {
+    uint32_t ulBlockSize;
+    uint32_t ulBlocks;
+    uint32_t ulInUse;
+    uint32_t ulHighWater;           // Most blocks in use at once
+    uint32_t ulAllocs;              // Served from this pool
+    uint32_t ulFallbacks;           // Pool empty, served by the heap instead
+} MgPoolClassStats_t;
+
+typedef struct {
+    MgPoolClassStats_t xClass[MG_POOL_CLASSES];
+    uint32_t ulHeapAllocs;          // Served by the heap (fallbacks and larger requests)
+    uint32_t ulHeapInUse;
+    uint32_t ulFailures;            // Heap fallback failed as well (NULL returned)
+} MgPoolStats_t;
+
+/* Carve the pools out of the heap; before mg_mgr_init. A class whose arena
+ * could not be allocated is left empty and served by the heap.
+ */
+bool bMgPoolInit(void);
+
+/* calloc/free semantics (the memory is zeroed) */
+void *pvMgPoolCalloc(size_t xCount, size_t xSize);
+void vMgPoolFree(void *pvPtr);
+
+void vMgPoolGetStats(MgPoolStats_t *pxStats);
+
+#endif /* MG_POOL_H */
@@ -0,0 +1,497 @@
+#include "scpi_server.h"
+#include "core/command_handler.h"
+#include "core/scope_data.h"
+#include "core/trigger.h"
+#include "core/log.h"
+#include "drivers/adc_dma.h"
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "third_party/mongoose.h"
+#undef poll
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Per-connection state, kept in c->data */
+typedef struct {
+    uint16_t usPoints;              // 0 = full capture
+    uint8_t  bByteFormat;
+    int16_t  sError;                // Last error code, 0 = none
+} ScpiConn_t;
+
+_Static_assert(sizeof(ScpiConn_t) <= MG_DATA_SIZE, "SCPI state lives in mg_connection::data");
+
+typedef void (*ScpiHandler_t)(struct mg_connection *c, const char *pcArg, bool bQuery);
+
+typedef struct {
+    const char   *pcHeader;         // Long form; the upper-case part (+ digits) is the short form
+    ScpiHandler_t pxHandler;
+} ScpiCommand_t;
+
+/* One capture shared by all SCPI connections, pinned until a newer one exists */
+static int iConsumer = -1;
+static bool bHeld = false;
+static ScopeBuffer_t xHeld;
+static uint16_t usScratch[ADC_BUFFER_SIZE];
+
+static inline ScpiConn_t *pxConnState(struct mg_connection *c) {
+    return (ScpiConn_t *) c->data;
+}
+
+static void vSetError(struct mg_connection *c, int16_t sCode) {
+    pxConnState(c)->sError = sCode;
+}
+
+static void vReply(struct mg_connection *c, const char *pcFmt, ...) {
+    char acLine[96];
+    va_list ap;
+    va_start(ap, pcFmt);
+    int n = vsnprintf(acLine, sizeof(acLine) - 1, pcFmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if (n > (int) sizeof(acLine) - 2) n = (int) sizeof(acLine) - 2;
+    acLine[n++] = '\n';
+    mg_send(c, acLine, (size_t) n);
+}
+
+static bool bArgIs(const char *pcArg, const char *pcLong) {
+    size_t xShort = 0;
+    while (pcLong[xShort] && isupper((unsigned char) pcLong[xShort])) xShort++;
+    size_t xLen = strlen(pcArg);
+    return (xLen == xShort || xLen == strlen(pcLong)) && strncasecmp(pcArg, pcLong, xLen) == 0;
+}
+
+static bool bArgFloat(struct mg_connection *c, const char *pcArg, float *pfOut) {
+    char *pcEnd = NULL;
+    *pfOut = strtof(pcArg, &pcEnd);
+    if (pcEnd == pcArg || *pcEnd != '\0') {
+        vSetError(c, -224);         // Illegal parameter value
+        return false;
+    }
+    return true;
+}
+
+static void vExecute(struct mg_connection *c, const ScopeCommand_t *pxCmd) {
+    ScopeStatus_t xStatus;
+    if (!bCommandHandlerExecute(pxCmd, NULL, &xStatus)) vSetError(c, -222);   // Data out of range
+}
+
+static const TriggerConfig_t *pxTrigger(ScopeStatus_t *pxStatus) {
+    vCommandHandlerGetStatus(NULL, pxStatus);
+    return &pxStatus->xView.xTrigger;
+}
+
+/* ---- Capture access ------------------------------------------------------ */
+
+static const ScopeBuffer_t *pxCapture(void) {
+    if (iConsumer < 0) return NULL;
+    if (!bHeld || bScopeDataHasNew(iConsumer)) {
+        ScopeBuffer_t xNew;
+        if (bScopeDataAcquire(iConsumer, &xNew, SCOPE_READ_LATEST)) {
+            xHeld = xNew;
+            bHeld = true;
+        } else {
+            bHeld = false;          // Acquire released the old block
+        }
+    }
+    return bHeld ? &xHeld : NULL;
+}
+
+/* IEEE 488.2 definite-length block. With nothing queued on the connection the
+ * block header, data and terminator go to the socket in one writev; whatever
+ * the socket does not take is appended to c->send.
+ */
+static void vWriteBlock(struct mg_connection *c, const void *pvData, size_t xLen) {
+    char acHdr[16];
+    char acLen[12];
+    int iDigits = snprintf(acLen, sizeof(acLen), "%u", (unsigned) xLen);
+    int iHdr = snprintf(acHdr, sizeof(acHdr), "#%d%s", iDigits, acLen);
+    struct iovec xIov[3] = {
+        { .iov_base = acHdr, .iov_len = (size_t) iHdr },
+        { .iov_base = (void *) pvData, .iov_len = xLen },
+        { .iov_base = "\n", .iov_len = 1 },
+    };
+
+    size_t xDone = 0;
+    if (c->send.len == 0) {
+        long n = (long) lwip_writev((int) (size_t) c->fd, xIov, 3);
+        if (n > 0) xDone = (size_t) n;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (xDone >= xIov[i].iov_len) {
+            xDone -= xIov[i].iov_len;
+            continue;
+        }
+        mg_send(c, (const uint8_t *) xIov[i].iov_base + xDone, xIov[i].iov_len - xDone);
+        xDone = 0;
+    }
+}
+
+/* ---- Commands ------------------------------------------------------------ */
+
+static void vCmdIdn(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    (void) pcArg;
+    if (!bQuery) { vSetError(c, -113); return; }
+    vReply(c, "Picoscope,RP2350,0,1.0");
+}
+
+static void vCmdRst(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    (void) pcArg;
+    (void) bQuery;
+    memset(pxConnState(c), 0, sizeof(ScpiConn_t));
+}
+
+static void vCmdCls(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    (void) pcArg;
+    (void) bQuery;
+    vSetError(c, 0);
+}
+
+static void vCmdOpc(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    (void) pcArg;
+    if (bQuery) vReply(c, "1");     // Commands complete before the next line is read
+}
+
+static void vCmdError(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    (void) pcArg;
+    if (!bQuery) { vSetError(c, -113); return; }
+    static const struct { int16_t sCode; const char *pcText; } xErrors[] = {
+        {    0, "No error" },
+        { -100, "Command error" },
+        { -113, "Undefined header" },
+        { -222, "Data out of range" },
+        { -224, "Illegal parameter value" },
+        { -230, "Data corrupt or stale" },
+        { -363, "Input buffer overrun" },
+    };
+    int16_t sCode = pxConnState(c)->sError;
+    const char *pcText = "Error";
+    for (size_t i = 0; i < sizeof(xErrors) / sizeof(xErrors[0]); i++) {
+        if (xErrors[i].sCode == sCode) pcText = xErrors[i].pcText;
+    }
+    vReply(c, "%d,\"%s\"", sCode, pcText);
+    pxConnState(c)->sError = 0;
+}
+
+static void vSetRunning(struct mg_connection *c, bool bRunning) {
+    ScopeCommand_t xCmd = { .eType = CMD_RUN_STOP, .uValue.bRunning = bRunning };
+    vExecute(c, &xCmd);
+}
+
+static void vCmdRun(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    (void) pcArg;
+    if (bQuery) { vSetError(c, -113); return; }
+    vSetRunning(c, true);
+}
+
+static void vCmdStop(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    (void) pcArg;
+    if (bQuery) { vSetError(c, -113); return; }
+    vSetRunning(c, false);
+}
+
+static void vCmdAcqState(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    if (bQuery) {
+        vReply(c, "%d", bAdcDmaIsRunning() ? 1 : 0);
+    } else if (bArgIs(pcArg, "ON") || strcmp(pcArg, "1") == 0 || bArgIs(pcArg, "RUN")) {
+        vSetRunning(c, true);
+    } else if (bArgIs(pcArg, "OFF") || strcmp(pcArg, "0") == 0 || bArgIs(pcArg, "STOP")) {
+        vSetRunning(c, false);
+    } else {
+        vSetError(c, -224);
+    }
+}
+
+static void vCmdSampleRate(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    float fValue;
+    if (bQuery) {
+        ScopeStatus_t xStatus;
+        vCommandHandlerGetStatus(NULL, &xStatus);
+        vReply(c, "%lu", (unsigned long) xStatus.ulSampleRate);
+    } else if (bArgFloat(c, pcArg, &fValue)) {
+        if (fValue < 1000.0f || fValue > 500000.0f) { vSetError(c, -222); return; }
+        ScopeCommand_t xCmd = { .eType = CMD_SAMPLE_RATE, .uValue.ulSampleRate = (uint32_t) fValue };
+        vExecute(c, &xCmd);
+    }
+}
+
+static void vCmdTimebase(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    float fValue;
+    if (bQuery) {
+        ScopeStatus_t xStatus;
+        vReply(c, "%g", (double) (pxTrigger(&xStatus)->fTimePerDivMs / 1000.0f));
+    } else if (bArgFloat(c, pcArg, &fValue)) {
+        if (fValue <= 0.0f) { vSetError(c, -222); return; }
+        ScopeCommand_t xCmd = { .eType = CMD_TIMEBASE_SCALE, .uValue.fTimePerDiv = fValue };
+        vExecute(c, &xCmd);
+    }
+}
+
+static void vCmdTrigLevel(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    float fValue;
+    if (bQuery) {
+        ScopeStatus_t xStatus;
+        vReply(c, "%.3f", (double) (pxTrigger(&xStatus)->uLevelCounts * 3.3f / 4095.0f));
+    } else if (bArgFloat(c, pcArg, &fValue)) {
+        ScopeCommand_t xCmd = { .eType = CMD_TRIGGER_LEVEL, .uValue.fTriggerLevel = fValue };
+        vExecute(c, &xCmd);
+    }
+}
+
+static void vCmdTrigMode(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    static const char *const pcModes[] = { "AUTO", "NORM", "NONE" };
+    ScopeCommand_t xCmd = { .eType = CMD_TRIGGER_MODE };
+    if (bQuery) {
+        ScopeStatus_t xStatus;
+        TriggerMode_e eMode = pxTrigger(&xStatus)->eMode;
+        vReply(c, "%s", (unsigned) eMode < 3u ? pcModes[eMode] : "AUTO");
+        return;
+    }
+    if (bArgIs(pcArg, "AUTO")) xCmd.uValue.eTriggerMode = TRIG_MODE_AUTO;
+    else if (bArgIs(pcArg, "NORMal")) xCmd.uValue.eTriggerMode = TRIG_MODE_NORMAL;
+    else if (bArgIs(pcArg, "NONE")) xCmd.uValue.eTriggerMode = TRIG_MODE_NONE;
+    else { vSetError(c, -224); return; }
+    vExecute(c, &xCmd);
+}
+
+static void vCmdTrigSlope(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    ScopeCommand_t xCmd = { .eType = CMD_TRIGGER_EDGE };
+    if (bQuery) {
+        ScopeStatus_t xStatus;
+        vReply(c, "%s", pxTrigger(&xStatus)->eEdge == TRIG_EDGE_FALLING ? "NEG" : "POS");
+        return;
+    }
+    if (bArgIs(pcArg, "POSitive") || bArgIs(pcArg, "RISing")) xCmd.uValue.eTriggerEdge = TRIG_EDGE_RISING;
+    else if (bArgIs(pcArg, "NEGative") || bArgIs(pcArg, "FALLing")) xCmd.uValue.eTriggerEdge = TRIG_EDGE_FALLING;
+    else { vSetError(c, -224); return; }
+    vExecute(c, &xCmd);
+}
+
+static void vCmdChanScale(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    float fValue;
+    if (bQuery) {
+        ScopeStatus_t xStatus;
+        vCommandHandlerGetStatus(NULL, &xStatus);
+        vReply(c, "%g", (double) xStatus.xView.fVoltsPerDiv);
+    } else if (bArgFloat(c, pcArg, &fValue)) {
+        ScopeCommand_t xCmd = { .eType = CMD_VERTICAL_SCALE, .uValue.fVoltsPerDiv = fValue };
+        vExecute(c, &xCmd);
+    }
+}
+
+static void vCmdChanOffset(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    float fValue;
+    if (bQuery) {
+        ScopeStatus_t xStatus;
+        vCommandHandlerGetStatus(NULL, &xStatus);
+        vReply(c, "%g", (double) xStatus.xView.fVerticalOffset);
+    } else if (bArgFloat(c, pcArg, &fValue)) {
+        ScopeCommand_t xCmd = { .eType = CMD_VERTICAL_OFFSET, .uValue.fVerticalOffset = fValue };
+        vExecute(c, &xCmd);
+    }
+}
+
+static void vCmdWavFormat(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    ScpiConn_t *pxState = pxConnState(c);
+    if (bQuery) vReply(c, "%s", pxState->bByteFormat ? "BYTE" : "WORD");
+    else if (bArgIs(pcArg, "WORD")) pxState->bByteFormat = 0;
+    else if (bArgIs(pcArg, "BYTE")) pxState->bByteFormat = 1;
+    else vSetError(c, -224);
+}
+
+static void vCmdWavPoints(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    ScpiConn_t *pxState = pxConnState(c);
+    float fValue;
+    if (bQuery) {
+        vReply(c, "%u", pxState->usPoints ? pxState->usPoints : ADC_BUFFER_SIZE);
+    } else if (bArgIs(pcArg, "MAXimum")) {
+        pxState->usPoints = 0;
+    } else if (bArgFloat(c, pcArg, &fValue)) {
+        if (fValue < 1.0f || fValue > (float) ADC_BUFFER_SIZE) { vSetError(c, -222); return; }
+        pxState->usPoints = ((uint32_t) fValue >= ADC_BUFFER_SIZE) ? 0 : (uint16_t) fValue;
+    }
+}
+
+static void vCmdWavPreamble(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    (void) pcArg;
+    if (!bQuery) { vSetError(c, -113); return; }
+    const ScpiConn_t *pxState = pxConnState(c);
+    const ScopeBuffer_t *pxBuf = pxCapture();
+    ScopeStatus_t xStatus;
+    vCommandHandlerGetStatus(NULL, &xStatus);
+    uint32_t ulPoints = pxState->usPoints ? pxState->usPoints : ADC_BUFFER_SIZE;
+    double dXInc = (double) ADC_BUFFER_SIZE / ((double) ulPoints * (double) (xStatus.ulSampleRate ? xStatus.ulSampleRate : 1u));
+    double dYInc = pxState->bByteFormat ? 3.3 / 255.0 : 3.3 / 4095.0;
+    vReply(c, "%d,%lu,%.9g,%.9g,%lu,%lu", pxState->bByteFormat ? 0 : 1, (unsigned long) ulPoints, dXInc, dYInc,
+           (unsigned long) (pxBuf ? pxBuf->ulSequence : 0), (unsigned long) (pxBuf ? pxBuf->ulTimestamp : 0));
+}
+
+static void vCmdWavData(struct mg_connection *c, const char *pcArg, bool bQuery) {
+    (void) pcArg;
+    if (!bQuery) { vSetError(c, -113); return; }
+    const ScpiConn_t *pxState = pxConnState(c);
+    const ScopeBuffer_t *pxBuf = pxCapture();
+    if (pxBuf == NULL) {
+        vSetError(c, -230);
+        vWriteBlock(c, NULL, 0);
+        return;
+    }
+
+    // Full WORD capture: straight from the pinned DMA buffer
+    const uint16_t *pusSrc = pxBuf->pusSamples;
+    uint32_t ulPoints = ADC_BUFFER_SIZE;
+    if (pxState->usPoints) {
+        ulPoints = pxState->usPoints;
+        vTriggerDecimateLinear(pxBuf->pusSamples, ADC_BUFFER_SIZE, 0, ADC_BUFFER_SIZE, usScratch, ulPoints);
+        pusSrc = usScratch;
+    }
+    if (!pxState->bByteFormat) {
+        vWriteBlock(c, pusSrc, ulPoints * sizeof(uint16_t));
+        return;
+    }
+    uint8_t *pucOut = (uint8_t *) usScratch;   // Narrowing in place is safe: byte i is written after sample i is read
+    for (uint32_t i = 0; i < ulPoints; i++) pucOut[i] = (uint8_t) ((pusSrc[i] & 0x0FFFu) >> 4);
+    vWriteBlock(c, pucOut, ulPoints);
+}
+
+static const ScpiCommand_t xCommands[] = {
+    { "*IDN",               vCmdIdn },
+    { "*RST",               vCmdRst },
+    { "*CLS",               vCmdCls },
+    { "*OPC",               vCmdOpc },
+    { "SYSTem:ERRor",       vCmdError },
+    { "RUN",                vCmdRun },
+    { "STOP",               vCmdStop },
+    { "ACQuire:STATe",      vCmdAcqState },
+    { "ACQuire:SRATe",      vCmdSampleRate },
+    { "TIMebase:SCALe",     vCmdTimebase },
+    { "TRIGger:LEVel",      vCmdTrigLevel },
+    { "TRIGger:MODE",       vCmdTrigMode },
+    { "TRIGger:SLOPe",      vCmdTrigSlope },
+    { "CHANnel1:SCALe",     vCmdChanScale },
+    { "CHANnel1:OFFSet",    vCmdChanOffset },
+    { "WAVeform:FORMat",    vCmdWavFormat },
+    { "WAVeform:POINts",    vCmdWavPoints },
+    { "WAVeform:PREamble",  vCmdWavPreamble },
+    { "WAVeform:DATA",      vCmdWavData },
+    { "CURVe",              vCmdWavData },
+};
+
+/* ---- Parser -------------------------------------------------------------- */
+
+/* One header node (pcNode, xLen) against one pattern node (pcPat, xPatLen):
+ * the whole long form, or its upper-case/'*' prefix plus any trailing digits.
+ */
+static bool bNodeMatches(const char *pcNode, size_t xLen, const char *pcPat, size_t xPatLen) {
+    if (xLen == xPatLen && strncasecmp(pcNode, pcPat, xLen) == 0) return true;
+    size_t xShort = 0;
+    while (xShort < xPatLen && (isupper((unsigned char) pcPat[xShort]) || pcPat[xShort] == '*')) xShort++;
+    size_t xDigits = xPatLen;
+    while (xDigits > xShort && isdigit((unsigned char) pcPat[xDigits - 1])) xDigits--;
+    size_t xSuffix = xPatLen - xDigits;
+    // A numeric suffix of 1 may be left out (CHAN:SCAL = CHAN1:SCAL)
+    if (xSuffix == 1 && pcPat[xDigits] == '1' && (xLen == xShort || xLen == xDigits) &&
+        strncasecmp(pcNode, pcPat, xLen) == 0) return true;
+    return xLen == xShort + xSuffix && strncasecmp(pcNode, pcPat, xShort) == 0 &&
+           strncmp(pcNode + xShort, pcPat + xDigits, xSuffix) == 0;
+}
+
+static bool bHeaderMatches(const char *pcHeader, const char *pcPattern) {
+    for (;;) {
+        const char *pcSep = strchr(pcHeader, ':');
+        const char *pcPatSep = strchr(pcPattern, ':');
+        size_t xLen = pcSep ? (size_t) (pcSep - pcHeader) : strlen(pcHeader);
+        size_t xPatLen = pcPatSep ? (size_t) (pcPatSep - pcPattern) : strlen(pcPattern);
+        if (!bNodeMatches(pcHeader, xLen, pcPattern, xPatLen)) return false;
+        if (!pcSep || !pcPatSep) return !pcSep && !pcPatSep;
+        pcHeader = pcSep + 1;
+        pcPattern = pcPatSep + 1;
+    }
+}
+
+/* One command of a line: "<header>[?] [argument]" (modified in place) */
+static void vScpiDispatch(struct mg_connection *c, char *pcCmd) {
+    while (isspace((unsigned char) *pcCmd)) pcCmd++;
+    if (*pcCmd == ':') pcCmd++;
+    if (*pcCmd == '\0') return;
+
+    char *pcArg = pcCmd;
+    while (*pcArg && !isspace((unsigned char) *pcArg)) pcArg++;
+    if (*pcArg) *pcArg++ = '\0';
+    while (isspace((unsigned char) *pcArg)) pcArg++;
+    char *pcEnd = pcArg + strlen(pcArg);
+    while (pcEnd > pcArg && isspace((unsigned char) pcEnd[-1])) *--pcEnd = '\0';
+
+    size_t xLen = strlen(pcCmd);
+    bool bQuery = xLen > 0 && pcCmd[xLen - 1] == '?';
+    if (bQuery) pcCmd[xLen - 1] = '\0';
+
+    for (size_t i = 0; i < sizeof(xCommands) / sizeof(xCommands[0]); i++) {
+        if (bHeaderMatches(pcCmd, xCommands[i].pcHeader)) {
+            xCommands[i].pxHandler(c, pcArg, bQuery);
+            return;
+        }
+    }
+    vSetError(c, -113);
+}
+
+static void vScpiOnRead(struct mg_connection *c) {
+    for (;;) {
+        char *pcNl = memchr(c->recv.buf, '\n', c->recv.len);
+        if (pcNl == NULL) {
+            if (c->recv.len >= SCPI_MAX_LINE) {
+                vSetError(c, -363);
+                c->recv.len = 0;
+            }
+            return;
+        }
+        size_t xLen = (size_t) (pcNl - (char *) c->recv.buf);
+        char acLine[SCPI_MAX_LINE];
+        if (xLen < sizeof(acLine)) {
+            memcpy(acLine, c->recv.buf, xLen);
+            if (xLen > 0 && acLine[xLen - 1] == '\r') xLen--;
+            acLine[xLen] = '\0';
+            for (char *pcCmd = acLine; pcCmd != NULL;) {
+                char *pcNext = strchr(pcCmd, ';');
+                if (pcNext) *pcNext++ = '\0';
+                vScpiDispatch(c, pcCmd);
+                pcCmd = pcNext;
+            }
+        } else {
+            vSetError(c, -363);
+        }
+        mg_iobuf_del(&c->recv, 0, (size_t) (pcNl - (char *) c->recv.buf) + 1);
+    }
+}
+
+static void vScpiEventHandler(struct mg_connection *c, int ev, void *ev_data) {
+    (void) ev_data;
+    switch (ev) {
+        case MG_EV_ACCEPT:
+            memset(pxConnState(c), 0, sizeof(ScpiConn_t));
+            LOG(LOG_SCPI_CONNECTED, c->rem.ip[0], c->rem.ip[1], c->rem.ip[2], c->rem.ip[3]);
+            break;
+        case MG_EV_READ:
+            vScpiOnRead(c);
+            break;
+        case MG_EV_CLOSE:
+            if (!c->is_listening) LOG(LOG_SCPI_DISCONNECTED, c->rem.ip[0], c->rem.ip[1], c->rem.ip[2], c->rem.ip[3]);
+            break;
+        default:
+            break;
+    }
+}
+
+bool bScpiServerInit(struct mg_mgr *pxMgr) {
+    if (iConsumer < 0) iConsumer = iScopeDataRegisterConsumer("scpi", NULL);
+    if (iConsumer < 0) printf("SCPI: no scope_data consumer slot, waveform queries disabled\n");
+    char acUrl[32];
+    snprintf(acUrl, sizeof(acUrl), "tcp://0.0.0.0:%u", SCPI_PORT);
+    return mg_listen(pxMgr, acUrl, vScpiEventHandler, NULL) != NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef SCPI_SERVER_H
+#define SCPI_SERVER_H
+
+// Do NOT include mongoose.h here to avoid leaking lwIP macros like poll
+
+#include <stdbool.h>
+
+struct mg_mgr;
+
+/*
+ * SCPI-style instrument server (raw TCP, SCPI_PORT)
+ *
+ * Newline-terminated commands, several per line separated by ';'. Headers are
+ * case-insensitive, in short (TRIG:LEV) or long (TRIGGER:LEVEL) form, with an
+ * optional leading ':'. Queries end in '?' and are answered with one line.
+ * Settings go through bCommandHandlerExecute(): view settings apply to the
+ * default view, acquisition settings are global.
+ *
+ *   *IDN?  *RST  *CLS  *OPC?  SYSTem:ERRor?
+ *   RUN  STOP  ACQuire:STATe {0|1}[?]  ACQuire:SRATe <Hz>[?]
+ *   TIMebase:SCALe <s/div>[?]
+ *   TRIGger:LEVel <V>[?]  TRIGger:MODE {AUTO|NORMal|NONE}[?]  TRIGger:SLOPe {POSitive|NEGative}[?]
+ *   CHANnel1:SCALe <V/div>[?]  CHANnel1:OFFSet <V>[?]
+ *   WAVeform:FORMat {WORD|BYTE}[?]  WAVeform:POINts {<n>|MAXimum}[?]
+ *   WAVeform:PREamble?  WAVeform:DATA?  CURVe?
+ *
+ * WAVeform:DATA? / CURVe? return the newest capture as an IEEE 488.2
+ * definite-length block "#<digits><length><data>\n". WORD is the raw 12-bit
+ * ADC count per sample as uint16 little endian, BYTE the top 8 bits. With
+ * POINts below the capture length the capture is resampled to that many
+ * points; at MAXimum (default) WORD data is sent straight from the pinned
+ * capture buffer without a copy. While stopped, the last capture is returned.
+ *
+ * WAVeform:PREamble? answers
+ *   <format 0=BYTE 1=WORD>,<points>,<x increment s>,<y increment V>,<sequence>,<timestamp ms>
+ * (volts = code * y increment).
+ *
+ * Errors are queued as the last one only and read with SYSTem:ERRor?.
+ */
+
+#define SCPI_PORT           5025
+#define SCPI_MAX_LINE       256         /* Longer lines are discarded */
+
+/* Start listening on SCPI_PORT (call with the lwIP lock held, like mg_http_listen) */
+bool bScpiServerInit(struct mg_mgr *pxMgr);
+
+#endif /* SCPI_SERVER_H */
@@ -0,0 +1,166 @@
+#include "trace_endpoint.h"
+#include "core/trace.h"
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "pico/cyw43_arch.h"
+
+#include "third_party/mongoose.h"
+#undef poll
+
+#include <stdio.h>
+#include <string.h>
+
+#if PICOSCOPE_TRACE
+
+/* Marks the connection running the transfer (c->data) */
+#define TRACE_STATE_MAGIC 0x7Eu
+
+/* Transfer state; one transfer at a time, so it is kept here */
+static struct {
+    bool     bActive;
+    uint8_t  ucCore;             // Ring being sent, TRACE_CORES when done
+    uint32_t ulNext;             // Next event (head count) of that ring
+    uint32_t ulEnd;              // Head of that ring at pause
+    uint32_t ulAnchorCycles;     // Anchor in use for that ring
+    uint64_t ullAnchorUs;
+    double   dCyclesPerUs;
+} xDl;
+
+static bool bIsTrace(struct mg_connection *c) {
+    return (uint8_t) c->data[0] == TRACE_STATE_MAGIC;
+}
+
+static uint32_t ulOldest(uint8_t ucCore) {
+    uint32_t ulHead = ulTraceHead[ucCore];
+    return ulHead > TRACE_RING_EVENTS ? ulHead - TRACE_RING_EVENTS : 0u;
+}
+
+static const TraceEvent_t *pxEventAt(uint8_t ucCore, uint32_t ulIndex) {
+    return &xTraceRing[ucCore][ulIndex & (TRACE_RING_EVENTS - 1u)];
+}
+
+/* Anchor microseconds are 32 bit; take the 64-bit value closest to now */
+static uint64_t ullExtendUs(uint32_t ulUs) {
+    uint64_t ullNow = time_us_64();
+    return ullNow - (uint32_t) ((uint32_t) ullNow - ulUs);
+}
+
+/* Start on a ring: spans before its first anchor are placed with that anchor,
+ * or with the newest one if the ring has none left
+ */
+static void vStartCore(uint8_t ucCore) {
+    xDl.ucCore = ucCore;
+    if (ucCore >= TRACE_CORES) return;
+    xDl.ulNext = ulOldest(ucCore);
+    xDl.ulEnd = ulTraceHead[ucCore];
+    for (uint32_t i = xDl.ulNext; i != xDl.ulEnd; i++) {
+        const TraceEvent_t *pxEvent = pxEventAt(ucCore, i);
+        if (pxEvent->ulId != TRACE_SYNC_ANCHOR) continue;
+        xDl.ulAnchorCycles = pxEvent->ulStart;
+        xDl.ullAnchorUs = ullExtendUs(pxEvent->ulCycles);
+        return;
+    }
+    const TraceEvent_t *pxLast = &xTraceLastAnchor[ucCore];
+    xDl.ulAnchorCycles = pxLast->ulStart;
+    xDl.ullAnchorUs = ullExtendUs(pxLast->ulCycles);
+}
+
+static void vFinish(struct mg_connection *c) {
+    memset(c->data, 0, sizeof(c->data));
+    xDl.bActive = false;
+    bTracePaused = false;
+}
+
+/* Next piece of the body, at most TRACE_CHUNK_SIZE bytes; 0 when done */
+static size_t xFillChunk(char *pcOut) {
+    size_t n = 0;
+    char acEvent[128];
+    while (xDl.ucCore < TRACE_CORES) {
+        if (xDl.ulNext == xDl.ulEnd) {
+            vStartCore((uint8_t) (xDl.ucCore + 1u));
+            continue;
+        }
+        const TraceEvent_t *pxEvent = pxEventAt(xDl.ucCore, xDl.ulNext);
+        if (pxEvent->ulId == TRACE_SYNC_ANCHOR) {
+            xDl.ulAnchorCycles = pxEvent->ulStart;
+            xDl.ullAnchorUs = ullExtendUs(pxEvent->ulCycles);
+            xDl.ulNext++;
+            continue;
+        }
+        double dTs = (double) xDl.ullAnchorUs +
+                     (double) (int32_t) (pxEvent->ulStart - xDl.ulAnchorCycles) / xDl.dCyclesPerUs;
+        int iLen = snprintf(acEvent, sizeof(acEvent),
+                            ",{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}\n",
+                            pcTraceName((TraceId_e) pxEvent->ulId), (unsigned) xDl.ucCore,
+                            dTs, (double) pxEvent->ulCycles / xDl.dCyclesPerUs);
+        if (iLen <= 0 || n + (size_t) iLen > TRACE_CHUNK_SIZE) return n;
+        memcpy(pcOut + n, acEvent, (size_t) iLen);
+        n += (size_t) iLen;
+        xDl.ulNext++;
+    }
+    return n;
+}
+
+void vTraceEndpointOnWrite(struct mg_connection *c) {
+    if (!bIsTrace(c)) return;
+    char acChunk[TRACE_CHUNK_SIZE];
+    while (c->send.len < TRACE_SEND_LOW_WATER) {
+        size_t n = xFillChunk(acChunk);
+        if (n == 0) {
+            static const char acTail[] = "],\"displayTimeUnit\":\"ns\"}\n";
+            mg_http_write_chunk(c, acTail, sizeof(acTail) - 1u);
+            mg_http_write_chunk(c, "", 0);      // Last chunk
+            vFinish(c);
+            return;
+        }
+        mg_http_write_chunk(c, acChunk, n);
+    }
+}
+
+void vTraceEndpointOnClose(struct mg_connection *c) {
+    if (bIsTrace(c)) vFinish(c);
+}
+
+bool bTraceEndpointHandle(struct mg_connection *c, const char *pcUri, size_t xUriLen) {
+    if (xUriLen != 11 || memcmp(pcUri, "/trace.json", 11) != 0) return false;
+    if (xDl.bActive) {
+        mg_http_reply(c, 409, "", "Trace download in progress\n");
+        return true;
+    }
+    if ((uint8_t) c->data[0] != 0) {
+        mg_http_reply(c, 409, "", "Download in progress\n");
+        return true;
+    }
+
+    bTracePaused = true;
+    c->data[0] = (char) TRACE_STATE_MAGIC;
+    xDl.bActive = true;
+    xDl.dCyclesPerUs = (double) clock_get_hz(clk_sys) / 1e6;
+    vStartCore(0);
+
+    mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                 "Content-Disposition: attachment; filename=\"trace.json\"\r\n"
+                 "Cache-Control: no-store\r\nTransfer-Encoding: chunked\r\n\r\n");
+    char acHead[256];
+    int n = snprintf(acHead, sizeof(acHead),
+                     "{\"traceEvents\":[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"picoscope\"}},\n"
+                     "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"core0\"}},\n"
+                     "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"core1\"}}\n");
+    mg_http_write_chunk(c, acHead, (size_t) n);
+    vTraceEndpointOnWrite(c);
+    return true;
+}
+
+#else
+
+bool bTraceEndpointHandle(struct mg_connection *c, const char *pcUri, size_t xUriLen) {
+    if (xUriLen != 11 || memcmp(pcUri, "/trace.json", 11) != 0) return false;
+    mg_http_reply(c, 404, "", "Tracing not built in (configure with -DPICOSCOPE_TRACE=ON)\n");
+    return true;
+}
+
+void vTraceEndpointOnWrite(struct mg_connection *c) { (void) c; }
+void vTraceEndpointOnClose(struct mg_connection *c) { (void) c; }
+
+#endif /* PICOSCOPE_TRACE */
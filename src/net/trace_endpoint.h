@@ -0,0 +1,34 @@
+#ifndef TRACE_ENDPOINT_H
+#define TRACE_ENDPOINT_H
+
+// Do NOT include mongoose.h here to avoid leaking lwIP macros like poll
+
+#include <stddef.h>
+#include <stdbool.h>
+
+struct mg_connection;
+
+/*
+ * GET /trace.json: the trace rings (core/trace.h) as Chrome trace_event JSON
+ *
+ * Every span becomes a complete event ("ph":"X") with pid 0 and the core as
+ * tid; ts and dur are microseconds since boot, converted from DWT cycles with
+ * the nearest sync anchor and clk_sys. Tracing is paused for the transfer so
+ * the rings do not move under the reader, and resumes when it ends. The body
+ * is produced TRACE_CHUNK_SIZE bytes at a time on MG_EV_WRITE, like the
+ * capture download. One transfer at a time.
+ *
+ * Without PICOSCOPE_TRACE the URI answers 404.
+ */
+
+#define TRACE_CHUNK_SIZE        512u
+#define TRACE_SEND_LOW_WATER    1024u
+
+/* Handle a request for uri; false if it is not /trace.json */
+bool bTraceEndpointHandle(struct mg_connection *c, const char *pcUri, size_t xUriLen);
+
+/* Send buffer drained / connection closing (all HTTP connections) */
+void vTraceEndpointOnWrite(struct mg_connection *c);
+void vTraceEndpointOnClose(struct mg_connection *c);
+
+#endif /* TRACE_ENDPOINT_H */
@@ -0,0 +1,103 @@
+#include "udp_stream.h"
+#include "core/dsp_task.h"
+#include "core/log.h"
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+
+#include "lwip/udp.h"
+#include "lwip/pbuf.h"
+
+#include <string.h>
+
+_Static_assert(sizeof(UdpStreamHeader_t) == 16, "UDP stream header is 16 bytes on the wire");
+
+typedef struct {
+    bool      bActive;
+    ip_addr_t xAddr;
+    uint16_t  usPort;
+    uint32_t  ulSeq;
+} UdpSubscriber_t;
+
+static UdpSubscriber_t xSubscribers[DSP_MAX_CLIENTS];
+static struct udp_pcb *pxPcb = NULL;
+static uint32_t ulDatagrams = 0;
+static uint32_t ulErrors = 0;
+
+/* One unbound pcb serves every subscriber (udp_sendto picks the port on first use) */
+static bool bEnsurePcb(void) {
+    if (pxPcb != NULL) return true;
+    cyw43_arch_lwip_begin();
+    pxPcb = udp_new_ip_type(IPADDR_TYPE_V4);
+    cyw43_arch_lwip_end();
+    return pxPcb != NULL;
+}
+
+bool bUdpStreamSubscribe(uint8_t ucSlot, uint32_t ulAddr, uint16_t usPort) {
+    if (ucSlot >= DSP_MAX_CLIENTS || usPort == 0 || ulAddr == 0) return false;
+    if (!bEnsurePcb()) return false;
+    UdpSubscriber_t *pxSub = &xSubscribers[ucSlot];
+    ip_addr_set_ip4_u32(&pxSub->xAddr, ulAddr);
+    pxSub->usPort = usPort;
+    pxSub->ulSeq = 0;
+    pxSub->bActive = true;
+    uint8_t ucIp[4];                    // ulAddr is in network order
+    memcpy(ucIp, &ulAddr, sizeof(ucIp));
+    LOG(LOG_UDP_SUBSCRIBED, ucSlot, ucIp[0], ucIp[1], ucIp[2], ucIp[3], usPort);
+    return true;
+}
+
+void vUdpStreamUnsubscribe(uint8_t ucSlot) {
+    if (ucSlot < DSP_MAX_CLIENTS) xSubscribers[ucSlot].bActive = false;
+}
+
+bool bUdpStreamActive(uint8_t ucSlot) {
+    return ucSlot < DSP_MAX_CLIENTS && xSubscribers[ucSlot].bActive;
+}
+
+bool bUdpStreamSend(uint8_t ucSlot, const uint8_t *pucFrame, uint16_t usLen) {
+    if (!bUdpStreamActive(ucSlot)) return false;
+    UdpSubscriber_t *pxSub = &xSubscribers[ucSlot];
+
+    /* Header in a RAM pbuf, frame chained by reference (no copy). lwIP copies
+     * referenced data itself if it has to queue the packet (ARP pending), and
+     * the driver copies it out during udp_sendto, so the slot is free after.
+     */
+    cyw43_arch_lwip_begin();
+    struct pbuf *pxHdr = pbuf_alloc(PBUF_TRANSPORT, sizeof(UdpStreamHeader_t), PBUF_RAM);
+    struct pbuf *pxData = pbuf_alloc(PBUF_RAW, usLen, PBUF_REF);
+    err_t xErr = ERR_MEM;
+    if (pxHdr != NULL && pxData != NULL) {
+        UdpStreamHeader_t xHdr = {
+            .usMagic = UDP_STREAM_MAGIC,
+            .ucVersion = UDP_STREAM_VERSION,
+            .ucHeaderLen = sizeof(UdpStreamHeader_t),
+            .ulDatagramSeq = pxSub->ulSeq,
+            .ulSendUs = time_us_32(),
+            .usFrameLen = usLen,
+            .ucClient = ucSlot,
+        };
+        memcpy(pxHdr->payload, &xHdr, sizeof(xHdr));
+        pxData->payload = (void *) pucFrame;
+        pbuf_cat(pxHdr, pxData);
+        pxData = NULL;
+        xErr = udp_sendto(pxPcb, pxHdr, &pxSub->xAddr, pxSub->usPort);
+    }
+    if (pxHdr != NULL) pbuf_free(pxHdr);
+    if (pxData != NULL) pbuf_free(pxData);
+    cyw43_arch_lwip_end();
+
+    /* The sequence advances even on failure: the receiver sees it as loss */
+    pxSub->ulSeq++;
+    if (xErr != ERR_OK) {
+        ulErrors++;
+        return false;
+    }
+    ulDatagrams++;
+    return true;
+}
+
+void vUdpStreamGetStats(uint32_t *pulDatagrams, uint32_t *pulErrors) {
+    if (pulDatagrams) *pulDatagrams = ulDatagrams;
+    if (pulErrors) *pulErrors = ulErrors;
+}
@@ -0,0 +1,55 @@
+#ifndef UDP_STREAM_H
+#define UDP_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * UDP frame stream (optional, per WebSocket client)
+ *
+ * A client sends {"cmd":"udp_subscribe","value":<port>} over its WebSocket and
+ * from then on its frames go to <peer address>:<port> as UDP datagrams instead
+ * of WebSocket messages; {"cmd":"udp_unsubscribe"} or closing the WebSocket
+ * switches back / stops the stream. The WebSocket stays the command channel.
+ *
+ * There is no retransmission and no flow control: a lost datagram is a lost
+ * frame. Inter-frame coding is therefore disabled while subscribed (every
+ * frame is a keyframe, see FRAME_FLAG_INTER in net/frame_codec.h), so each
+ * datagram decodes on its own; it stays off after unsubscribing until the
+ * client sets its frame format again.
+ *
+ * Datagram: one UdpStreamHeader_t, then one v2 frame (net/frame_codec.h) of
+ * usFrameLen bytes. Frames larger than the path MTU are IP-fragmented.
+ * All fields are little endian.
+ */
+
+#define UDP_STREAM_MAGIC     0x5550u    /* "PU" on the wire */
+#define UDP_STREAM_VERSION   1u
+
+typedef struct __attribute__((packed)) {
+    uint16_t usMagic;            // offset 0
+    uint8_t  ucVersion;          // offset 2
+    uint8_t  ucHeaderLen;        // offset 3, frame starts here
+    uint32_t ulDatagramSeq;      // offset 4, per subscription, starts at 0 (gaps = loss)
+    uint32_t ulSendUs;           // offset 8, sender clock (time_us_32) when handed to lwIP
+    uint16_t usFrameLen;         // offset 12
+    uint8_t  ucClient;           // offset 14, client slot of the subscription
+    uint8_t  ucReserved;         // offset 15
+} UdpStreamHeader_t;             // 16 bytes
+
+/* Subscribe a client slot; ulAddr is an IPv4 address in network byte order.
+ * Replaces an existing subscription of the slot and restarts its sequence.
+ */
+bool bUdpStreamSubscribe(uint8_t ucSlot, uint32_t ulAddr, uint16_t usPort);
+void vUdpStreamUnsubscribe(uint8_t ucSlot);
+bool bUdpStreamActive(uint8_t ucSlot);
+
+/* Send one encoded frame to the slot's subscriber (network task only).
+ * The frame is referenced, not copied, and may be reused once this returns.
+ */
+bool bUdpStreamSend(uint8_t ucSlot, const uint8_t *pucFrame, uint16_t usLen);
+
+/* Counters since boot: datagrams sent, send errors (no pcb, no pbuf, lwIP error) */
+void vUdpStreamGetStats(uint32_t *pulDatagrams, uint32_t *pulErrors);
+
+#endif /* UDP_STREAM_H */
@@ -0,0 +1,117 @@
+#include "web_assets.h"
+
+#include "pico/cyw43_arch.h"
+
+#include "third_party/mongoose.h"
+#undef poll
+
+#include <string.h>
+
+/* Per-connection transfer state, kept in c->data while a body is sent */
+#define WEB_ASSET_STATE_MAGIC 0xA5u
+
+typedef struct {
+    uint8_t  ucMagic;               // WEB_ASSET_STATE_MAGIC while sending
+    uint8_t  ucAsset;               // Index into xWebAssets
+    uint16_t usReserved;
+    uint32_t ulOffset;              // Next body byte
+} AssetState_t;
+
+_Static_assert(sizeof(AssetState_t) <= MG_DATA_SIZE, "asset state lives in mg_connection::data");
+
+static inline AssetState_t *pxState(struct mg_connection *c) {
+    return (AssetState_t *) c->data;
+}
+
+const WebAsset_t *pxWebAssetFind(const char *pcUri, size_t xUriLen) {
+    if (xUriLen == 1 && pcUri[0] == '/') {
+        pcUri = "/index.html";
+        xUriLen = strlen(pcUri);
+    }
+    for (size_t i = 0; i < xWebAssetCount; i++) {
+        const char *pcPath = xWebAssets[i].pcPath;
+        if (strlen(pcPath) == xUriLen && memcmp(pcPath, pcUri, xUriLen) == 0) return &xWebAssets[i];
+    }
+    return NULL;
+}
+
+void vWebAssetOnWrite(struct mg_connection *c) {
+    AssetState_t *pxAs = pxState(c);
+    if (pxAs->ucMagic != WEB_ASSET_STATE_MAGIC) return;
+    const WebAsset_t *pxAsset = &xWebAssets[pxAs->ucAsset];
+    while (c->send.len < WEB_ASSET_SEND_LOW_WATER && pxAs->ulOffset < pxAsset->ulLen) {
+        uint32_t ulChunk = pxAsset->ulLen - pxAs->ulOffset;
+        if (ulChunk > WEB_ASSET_CHUNK_SIZE) ulChunk = WEB_ASSET_CHUNK_SIZE;
+        mg_send(c, pxAsset->pucGzip + pxAs->ulOffset, ulChunk);
+        pxAs->ulOffset += ulChunk;
+    }
+    if (pxAs->ulOffset >= pxAsset->ulLen) memset(pxAs, 0, sizeof(*pxAs));
+}
+
+/* If-None-Match lists one or more quoted tags (or "*") */
+static bool bEtagMatches(const struct mg_str *pxHeader, const char *pcEtag) {
+    size_t xLen = strlen(pcEtag);
+    if (pxHeader->len == 1 && pxHeader->buf[0] == '*') return true;
+    for (size_t i = 0; i + xLen <= pxHeader->len; i++) {
+        if (memcmp(pxHeader->buf + i, pcEtag, xLen) == 0) return true;
+    }
+    return false;
+}
+
+/* Accept-Encoding allows gzip: "gzip", "x-gzip" or "*" listed without q=0.
+ * No header at all means any encoding is acceptable.
+ */
+static bool bAcceptsGzip(const struct mg_str *pxHeader) {
+    if (pxHeader == NULL) return true;
+    struct mg_str xRest = *pxHeader, xEntry;
+    while (mg_span(xRest, &xEntry, &xRest, ',')) {
+        struct mg_str xName, xParams;
+        mg_span(xEntry, &xName, &xParams, ';');
+        while (xName.len > 0 && xName.buf[0] == ' ') xName.buf++, xName.len--;
+        while (xName.len > 0 && xName.buf[xName.len - 1] == ' ') xName.len--;
+        if (mg_strcasecmp(xName, mg_str("gzip")) != 0 && mg_strcasecmp(xName, mg_str("x-gzip")) != 0 &&
+            mg_strcmp(xName, mg_str("*")) != 0) {
+            continue;
+        }
+        // q=0, q=0.0, q=0.00... rejects the coding
+        const char *p = xParams.buf;
+        size_t n = xParams.len;
+        while (n > 0 && (*p == ' ' || *p == ';')) p++, n--;
+        if (n < 3 || (p[0] != 'q' && p[0] != 'Q') || p[1] != '=' || p[2] != '0') return true;
+        for (size_t i = 3; i < n && p[i] != ' '; i++) {
+            if (p[i] != '.' && p[i] != '0') return true;
+        }
+    }
+    return false;
+}
+
+bool bWebAssetServe(struct mg_connection *c, const struct mg_http_message *hm) {
+    const WebAsset_t *pxAsset = pxWebAssetFind(hm->uri.buf, hm->uri.len);
+    if (pxAsset == NULL) return false;
+
+    // Only the gzip stream is stored
+    if (!bAcceptsGzip(mg_http_get_header((struct mg_http_message *) hm, "Accept-Encoding"))) {
+        mg_http_reply(c, 406, "Vary: Accept-Encoding\r\n", "Only gzip-encoded content is available\n");
+        return true;
+    }
+
+    // Cached copy still current: headers only
+    struct mg_str *pxMatch = mg_http_get_header((struct mg_http_message *) hm, "If-None-Match");
+    if (pxMatch != NULL && bEtagMatches(pxMatch, pxAsset->pcEtag)) {
+        mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: no-cache\r\nVary: Accept-Encoding\r\n"
+                     "Content-Length: 0\r\n\r\n", pxAsset->pcEtag);
+        return true;
+    }
+
+    mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Encoding: gzip\r\nContent-Length: %lu\r\n"
+                 "ETag: %s\r\nCache-Control: no-cache\r\nVary: Accept-Encoding\r\n\r\n",
+              pxAsset->pcMime, (unsigned long) pxAsset->ulLen, pxAsset->pcEtag);
+    if (mg_strcmp(hm->method, mg_str("HEAD")) == 0) return true;
+
+    AssetState_t *pxAs = pxState(c);
+    pxAs->ucMagic = WEB_ASSET_STATE_MAGIC;
+    pxAs->ucAsset = (uint8_t) (pxAsset - xWebAssets);
+    pxAs->ulOffset = 0;
+    vWebAssetOnWrite(c);
+    return true;
+}
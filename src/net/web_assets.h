@@ -0,0 +1,51 @@
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+// Do NOT include mongoose.h here to avoid leaking lwIP macros like poll
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+struct mg_connection;
+struct mg_http_message;
+
+/*
+ * Static frontend assets (src/web)
+ *
+ * tools/pack_assets.py gzips every file at build time into a table in flash
+ * (generated web_assets_data.c). Assets are served as stored, with
+ * Content-Encoding: gzip, Content-Length and an ETag of the compressed bytes;
+ * Cache-Control: no-cache makes the browser revalidate, which costs one
+ * 304 Not Modified once the page is cached. "/" serves /index.html.
+ * There is no identity copy: a request whose Accept-Encoding rules out gzip
+ * gets 406 Not Acceptable (no Accept-Encoding header accepts anything).
+ *
+ * The body is copied from flash into the send buffer WEB_ASSET_CHUNK_SIZE
+ * bytes at a time as it drains (MG_EV_WRITE), like net/capture_download.h.
+ */
+
+#define WEB_ASSET_CHUNK_SIZE    1024u
+#define WEB_ASSET_SEND_LOW_WATER 1024u
+
+typedef struct {
+    const char    *pcPath;          // URL path, e.g. "/app.js"
+    const char    *pcMime;
+    const uint8_t *pucGzip;         // gzip stream
+    uint32_t       ulLen;
+    const char    *pcEtag;          // Quoted, as sent in the ETag header
+} WebAsset_t;
+
+extern const WebAsset_t xWebAssets[];
+extern const size_t xWebAssetCount;
+
+/* Asset for a request path (NULL if none) */
+const WebAsset_t *pxWebAssetFind(const char *pcUri, size_t xUriLen);
+
+/* Serve the asset hm asks for; false if the path is not an asset */
+bool bWebAssetServe(struct mg_connection *c, const struct mg_http_message *hm);
+
+/* Send buffer drained (all HTTP connections) */
+void vWebAssetOnWrite(struct mg_connection *c);
+
+#endif /* WEB_ASSETS_H */
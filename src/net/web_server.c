@@ -1,7 +1,14 @@
 #include "web_server.h"
-#include "core/scope_data.h"
-#include "core/trigger.h"
+#include "core/scope_view.h"
 #include "core/command_handler.h"
+#include "core/frame_queue.h"
+#include "core/dsp_task.h"
+#include "core/cpu_load.h"
+#include "core/metrics.h"
+#include "core/trace.h"
+#include "core/log.h"
+#include "drivers/adc_dma.h"
+#include "net/udp_stream.h"
 
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"        // Include CYW43 (and async_context) first
@@ -10,30 +17,100 @@
 #undef poll                          // Safety: do not let lwIP's poll macro leak further
 
 #include "mg_handler.h"
-#include "core/command_handler.h"
+#include "scpi_server.h"
+#include "capture_download.h"
+#include "mg_pool.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
 
+/* Upper bound on a blocking poll: 1 s report and Mongoose timers.
+ * Without the wake-up socket, fall back to short polls.
+ */
+#define WEB_POLL_IDLE_MS        100
+#define WEB_POLL_FALLBACK_MS    10
+#define WEB_WAKE_PROBE_MS       200     /* Time for the init probe datagram to arrive */
+
+/* Wake-up path: a loopback UDP pair (mg_wakeup) makes the blocking select return */
+static bool bWakeReady = false;
+static unsigned long ulWakeConnId = 0;
+static uint32_t ulWakePending = 0;
+static volatile bool bWakeSeen = false;
+
+void vWebServerWake(void) {
+    if (!__atomic_load_n(&bWakeReady, __ATOMIC_ACQUIRE)) return;
+    if (__atomic_exchange_n(&ulWakePending, 1u, __ATOMIC_ACQ_REL) == 0) {
+        mg_wakeup(&xWebsocketManager, ulWakeConnId, "", 0);
+    }
+}
+
+void vWebServerOnWakeup(void) {
+    bWakeSeen = true;
+}
+
+/* mg_wakeup() cannot report a lost datagram (e.g. no loopback route in lwIP),
+ * so only trust the path once one wake-up has made it through.
+ */
+static bool bProbeWakeup(void) {
+    bWakeSeen = false;
+    if (!mg_wakeup(&xWebsocketManager, ulWakeConnId, "", 0)) return false;
+    for (uint32_t i = 0; i < WEB_WAKE_PROBE_MS / 10u && !bWakeSeen; i++) {
+        mg_mgr_poll(&xWebsocketManager, 10);
+    }
+    return bWakeSeen;
+}
+
 static bool bInitServer() {
+    // Connection and I/O buffer pools first: every Mongoose allocation goes through them
+    bMgPoolInit();
     mg_mgr_init(&xWebsocketManager);
     struct mg_connection *uxListener = NULL;
 
     /* Initialize Mongoose HTTP server */
+    char acUrl[32];
+    snprintf(acUrl, sizeof(acUrl), "http://0.0.0.0:%u", (unsigned) WEB_SERVER_PORT);
     cyw43_arch_lwip_begin();
-    uxListener = mg_http_listen(&xWebsocketManager, "http://0.0.0.0:80", (mg_event_handler_t) vEventHandler, NULL);
+    uxListener = mg_http_listen(&xWebsocketManager, acUrl, (mg_event_handler_t) vEventHandler, NULL);
+    bool bScpi = bScpiServerInit(&xWebsocketManager);
+    vCaptureDownloadInit();
     cyw43_arch_lwip_end();
 
+    if (!bScpi) printf("SCPI server could not listen on port %u\n", SCPI_PORT);
+
     if (!uxListener) {
         return false;
     }
+
+    /* Wake-ups are addressed to the listener, which ignores MG_EV_WAKEUP */
+    ulWakeConnId = uxListener->id;
+    bool bWake = mg_wakeup_init(&xWebsocketManager) && bProbeWakeup();
+    __atomic_store_n(&bWakeReady, bWake, __ATOMIC_RELEASE);
+    if (!bWake) printf("Mongoose wake-up socket unavailable, polling every %u ms\n", WEB_POLL_FALLBACK_MS);
     return true;
 } 
 
-/* Task: Web server + streamer
- * Drives Mongoose (mg_mgr_poll) under CYW43 lwIP guards
- * Sends a frame immediately when notified by acquisition (xTaskNotifyGive)
- * Also rate-limits to ~20 FPS as a fallback
+/* Hand queued frames to their connections; frames for a slot that was closed
+ * or reused since they were encoded are discarded.
+ */
+static void vDrainFrameQueue(void) {
+    QueuedFrame_t *pxFrame;
+    while ((pxFrame = pxFrameQueueTake()) != NULL) {
+        for (uint8_t ucSlot = 0; ucSlot < WS_MAX_CLIENTS; ucSlot++) {
+            if (!(pxFrame->ucClientMask & (1u << ucSlot))) continue;
+            WsClient_t *pxClient = &xWebsocketClients[ucSlot];
+            if (pxClient->pxConn != NULL && ulDspClientGeneration(ucSlot) == pxFrame->ulGeneration[ucSlot]) {
+                vWebsocketSendFrame(pxClient, pxFrame);
+            }
+        }
+        vFrameQueueRelease(pxFrame);
+    }
+}
+
+/* Task: Web server (core 0)
+ * Sleeps in Mongoose's select() until a socket is readable/writable or the DSP
+ * task queued frames (vWebServerWake), then sends those frames. Commands are
+ * therefore read as soon as they arrive, not on the next poll tick. The DSP
+ * work itself runs on core 1, see core/dsp_task.h.
  */
 void vWebServerTask(void *pvParameters) {
     cyw43_arch_enable_sta_mode();
@@ -56,79 +133,59 @@ void vWebServerTask(void *pvParameters) {
         vTaskDelete(NULL);
         return;
     }
-    printf("Mongoose HTTP server listening on port 80\n");
-    
+    printf("Mongoose HTTP server listening on port %u\n", (unsigned) WEB_SERVER_PORT);
+    vMetricsCyclesEnable();
+    TRACE_INIT_CORE();
+
     vCommandHandlerInit();
 
-    TickType_t xLastUpdate = xTaskGetTickCount();
-    const TickType_t xUpdatePeriod = pdMS_TO_TICKS(50);  // ~20 FPS fallback
-    uint16_t usDecimated[DISPLAY_POINTS];
+    const int iPollMs = bWakeReady ? WEB_POLL_IDLE_MS : WEB_POLL_FALLBACK_MS;
+    TickType_t xLastReport = xTaskGetTickCount();
 
     for (;;) {
-        // Block until either notified by acquisition OR timeout to keep UI alive
-        uint32_t ulNotif = ulTaskNotifyTake(pdTRUE, xUpdatePeriod);
-        bool bPushDueNotify = (ulNotif > 0);
-
-        // Always service Mongoose regularly
-        cyw43_arch_lwip_begin();
-        mg_mgr_poll(&xWebsocketManager, 0);
-        cyw43_arch_lwip_end();
-
-        TickType_t now = xTaskGetTickCount();
-        bool bPushDueTimer = (now - xLastUpdate) >= xUpdatePeriod;
-        if (bPushDueTimer) xLastUpdate = now;
-
-        if (xWebsocketCount > 0 && (bPushDueNotify || bPushDueTimer)) {
-            ScopeBuffer_t xLatest;
-            if (bGetLatestScopeData(&xLatest, true) && xLatest.pusSamples != NULL) {
-                ScopePacket_t xPacket;
-                uint32_t ulNowMs = to_ms_since_boot(get_absolute_time());
-                xPacket.ulTimestampMs = xLatest.ulTimestamp;
-                xPacket.ulAgeMs = (xLatest.ulTimestamp <= ulNowMs) ? (ulNowMs - xLatest.ulTimestamp) : 0;
-                xPacket.ulSampleCount = DISPLAY_POINTS;  // Always sending DISPLAY_POINTS samples
-                xPacket.ulSampleRateHz = ulAdcDmaGetMeasuredSampleRate();
-                xPacket.vmin = xLatest.min_voltage;
-                xPacket.vmax = xLatest.max_voltage;
-                xPacket.vavg = xLatest.avg_voltage;
-
-                TriggerResult_t res;
-                TriggerConfig_t* trig = pxCommandHandlerGetTriggerConfig();
-                bTriggerBuildFrame(
-                    xLatest.pusSamples,
-                    ADC_BUFFER_SIZE,
-                    xPacket.ulSampleRateHz,
-                    trig,  // Use pointer from command handler
-                    usDecimated,
-                    DISPLAY_POINTS,
-                    &res
-                );
-
-                // Debug: print trigger status occasionally
-                static uint32_t debug_count = 0;
-                if (++debug_count % 100 == 0) {
-                    printf("Trig: %s at idx=%d, span=%lu samples, Fs=%lu Hz\n",
-                           res.bTriggered ? "LOCK" : "FREE",
-                           res.iTriggerIndex,
-                           res.uLen,
-                           xPacket.ulSampleRateHz);
-                }
-
-                // Copy decimated samples into packet
-                for (uint32_t i = 0; i < DISPLAY_POINTS; i++) xPacket.usSamples[i] = usDecimated[i];
-                
-                // Send to all connected WebSocket clients
-                cyw43_arch_lwip_begin();
-                for (size_t i = 0; i < xWebsocketCount; i++) {
-                    struct mg_connection *ws = xWebsocketConnections[i];
-                    if (ws && ws->is_websocket) {
-                        mg_ws_send(ws, (const char *) &xPacket, sizeof(xPacket), WEBSOCKET_OP_BINARY);
-                    }
-                }
-                cyw43_arch_lwip_end();
-
-                // Release the in-use buffer so the next ready buffer can be promoted
-                vScopeDataReleaseBuffer();
-            }
+        // Block in select() on socket readiness or a wake-up. Mongoose only uses
+        // the lwIP socket API here, which is thread-safe (NO_SYS=0); holding the
+        // CYW43 lwIP lock while blocked would stall the Wi-Fi driver.
+        // A pending frame batch shortens the wait to its latency cap.
+        int iBatchMs = iWebsocketBatchWaitMs();
+        TRACE_SYNC();
+        TRACE_BEGIN(TRACE_MG_POLL);
+        mg_mgr_poll(&xWebsocketManager, (iBatchMs >= 0 && iBatchMs < iPollMs) ? iBatchMs : iPollMs);
+        TRACE_END(TRACE_MG_POLL);
+
+        // Settings received in this pass take effect together, before the next capture
+        vWebsocketApplyCommands();
+
+        // Re-arm before draining so frames queued from now on wake us again
+        __atomic_store_n(&ulWakePending, 0u, __ATOMIC_RELEASE);
+        uint32_t ulDrainStart = ulMetricsCycles();
+        vDrainFrameQueue();
+        vWebsocketFlushBatches();
+        vMetricsStageAdd(METRICS_STAGE_NET_DRAIN, ulMetricsCycles() - ulDrainStart);
+        vWebsocketUpdateCredits();
+
+        // Debug: per-core load and pipeline counters once a second (printed by vLogTask)
+        TickType_t xNow = xTaskGetTickCount();
+        if ((xNow - xLastReport) >= pdMS_TO_TICKS(1000)) {
+            xLastReport = xNow;
+            vCpuLoadSample();
+            uint32_t ulRenders, ulHits, ulQueued, ulFull, ulDepth, ulDspUs, ulDspMaxUs, ulDirect, ulBuffered, ulUdp, ulUdpErr;
+            ScopeConsumerStats_t xInput = {0};
+            bDspGetInputStats(&xInput);
+            vScopeViewGetStats(&ulRenders, &ulHits);
+            vFrameQueueGetStats(&ulQueued, &ulFull, &ulDepth);
+            vDspGetTiming(&ulDspUs, &ulDspMaxUs);
+            vWebsocketGetTxStats(&ulDirect, &ulBuffered);
+            vUdpStreamGetStats(&ulUdp, &ulUdpErr);
+            MgPoolStats_t xPool;
+            vMgPoolGetStats(&xPool);
+            LOG(LOG_REPORT_LOAD, ucCpuLoadGetPercent(0), ucCpuLoadGetPercent(1), ulAdcDmaGetOverruns(),
+                ulDspUs, ulDspMaxUs, xInput.ulConsumed, xInput.ulDropped);
+            LOG(LOG_REPORT_FRAMES, xWebsocketCount, ulRenders, ulHits, ulQueued, ulDepth, ulFull, ulDspFramesShared());
+            LOG(LOG_REPORT_TX, ulDirect, ulBuffered, ulUdp, ulUdpErr);
+            LOG(LOG_REPORT_POOL, xPool.xClass[1].ulHighWater, xPool.xClass[1].ulBlocks, xPool.xClass[2].ulHighWater,
+                xPool.xClass[2].ulBlocks, xPool.xClass[3].ulHighWater, xPool.xClass[3].ulBlocks,
+                xPool.ulHeapAllocs, xPool.ulFailures);
         }
     }
-}
\ No newline at end of file
+}
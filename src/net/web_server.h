@@ -4,6 +4,11 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
+/* HTTP/WebSocket listen port (the host simulation listens on an unprivileged one) */
+#ifndef WEB_SERVER_PORT
+#define WEB_SERVER_PORT 80
+#endif
+
 /* A struct to hold the parameters for the web server task. */
 typedef struct {
     const char *pcWifiName;
@@ -16,4 +21,12 @@ typedef struct {
  */
 void vWebServerTask(void *pvParameters);
 
+/* Wake the web server task from any task (e.g. frames were queued).
+ * Wakes are coalesced until the task has run.
+ */
+void vWebServerWake(void);
+
+/* MG_EV_WAKEUP reached the listener (mg_handler.c); confirms the wake-up path */
+void vWebServerOnWakeup(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "ws_command.h"
+#include <string.h>
+
+typedef struct {
+    const char *pcName;
+    uint8_t     ucNameLen;
+    uint8_t     ucOpcode;        // WsOpcode_e
+    int8_t      cType;           // CommandType_e, -1 for commands handled by the network task
+} WsCommandEntry_t;
+
+#define WS_ENTRY(name, op, type) { name, (uint8_t) (sizeof(name) - 1u), op, type }
+
+/* Sorted by name (byte order, shorter first on a common prefix) for bsearch */
+static const WsCommandEntry_t xCommands[] = {
+    WS_ENTRY("client_stats",    WS_OP_CLIENT_STATS,    -1),
+    WS_ENTRY("display_points",  WS_OP_DISPLAY_POINTS,  CMD_DISPLAY_POINTS),
+    WS_ENTRY("frame_format",    WS_OP_FRAME_FORMAT,    CMD_FRAME_FORMAT),
+    WS_ENTRY("metrics",         WS_OP_METRICS,         -1),
+    WS_ENTRY("run_stop",        WS_OP_RUN_STOP,        CMD_RUN_STOP),
+    WS_ENTRY("timebase_scale",  WS_OP_TIMEBASE_SCALE,  CMD_TIMEBASE_SCALE),
+    WS_ENTRY("trigger_edge",    WS_OP_TRIGGER_EDGE,    CMD_TRIGGER_EDGE),
+    WS_ENTRY("trigger_level",   WS_OP_TRIGGER_LEVEL,   CMD_TRIGGER_LEVEL),
+    WS_ENTRY("trigger_mode",    WS_OP_TRIGGER_MODE,    CMD_TRIGGER_MODE),
+    WS_ENTRY("udp_subscribe",   WS_OP_UDP_SUBSCRIBE,   -1),
+    WS_ENTRY("udp_unsubscribe", WS_OP_UDP_UNSUBSCRIBE, -1),
+    WS_ENTRY("vertical_offset", WS_OP_VERTICAL_OFFSET, CMD_VERTICAL_OFFSET),
+    WS_ENTRY("vertical_scale",  WS_OP_VERTICAL_SCALE,  CMD_VERTICAL_SCALE),
+    WS_ENTRY("zoom_center",     WS_OP_ZOOM_CENTER,     CMD_ZOOM_CENTER),
+    WS_ENTRY("zoom_width",      WS_OP_ZOOM_WIDTH,      CMD_ZOOM_WIDTH),
+};
+
+#define WS_COMMAND_COUNT (sizeof(xCommands) / sizeof(xCommands[0]))
+
+static int iCompareName(const WsCommandEntry_t *pxEntry, const char *pcName, size_t xLen) {
+    size_t xMin = pxEntry->ucNameLen < xLen ? pxEntry->ucNameLen : xLen;
+    int iCmp = memcmp(pxEntry->pcName, pcName, xMin);
+    if (iCmp != 0) return iCmp;
+    return (pxEntry->ucNameLen > xLen) - (pxEntry->ucNameLen < xLen);
+}
+
+static const WsCommandEntry_t *pxFindByName(const char *pcName, size_t xLen) {
+    size_t xLo = 0, xHi = WS_COMMAND_COUNT;
+    while (xLo < xHi) {
+        size_t xMid = (xLo + xHi) / 2u;
+        int iCmp = iCompareName(&xCommands[xMid], pcName, xLen);
+        if (iCmp == 0) return &xCommands[xMid];
+        if (iCmp < 0) xLo = xMid + 1u;
+        else xHi = xMid;
+    }
+    return NULL;
+}
+
+static const WsCommandEntry_t *pxFindByOpcode(uint8_t ucOpcode) {
+    for (size_t i = 0; i < WS_COMMAND_COUNT; i++) {
+        if (xCommands[i].ucOpcode == ucOpcode) return &xCommands[i];
+    }
+    return NULL;
+}
+
+/* Value conversion per setting (clamping is left to command_handler) */
+static void vFillScopeCommand(CommandType_e eType, double dValue, ScopeCommand_t *pxCmd) {
+    pxCmd->eType = eType;
+    switch (eType) {
+        case CMD_TRIGGER_LEVEL:   pxCmd->uValue.fTriggerLevel = (float) dValue; break;
+        case CMD_TRIGGER_MODE:    pxCmd->uValue.eTriggerMode = (TriggerMode_e) ((int) dValue); break;
+        case CMD_TRIGGER_EDGE:    pxCmd->uValue.eTriggerEdge = (TriggerEdge_e) ((int) dValue); break;
+        case CMD_TIMEBASE_SCALE:  pxCmd->uValue.fTimePerDiv = (float) dValue; break;
+        case CMD_VERTICAL_SCALE:  pxCmd->uValue.fVoltsPerDiv = (float) dValue; break;
+        case CMD_VERTICAL_OFFSET: pxCmd->uValue.fVerticalOffset = (float) dValue; break;
+        case CMD_FRAME_FORMAT:    pxCmd->uValue.ucFrameFormat = (uint8_t) ((int) dValue); break;
+        case CMD_DISPLAY_POINTS:
+            pxCmd->uValue.usPoints = (uint16_t) (dValue < 0.0 ? 0.0 : (dValue > 65535.0 ? 65535.0 : dValue));
+            break;
+        case CMD_ZOOM_WIDTH:
+        case CMD_ZOOM_CENTER:     pxCmd->uValue.fZoom = (float) dValue; break;
+        case CMD_RUN_STOP:        pxCmd->uValue.bRunning = ((int) dValue != 0); break;
+        default: break;
+    }
+}
+
+static void vFillCommand(const WsCommandEntry_t *pxEntry, WsCommand_t *pxOut) {
+    pxOut->eOpcode = (WsOpcode_e) pxEntry->ucOpcode;
+    pxOut->bScope = pxEntry->cType >= 0;
+    if (pxOut->bScope) vFillScopeCommand((CommandType_e) pxEntry->cType, pxOut->dValue, &pxOut->xCmd);
+}
+
+/* In-place JSON scanning over [p, pcEnd) */
+typedef struct {
+    const char *p;
+    const char *pcEnd;
+} JsonScan_t;
+
+static void vSkipSpace(JsonScan_t *s) {
+    while (s->p < s->pcEnd && (*s->p == ' ' || *s->p == '\t' || *s->p == '\r' || *s->p == '\n')) s->p++;
+}
+
+static bool bTake(JsonScan_t *s, char ch) {
+    vSkipSpace(s);
+    if (s->p >= s->pcEnd || *s->p != ch) return false;
+    s->p++;
+    return true;
+}
+
+/* String at p: span between the quotes, escapes left as they are */
+static bool bScanString(JsonScan_t *s, const char **ppcStart, size_t *pxLen) {
+    vSkipSpace(s);
+    if (s->p >= s->pcEnd || *s->p != '"') return false;
+    const char *pcStart = ++s->p;
+    while (s->p < s->pcEnd && *s->p != '"') {
+        if (*s->p == '\\' && ++s->p >= s->pcEnd) return false;
+        s->p++;
+    }
+    if (s->p >= s->pcEnd) return false;
+    *ppcStart = pcStart;
+    *pxLen = (size_t) (s->p - pcStart);
+    s->p++;
+    return true;
+}
+
+static bool bIsDigit(char ch) { return ch >= '0' && ch <= '9'; }
+
+static const double dPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* JSON number; digits are accumulated as an integer and scaled once */
+static bool bScanNumber(JsonScan_t *s, double *pdValue) {
+    const char *p = s->p;
+    bool bNegative = p < s->pcEnd && *p == '-';
+    if (bNegative) p++;
+    if (p >= s->pcEnd || !bIsDigit(*p)) return false;
+
+    double dMantissa = 0.0;
+    int iExp = 0;
+    for (; p < s->pcEnd && bIsDigit(*p); p++) dMantissa = dMantissa * 10.0 + (*p - '0');
+    if (p < s->pcEnd && *p == '.') {
+        p++;
+        if (p >= s->pcEnd || !bIsDigit(*p)) return false;
+        for (; p < s->pcEnd && bIsDigit(*p); p++, iExp--) dMantissa = dMantissa * 10.0 + (*p - '0');
+    }
+    if (p < s->pcEnd && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool bExpNegative = p < s->pcEnd && *p == '-';
+        if (p < s->pcEnd && (*p == '-' || *p == '+')) p++;
+        if (p >= s->pcEnd || !bIsDigit(*p)) return false;
+        int iE = 0;
+        for (; p < s->pcEnd && bIsDigit(*p); p++) if (iE < 1000) iE = iE * 10 + (*p - '0');
+        iExp += bExpNegative ? -iE : iE;
+    }
+
+    // Outside what a float setting can hold anyway
+    if (iExp > 38 || iExp < -44) return false;
+    int iAbs = iExp < 0 ? -iExp : iExp;
+    double dScale = iAbs <= 22 ? dPow10[iAbs] : dPow10[22] * dPow10[iAbs - 22];
+    double dValue = iExp < 0 ? dMantissa / dScale : dMantissa * dScale;
+
+    *pdValue = bNegative ? -dValue : dValue;
+    s->p = p;
+    return true;
+}
+
+static bool bTakeLiteral(JsonScan_t *s, const char *pcWord, size_t xLen) {
+    if ((size_t) (s->pcEnd - s->p) < xLen || memcmp(s->p, pcWord, xLen) != 0) return false;
+    s->p += xLen;
+    return true;
+}
+
+/* Skip any value: scalars up to the next delimiter, containers by depth */
+static bool bSkipValue(JsonScan_t *s) {
+    vSkipSpace(s);
+    uint32_t ulDepth = 0;
+    while (s->p < s->pcEnd) {
+        char ch = *s->p;
+        if (ch == '"') {
+            const char *pcStr;
+            size_t xLen;
+            if (!bScanString(s, &pcStr, &xLen)) return false;
+            if (ulDepth == 0) return true;
+            continue;
+        }
+        if (ch == '{' || ch == '[') ulDepth++;
+        else if (ch == '}' || ch == ']') {
+            if (ulDepth == 0) return true;           // End of the enclosing object
+            if (--ulDepth == 0) { s->p++; return true; }
+        } else if (ch == ',' && ulDepth == 0) return true;
+        s->p++;
+    }
+    return false;
+}
+
+static bool bKeyIs(const char *pcKey, size_t xLen, const char *pcWant, size_t xWantLen) {
+    return xLen == xWantLen && memcmp(pcKey, pcWant, xLen) == 0;
+}
+
+WsCommandResult_e eWsCommandParseJson(const char *pcMsg, size_t xLen, WsCommand_t *pxOut) {
+    memset(pxOut, 0, sizeof(*pxOut));
+    pxOut->pcName = "";
+    JsonScan_t s = { pcMsg, pcMsg + xLen };
+    bool bNamed = false;
+
+    if (!bTake(&s, '{')) return WS_CMD_BAD_FORMAT;
+    if (!bTake(&s, '}')) {
+        for (;;) {
+            const char *pcKey;
+            size_t xKeyLen;
+            if (!bScanString(&s, &pcKey, &xKeyLen) || !bTake(&s, ':')) return WS_CMD_BAD_FORMAT;
+            vSkipSpace(&s);
+
+            if (bKeyIs(pcKey, xKeyLen, "cmd", 3) && s.p < s.pcEnd && *s.p == '"') {
+                if (!bScanString(&s, &pxOut->pcName, &pxOut->xNameLen)) return WS_CMD_BAD_FORMAT;
+                bNamed = true;
+            } else if (bKeyIs(pcKey, xKeyLen, "value", 5) && bScanNumber(&s, &pxOut->dValue)) {
+                // Number taken
+            } else if (bKeyIs(pcKey, xKeyLen, "value", 5) && bTakeLiteral(&s, "true", 4)) {
+                pxOut->dValue = 1.0;
+            } else if (!bSkipValue(&s)) {
+                return WS_CMD_BAD_FORMAT;
+            }
+
+            if (bTake(&s, ',')) continue;
+            if (bTake(&s, '}')) break;
+            return WS_CMD_BAD_FORMAT;
+        }
+    }
+    if (!bNamed) return WS_CMD_NO_NAME;
+
+    const WsCommandEntry_t *pxEntry = pxFindByName(pxOut->pcName, pxOut->xNameLen);
+    if (pxEntry == NULL) return WS_CMD_UNKNOWN;
+    vFillCommand(pxEntry, pxOut);
+    return WS_CMD_OK;
+}
+
+WsCommandResult_e eWsCommandParseBinary(const uint8_t *pucMsg, size_t xLen, WsCommand_t *pxOut) {
+    memset(pxOut, 0, sizeof(*pxOut));
+    pxOut->pcName = "";
+    if (xLen != WS_COMMAND_BINARY_LEN) return WS_CMD_BAD_FORMAT;
+
+    const WsCommandEntry_t *pxEntry = pxFindByOpcode(pucMsg[0]);
+    if (pxEntry == NULL) return WS_CMD_UNKNOWN;
+
+    uint32_t ulBits = (uint32_t) pucMsg[1] | ((uint32_t) pucMsg[2] << 8) |
+                      ((uint32_t) pucMsg[3] << 16) | ((uint32_t) pucMsg[4] << 24);
+    float fValue;
+    memcpy(&fValue, &ulBits, sizeof(fValue));
+    if (fValue != fValue) return WS_CMD_BAD_FORMAT;      // NaN
+    pxOut->dValue = fValue;
+    pxOut->pcName = pxEntry->pcName;
+    pxOut->xNameLen = pxEntry->ucNameLen;
+    vFillCommand(pxEntry, pxOut);
+    return WS_CMD_OK;
+}
@@ -0,0 +1,66 @@
+#ifndef WS_COMMAND_H
+#define WS_COMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "core/command_handler.h"
+
+/*
+ * WebSocket command decoder (no allocation, no copy)
+ *
+ * JSON form (text message):   {"cmd":"trigger_level","value":1.65}
+ *   Scanned in place: the message is not copied or NUL terminated, "cmd" is
+ *   returned as a span of the input and "value" (number or true/false) is
+ *   parsed directly. Other keys are skipped. The name is looked up by binary
+ *   search in a table sorted by name.
+ *
+ * Binary form (binary message, WS_COMMAND_BINARY_LEN bytes):
+ *   uint8_t opcode (WsOpcode_e), float value (little endian)
+ *   For tools and high-rate controls; same commands, no parsing.
+ *
+ * The decoder only fills a WsCommand_t; mg_handler.c decides what to do with
+ * it. Safe to call from any context.
+ */
+
+/* Opcodes of the binary form; stable on the wire, append only */
+typedef enum {
+    WS_OP_TRIGGER_LEVEL = 1,
+    WS_OP_TRIGGER_MODE,
+    WS_OP_TRIGGER_EDGE,
+    WS_OP_TIMEBASE_SCALE,
+    WS_OP_VERTICAL_SCALE,
+    WS_OP_VERTICAL_OFFSET,
+    WS_OP_FRAME_FORMAT,
+    WS_OP_DISPLAY_POINTS,
+    WS_OP_ZOOM_WIDTH,
+    WS_OP_ZOOM_CENTER,
+    WS_OP_RUN_STOP,
+    WS_OP_CLIENT_STATS,
+    WS_OP_UDP_SUBSCRIBE,
+    WS_OP_UDP_UNSUBSCRIBE,
+    WS_OP_METRICS,
+} WsOpcode_e;
+
+#define WS_COMMAND_BINARY_LEN 5u
+
+typedef enum {
+    WS_CMD_OK = 0,
+    WS_CMD_BAD_FORMAT,           // Not a JSON object / wrong binary length
+    WS_CMD_NO_NAME,              // No "cmd" string
+    WS_CMD_UNKNOWN,              // Name or opcode not in the table
+} WsCommandResult_e;
+
+typedef struct {
+    WsOpcode_e     eOpcode;
+    bool           bScope;       // xCmd is valid (settings for command_handler)
+    ScopeCommand_t xCmd;
+    double         dValue;       // "value" as sent, 0 if absent
+    const char    *pcName;       // "cmd" inside the message (not terminated)
+    size_t         xNameLen;
+} WsCommand_t;
+
+WsCommandResult_e eWsCommandParseJson(const char *pcMsg, size_t xLen, WsCommand_t *pxOut);
+WsCommandResult_e eWsCommandParseBinary(const uint8_t *pucMsg, size_t xLen, WsCommand_t *pxOut);
+
+#endif /* WS_COMMAND_H */
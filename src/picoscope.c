@@ -7,11 +7,25 @@
 #include "net/web_server.h"
 #include "drivers/adc_dma.h"
 #include "core/scope_data.h"
+#include "core/dsp_task.h"
+#include "core/metrics.h"
+#include "core/trace.h"
+#include "core/log.h"
 #include "drivers/test_signal.h"
 
+#if PICOSCOPE_KERNEL_BENCH
+#include "core/kernel_bench.h"
+#include "hardware/clocks.h"
+#endif
+
 static TaskHandle_t xWebServerHandle = NULL;
 static TaskHandle_t xBlinkHandle = NULL;
 static TaskHandle_t xAcquisitionHandle = NULL;
+static TaskHandle_t xDspHandle = NULL;
+
+/* Core placement: network (Wi-Fi, lwIP, Mongoose) and acquisition on core 0, DSP on core 1 */
+#define NETWORK_CORE_MASK   (1u << 0)
+#define DSP_CORE_MASK       (1u << 1)
 
 /*
  * Task: Blink LED
@@ -33,6 +47,8 @@ static void vAcquisitionTask(void *pv) {
     uint32_t pulCaptureTimestamp;
 
     vAdcDmaInit();
+    vMetricsCyclesEnable();
+    TRACE_INIT_CORE();
 
     // Choose your time/div by sample rate (examples):
     // 50 kSPS  -> 1024/50k = 20.48 ms total (~2.05 ms/div)
@@ -45,16 +61,45 @@ static void vAcquisitionTask(void *pv) {
     
     for (;;) {
         uint16_t *dma_buffer = NULL;
+        AdcBufferHandle_t xDmaHandle;
         
         /* Get pointer to latest DMA buffer */
-        if (bAdcDmaGetLatestBufferPtr(&dma_buffer, &pulCaptureTimestamp)) {
+        if (bAdcDmaGetLatestBufferPtr(&dma_buffer, &pulCaptureTimestamp, &xDmaHandle)) {
             /* Pass DMA buffer pointer directly (zero-copy) */
-            vScopeDataPublishBuffer(dma_buffer, pulCaptureTimestamp);
+            uint32_t ulStart = ulMetricsCycles();
+            TRACE_BEGIN(TRACE_PUBLISH);
+            vScopeDataPublishBuffer(dma_buffer, pulCaptureTimestamp, xDmaHandle);
+            TRACE_END(TRACE_PUBLISH);
+            vMetricsStageAdd(METRICS_STAGE_PUBLISH, ulMetricsCycles() - ulStart);
+            TRACE_SYNC();
         }
         vTaskDelay(pdMS_TO_TICKS(1));
     }
 }
 
+#if PICOSCOPE_KERNEL_BENCH
+/*
+ * Task: DSP kernel benchmark (build option PICOSCOPE_KERNEL_BENCH)
+ * Runs the core/kernel_bench.h sweep once on the DSP core, above the DSP
+ * task, and prints the JSON with DWT cycle counts over stdio.
+ */
+static void vKernelBenchTask(void *pv) {
+    vMetricsCyclesEnable();
+    vTaskDelay(pdMS_TO_TICKS(2000));    // Let USB stdio and Wi-Fi settle
+
+    KernelBenchConfig_t xConfig = {
+        .pxClock = ulMetricsCycles,
+        .pcTickUnit = "cycles",
+        .ulTickHz = clock_get_hz(clk_sys),
+        .ulMinTicks = clock_get_hz(clk_sys) / 50u,      // 20 ms per case
+        .ulMaxBuffer = KERNEL_BENCH_MAX_BUFFER,
+        .pcLabel = "target",
+    };
+    ulKernelBenchRun(&xConfig);
+    vTaskDelete(NULL);
+}
+#endif
+
 /* 
  * Task: Initialization
  */ 
@@ -75,17 +120,32 @@ static void vInitTask(void *pv) {
 
     /* Create tasks */
     xTaskCreate(vBlinkTask, "Blink", configMINIMAL_STACK_SIZE, NULL, 1, &xBlinkHandle);
-    xTaskCreate(vAcquisitionTask, "Acquisition", 4096, NULL, 3, &xAcquisitionHandle);
+    xTaskCreate(vLogTask, "Log", 1024, NULL, tskIDLE_PRIORITY, NULL);
     
-    /* Create web server */
+    /* Create acquisition and web server (core 0) and DSP task (core 1) */
     static WifiCredentials_t xWifiCredentials = {
         .pcWifiName = "picotest",
         .pcWifiPass = "testingtesting"
     };
+#if configUSE_CORE_AFFINITY
+    // Pinned: its cycle counts (stage metrics, trace spans) must start and end on one core's DWT
+    xTaskCreateAffinitySet(vAcquisitionTask, "Acquisition", 4096, NULL, 3, NETWORK_CORE_MASK, &xAcquisitionHandle);
+    xTaskCreateAffinitySet(vWebServerTask, "WebServer", 8192, &xWifiCredentials, 2, NETWORK_CORE_MASK, &xWebServerHandle);
+    xTaskCreateAffinitySet(vDspTask, "DSP", 4096, NULL, 2, DSP_CORE_MASK, &xDspHandle);
+#else
+    xTaskCreate(vAcquisitionTask, "Acquisition", 4096, NULL, 3, &xAcquisitionHandle);
     xTaskCreate(vWebServerTask, "WebServer", 8192, &xWifiCredentials, 2, &xWebServerHandle);
+    xTaskCreate(vDspTask, "DSP", 4096, NULL, 2, &xDspHandle);
+#endif
     
-    /* Register web server handle for notifications */
-    vScopeDataSetWebServerHandle(xWebServerHandle);
+#if PICOSCOPE_KERNEL_BENCH && configUSE_CORE_AFFINITY
+    xTaskCreateAffinitySet(vKernelBenchTask, "KernelBench", 4096, NULL, 4, DSP_CORE_MASK, NULL);
+#elif PICOSCOPE_KERNEL_BENCH
+    xTaskCreate(vKernelBenchTask, "KernelBench", 4096, NULL, 4, NULL);
+#endif
+
+    /* Queued frames wake the web server (the DSP task registers with scope_data itself) */
+    vDspSetFramesReadyHook(vWebServerWake);
     
     printf("[Core%u] All tasks created\n", get_core_num());
     printf("WAVEFORM: Outputting 1 kHz sine on GPIO15 -> Connect to GPIO26 (ADC) via 10kΩ resistor\n");
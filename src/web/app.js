@@ -0,0 +1,211 @@
+const canvas=document.getElementById('c'),ctx=canvas.getContext('2d');
+const zcanvas=document.getElementById('z'),zctx=zcanvas.getContext('2d');
+let zoomW=0,zoomC=0.5;
+let ws,running=true;
+let pingTimer=null,lastFrameMs=0,fpsAvg=0;
+let rttMin=0,rttAvg=0;
+let cfgWant=-1;   // Config version of the last command reply until a frame carries it
+const rttEl=document.getElementById('rtt');
+const fpsEl=document.getElementById('fps');
+// Frame v2 decoder (see net/frame_codec.h); returns samples in ADC counts.
+// refSym holds the last decoded symbols per view for inter-frame and keep-alive frames.
+let refSym=[null,null];
+function decodeFrame(buf,off){
+  const dv=new DataView(buf,off);
+  if(dv.byteLength<44||dv.getUint16(0,true)!==0x5350)return null;
+  const h={ver:dv.getUint8(2),hlen:dv.getUint8(3),enc:dv.getUint8(4),flags:dv.getUint8(5),ch:dv.getUint8(6),view:dv.getUint8(7),
+    seq:dv.getUint32(8,true),ts:dv.getUint32(12,true),age:dv.getUint16(16,true),n:dv.getUint16(18,true),
+    sps:dv.getUint32(20,true),tdiv:dv.getFloat32(24,true),trig:dv.getInt16(28,true),
+    lo:dv.getUint16(30,true),hi:dv.getUint16(32,true),vmin:dv.getUint16(34,true)/1000,
+    vmax:dv.getUint16(36,true)/1000,vavg:dv.getUint16(38,true)/1000,plen:dv.getUint16(40,true),cfg:dv.getUint16(42,true)};
+  if(h.hlen+h.plen>dv.byteLength)return null;
+  h.len=h.hlen+h.plen;
+  const p=new Uint8Array(buf,off+h.hlen,h.plen);
+  const bad={h:h,s:null};
+  if(h.view>=refSym.length)return bad;
+  const ref=refSym[h.view],n=h.n;let q=0,sym;
+  const rdZig=()=>{
+    let v=0,sh=0,nb;
+    do{ nb=(p[q>>1]>>((q&1)*4))&15; q++; v+=(nb&7)*Math.pow(2,sh); sh+=3; }while(nb&8);
+    return (v%2)?-(v+1)/2:v/2;
+  };
+  if(h.flags&12){
+    if(!ref||ref.length!==n)return bad;
+    sym=ref;
+    if(h.flags&4){ sym=new Int32Array(n); for(let i=0;i<n;i++) sym[i]=ref[i]+rdZig(); }
+  }else{
+    sym=new Int32Array(n);
+    if(h.flags&1){
+      let prev=0; for(let i=0;i<n;i++){ prev+=rdZig(); sym[i]=prev; }
+    }else if(h.enc===0){
+      for(let i=0;i<n;i++) sym[i]=p[2*i]|(p[2*i+1]<<8);
+    }else if(h.enc===1){
+      for(let i=0,j=0;i<n;i+=2,j+=3){
+        sym[i]=p[j]|((p[j+1]&15)<<8);
+        if(i+1<n) sym[i+1]=(p[j+1]>>4)|(p[j+2]<<4);
+      }
+    }else if(h.enc===2){
+      for(let i=0;i<n;i++) sym[i]=p[i];
+    }else return bad;
+  }
+  refSym[h.view]=sym;
+  const s=new Float32Array(n);
+  if(h.enc===2){ const r=(h.hi-h.lo)/255; for(let i=0;i<n;i++) s[i]=h.lo+sym[i]*r; }
+  else s.set(sym);
+  return {h:h,s:s};
+}
+function connect(){
+  ws=new WebSocket('ws://'+location.host+'/ws');
+  ws.binaryType='arraybuffer';
+  refSym=[null,null];
+  ws.onopen=()=>{
+    document.getElementById('status').textContent='Connected';
+    sendFmt();
+    sendCmd('display_points',parseInt(document.getElementById('points').value));
+    sendDrag('zoom_center',zoomC);
+    sendCmd('zoom_width',zoomW);
+    if(pingTimer) clearInterval(pingTimer);
+    pingTimer=setInterval(()=>{
+      if(ws&&ws.readyState===1){ ws.send('ping '+Date.now()); ws.send(JSON.stringify({cmd:'client_stats'})); }
+    },1000);
+  };
+  ws.onclose=()=>{
+    document.getElementById('status').textContent='Disconnected';
+    if(pingTimer){ clearInterval(pingTimer); pingTimer=null; }
+    setTimeout(connect,2000);
+  };
+  ws.onerror=()=>document.getElementById('status').textContent='Error';
+  ws.onmessage=e=>{
+    if(typeof e.data==='string'){
+      if(e.data.startsWith('ping ')){
+        const t=parseInt(e.data.slice(5))||0;
+        if(t>0){
+          const rtt=Date.now()-t;
+          rttMin=rttMin?Math.min(rttMin,rtt):rtt; rttAvg=rttAvg?rttAvg*0.8+rtt*0.2:rtt;
+          rttEl.textContent=rtt+'ms (min '+rttMin+', avg '+rttAvg.toFixed(0)+')';
+        }
+        return;
+      }
+      try{
+        const r=JSON.parse(e.data);
+        if(r.clients){
+          const me=r.clients.find(x=>x.self);
+          if(me) document.getElementById('drops').textContent=me.dropped+' / '+me.lat_avg_ms+'ms';
+        }else{
+          console.log('Response:',r);
+          if(r.version){cfgWant=r.version&0xFFFF;document.getElementById('status').textContent='Applying';}
+        }
+      }catch(_){ }
+      return;
+    }
+    // A message can hold several frames; decode all (references), draw the newest per view
+    const last=[null,null];let nMain=0;
+    for(let off=0;off<e.data.byteLength;){
+      const f=decodeFrame(e.data,off);
+      if(!f)break;
+      off+=f.h.len;
+      if(!f.s)continue;
+      last[f.h.view]=f;
+      if(f.h.view===0)nMain++;
+    }
+    if(last[1]&&zoomW>0) drawTrace(zcanvas,zctx,last[1].h,last[1].s,null);
+    const f=last[0];
+    if(!f)return;
+    const h=f.h;
+    const now=performance.now();
+    if(lastFrameMs>0){
+      const inst=nMain*1000/Math.max(1,now-lastFrameMs);
+      fpsAvg = fpsAvg ? (fpsAvg*0.8 + inst*0.2) : inst;
+      fpsEl.textContent=fpsAvg.toFixed(1)+' Hz';
+    }else{
+      fpsEl.textContent='--- Hz';
+    }
+    lastFrameMs=now;
+    // Frames from the snapshot of the last reply on show the new settings
+    if(cfgWant>=0&&((h.cfg-cfgWant)&0xFFFF)<0x8000){cfgWant=-1;document.getElementById('status').textContent='Connected';}
+    document.getElementById('sps').textContent=(h.sps/1000).toFixed(1)+'kSPS';
+    document.getElementById('age').textContent=h.age+'ms';
+    document.getElementById('vmin').textContent=h.vmin.toFixed(3)+'V';
+    document.getElementById('vmax').textContent=h.vmax.toFixed(3)+'V';
+    document.getElementById('vavg').textContent=h.vavg.toFixed(3)+'V';
+    document.getElementById('vpp').textContent=(h.vmax-h.vmin).toFixed(3)+'V';
+    drawTrace(canvas,ctx,h,f.s,zoomW>0?[zoomC-zoomW/2,zoomW]:null);
+  };
+}
+// Trace scaled to the vertical window; zr=[start,width] highlights the zoom window
+function drawTrace(cv,cx,h,smp,zr){
+  const W=cv.width,H=cv.height,n=h.n,span=Math.max(1,h.hi-h.lo);
+  cx.fillStyle='#000';cx.fillRect(0,0,W,H);
+  if(zr){
+    const x0=Math.max(0,Math.min(1-zr[1],zr[0]))*W;
+    cx.fillStyle='#112';cx.fillRect(x0,0,zr[1]*W,H);
+  }
+  if(h.flags&2){
+    const tx=(h.trig/(n-1))*W;
+    cx.strokeStyle='#444';cx.beginPath();cx.moveTo(tx,0);cx.lineTo(tx,H);cx.stroke();
+  }
+  cx.strokeStyle='#0f0';cx.lineWidth=1;cx.beginPath();
+  for(let i=0;i<n;i++){
+    const x=(i/(n-1))*W;
+    const y=H-((smp[i]-h.lo)/span)*H;
+    i===0?cx.moveTo(x,y):cx.lineTo(x,y);
+  }
+  cx.stroke();
+}
+connect();
+// Command sending function
+function sendCmd(cmd,value){
+  if(ws&&ws.readyState===1){
+    const msg=JSON.stringify({cmd:cmd,value:value});
+    console.log('Sending:',msg);
+    ws.send(msg);
+  }
+}
+// Slider drags: only the newest value per command goes out, once per animation frame
+const dragPending={};let dragRaf=0;
+function sendDrag(cmd,value){
+  dragPending[cmd]=value;
+  if(!dragRaf)dragRaf=requestAnimationFrame(()=>{
+    dragRaf=0;
+    for(const k in dragPending){sendCmd(k,dragPending[k]);delete dragPending[k];}
+  });
+}
+// Wire up controls
+document.getElementById('trigLevel').oninput=e=>{
+  const v=parseFloat(e.target.value);
+  document.getElementById('trigLevelVal').textContent=v.toFixed(2)+'V';
+  sendDrag('trigger_level',v);
+};
+document.getElementById('trigMode').onchange=e=>sendCmd('trigger_mode',parseInt(e.target.value));
+document.getElementById('trigEdge').onchange=e=>sendCmd('trigger_edge',parseInt(e.target.value));
+document.getElementById('timeDiv').onchange=e=>sendCmd('timebase_scale',parseFloat(e.target.value));
+document.getElementById('points').onchange=e=>sendCmd('display_points',parseInt(e.target.value));
+document.getElementById('voltDiv').onchange=e=>sendCmd('vertical_scale',parseFloat(e.target.value));
+document.getElementById('vOffset').oninput=e=>{
+  const v=parseFloat(e.target.value);
+  document.getElementById('vOffsetVal').textContent=v.toFixed(2)+'V';
+  sendDrag('vertical_offset',v);
+};
+function sendFmt(){
+  const enc=parseInt(document.getElementById('frameFmt').value);
+  const fl=(document.getElementById('frameDelta').checked?1:0)|(document.getElementById('frameInter').checked?4:0);
+  sendCmd('frame_format',enc+fl*16);
+}
+document.getElementById('frameFmt').onchange=sendFmt;
+document.getElementById('frameDelta').onchange=sendFmt;
+document.getElementById('frameInter').onchange=sendFmt;
+document.getElementById('zoom').onchange=e=>{
+  zoomW=parseFloat(e.target.value);
+  zcanvas.style.display=zoomW>0?'block':'none';
+  refSym[1]=null;
+  sendCmd('zoom_width',zoomW);
+};
+document.getElementById('zoomCenter').oninput=e=>{
+  zoomC=parseFloat(e.target.value);
+  sendDrag('zoom_center',zoomC);
+};
+document.getElementById('runStop').onclick=e=>{
+  running=!running;
+  sendCmd('run_stop',running?1:0);
+  e.target.textContent=running?'STOP':'RUN';
+};
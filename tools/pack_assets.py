@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""Pack frontend assets into a generated C source (web_assets_data.c).
+
+The output file named on the command line defines xWebAssets and
+xWebAssetCount, declared in src/net/web_assets.h.
+
+Each file is gzip-compressed (level 9, no name/mtime so the output is
+reproducible) and emitted as a byte array with its URL path, MIME type,
+length and an ETag derived from the compressed bytes.
+
+Usage: pack_assets.py OUT.c ASSET...
+The URL of an asset is "/" + its file name.
+"""
+import gzip
+import hashlib
+import os
+import sys
+
+MIME_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".js": "text/javascript; charset=utf-8",
+    ".css": "text/css; charset=utf-8",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+
+def c_bytes(data, per_line=16):
+    lines = []
+    for i in range(0, len(data), per_line):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.stderr.write(__doc__)
+        return 2
+    out_path, assets = argv[1], argv[2:]
+
+    arrays, entries = [], []
+    for i, path in enumerate(assets):
+        name = os.path.basename(path)
+        ext = os.path.splitext(name)[1].lower()
+        if ext not in MIME_TYPES:
+            sys.stderr.write("pack_assets: no MIME type for %s\n" % path)
+            return 1
+        with open(path, "rb") as f:
+            raw = f.read()
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = '\\"%s\\"' % hashlib.sha1(packed).hexdigest()[:16]
+        arrays.append("/* %s: %u bytes, %u gzipped */\nstatic const uint8_t ucAsset%u[] = {\n%s\n};\n"
+                      % (name, len(raw), len(packed), i, c_bytes(packed)))
+        entries.append('    { "/%s", "%s", ucAsset%u, %uu, "%s" },' % (name, MIME_TYPES[ext], i, len(packed), etag))
+
+    os.makedirs(os.path.dirname(os.path.abspath(out_path)), exist_ok=True)
+    with open(out_path, "w") as f:
+        f.write("/* Generated by tools/pack_assets.py from src/web - do not edit */\n")
+        f.write('#include "net/web_assets.h"\n\n')
+        f.write("\n".join(arrays))
+        f.write("\nconst WebAsset_t xWebAssets[] = {\n%s\n};\n\n" % "\n".join(entries))
+        f.write("const size_t xWebAssetCount = sizeof(xWebAssets) / sizeof(xWebAssets[0]);\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))